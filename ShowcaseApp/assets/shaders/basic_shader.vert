@@ -1,29 +1,36 @@
-#version 330 core
+#version 450 core
+
+#include "constants.glsl"
+#include "octahedral.glsl"
 
 // Input attributes
-layout (location = 0) in vec3 position;  // Vertex position
+layout (location = 0) in vec3 position;  // Vertex position (snorm16 against the mesh bounds when packed)
 layout (location = 1) in vec3 color;     // Vertex color
-layout (location = 2) in vec3 normal;    // Vertex normal
-layout (location = 3) in vec2 uv;        // Texture coordinates (UV)
+layout (location = 2) in vec4 normal;    // Vertex normal (octahedral in xy when packed)
+layout (location = 3) in vec2 uv;        // Texture coordinates (UV, unorm16 against the UV bounds when packed)
 
 // Output variables
 out vec4 vertexColor;  // Interpolated vertex color
 out vec2 texCoord;     // Interpolated texture coordinates (UV)
+out vec3 worldNormal;  // Interpolated world-space normal
 out vec2 InterpolatedTexCoord; // Send the corrected texture coordinate to the fragment shader
 
 
 // Uniform variables
-uniform mat4 view;       // View matrix
-uniform mat4 projection; // Projection matrix
-uniform mat4 model;      // Model matrix
+uniform int objectIndex; // Entry of objects[] this draw reads
 
 void main() {
+    ObjectConstants object = objects[objectIndex];
+    vec3 objectPosition = object.positionOffset.xyz + object.positionScale.xyz * position;
+    vec3 objectNormal = object.positionOffset.w != 0.0 ? decodeOctahedral(normal.xy) : normal.xyz;
+
     // Transform vertex position from object to clip space
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    gl_Position = projection * view * object.model * vec4(objectPosition, 1.0);
+    worldNormal = mat3(object.model) * objectNormal;
 
     // Pass per-vertex color to fragment shader
     vertexColor = vec4(color, 1.0);
 
     // Pass texture coordinates (UV) to fragment shader
-    texCoord = uv;
+    texCoord = object.uvTransform.xy + object.uvTransform.zw * uv;
 }
@@ -0,0 +1,22 @@
+// Blocks shared by the scene shaders. The C++ side is constantbuffers.h, which checks both layouts at compile time.
+
+// Written once per frame
+layout (std140, binding = 0) uniform FrameConstants {
+    mat4 view;            // View matrix
+    mat4 projection;      // Projection matrix
+    mat4 viewProjection;  // projection * view
+    vec3 cameraPosition;  // World-space eye position
+    float time;           // Seconds since the window opened
+};
+
+// One entry per object or per indirect draw
+struct ObjectConstants {
+    mat4 model;           // Model matrix
+    vec4 positionOffset;  // Center of the mesh bounds in xyz; w is 1 when normals are octahedral encoded
+    vec4 positionScale;   // Half extent of the mesh bounds
+    vec4 uvTransform;     // UV offset in xy, UV scale in zw
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+    ObjectConstants objects[];
+};
@@ -0,0 +1,32 @@
+#version 450 core
+
+#include "constants.glsl"
+#include "octahedral.glsl"
+
+// Input attributes
+layout (location = 0) in vec3 position;  // Vertex position (snorm16 against the mesh bounds when packed)
+layout (location = 1) in vec3 color;     // Vertex color
+layout (location = 2) in vec4 normal;    // Vertex normal (octahedral in xy when packed)
+layout (location = 3) in vec2 uv;        // Texture coordinates (UV, unorm16 against the UV bounds when packed)
+layout (location = 4) in uint drawId;    // Per-draw index, fed from the command's base instance
+
+// Output variables
+out vec4 vertexColor;  // Interpolated vertex color
+out vec2 texCoord;     // Interpolated texture coordinates (UV)
+out vec3 worldNormal;  // Interpolated world-space normal
+
+void main() {
+    ObjectConstants draw = objects[drawId];
+    vec3 objectPosition = draw.positionOffset.xyz + draw.positionScale.xyz * position;
+    vec3 objectNormal = draw.positionOffset.w != 0.0 ? decodeOctahedral(normal.xy) : normal.xyz;
+
+    // Transform vertex position from object to clip space
+    gl_Position = projection * view * draw.model * vec4(objectPosition, 1.0);
+    worldNormal = mat3(draw.model) * objectNormal;
+
+    // Pass per-vertex color to fragment shader
+    vertexColor = vec4(color, 1.0);
+
+    // Pass texture coordinates (UV) to fragment shader
+    texCoord = draw.uvTransform.xy + draw.uvTransform.zw * uv;
+}
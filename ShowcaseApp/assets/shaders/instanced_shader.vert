@@ -0,0 +1,47 @@
+#version 450 core
+
+#include "constants.glsl"
+#include "octahedral.glsl"
+
+// Input attributes
+layout (location = 0) in vec3 position;  // Vertex position (snorm16 against the mesh bounds when packed)
+layout (location = 1) in vec3 color;     // Vertex color
+layout (location = 2) in vec4 normal;    // Vertex normal (octahedral in xy when packed)
+layout (location = 3) in vec2 uv;        // Texture coordinates (UV, unorm16 against the UV bounds when packed)
+
+// Output variables
+out vec4 vertexColor;  // Interpolated vertex color
+out vec2 texCoord;     // Interpolated texture coordinates (UV)
+out vec3 worldNormal;  // Interpolated world-space normal
+
+// Per-instance data; the bound range starts at the first copy of the draw
+struct InstanceData {
+    mat4 model;  // Model matrix of the copy
+    vec4 color;  // Multiplies the vertex color
+};
+
+layout (std430, binding = 1) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+// Vertex decode, identity for unpacked meshes
+uniform vec3 positionOffset; // Center of the mesh bounds
+uniform vec3 positionScale;  // Half extent of the mesh bounds
+uniform vec4 uvTransform;    // UV offset in xy, UV scale in zw
+uniform bool packedNormals;  // Normals are octahedral encoded
+
+void main() {
+    InstanceData instance = instances[gl_InstanceID];
+    vec3 objectPosition = positionOffset + positionScale * position;
+    vec3 objectNormal = packedNormals ? decodeOctahedral(normal.xy) : normal.xyz;
+
+    // Transform vertex position from object to clip space
+    gl_Position = projection * view * instance.model * vec4(objectPosition, 1.0);
+    worldNormal = mat3(instance.model) * objectNormal;
+
+    // Pass per-vertex color, tinted per copy, to fragment shader
+    vertexColor = vec4(color, 1.0) * instance.color;
+
+    // Pass texture coordinates (UV) to fragment shader
+    texCoord = uvTransform.xy + uvTransform.zw * uv;
+}
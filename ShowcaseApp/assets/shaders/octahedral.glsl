@@ -0,0 +1,10 @@
+// Normal decoding shared by the scene vertex shaders. The C++ encoder is in vertexformat.cpp.
+
+// Unit normal from its octahedral encoding in [-1, 1]^2
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
@@ -2,48 +2,117 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <memory>
 #include <string>
 #include <mesh.h>
 #include <shader.h>
 #include <types.h>
 #include <camera.h>
 #include "texture.h"
+#include "geometryarena.h"
+#include "indirectrenderer.h"
+#include "meshoptimizer.h"
+#include "staticbatch.h"
+#include "instancegroup.h"
+#include "meshfile.h"
+#include "gltfloader.h"
+#include "bvh.h"
+#include "occlusionbuffer.h"
+#include "gpuculler.h"
+#include "raycaster.h"
+#include "renderqueue.h"
+#include "constantbuffers.h"
+#include "streambuffer.h"
+#include "simulation.h"
 
 class Application {
 public:
+    enum class RenderMode {
+        Immediate,  // One glDrawElements per mesh with an object index uniform
+        Sorted,  // Immediate draws recorded into a render queue, sorted by state and submitted without redundant calls
+        MultiDrawIndirect,  // One glMultiDrawElementsIndirect per arena and texture set
+        GpuDriven  // Culling and level selection in a compute shader that writes the indirect commands
+    };
+
     Application();  // Default constructor
     Application(std::string WindowTitle, int width, int height);  // Constructor with parameters
 
 
     void Run();  // Function to run the application
+    void SetVertexFormat(VertexFormat format) { _vertexFormat = format; }  // Select the vertex layout used by the scene's arena
+    void SetInstanceCount(uint32_t count) { _instanceCount = count; }  // Number of instanced bottles to scatter on the table
+    void SetModelPath(std::filesystem::path path) { _modelPath = std::move(path); }  // glTF file to add to the scene
 
 private:
     bool openWindow();  // Function to open the application window
     void setupInputs();
 
     void setupScene();  // Function to set up the scene
-    bool update(float deltaTime);  // Function to update the application state
+    void printOptimizationReport(const char* name, const MeshOptimizer::Report& report);  // Function to log a mesh's vertex cache figures
+    void teardownScene();  // Function to release the scene's GPU resources
+    uint32_t cullOnCpu(const SceneSnapshot& snapshot);  // Occlusion cull the snapshot's frustum result into _visible; returns the meshes left
+    bool update();  // Function to poll events and take the newest simulation snapshot
     bool draw();  // Function to draw the scene
 
-    void handleInput(float deltaTime);
+    void selectAt(const Ray& ray);  // Select the mesh a world-space ray hits first by raycasting its triangles
 
-    void mousePositionCallback(double xpos, double ypos);
+    uint32_t drawImmediate();  // Draw every mesh with its own draw call, counting its state changes
+    void updateFrameStats(float deltaTime);  // Accumulate per-frame stats and show them in the window title
 
 private:
+    static constexpr GLsizeiptr StreamSegmentSize = 4 * 1024 * 1024;  // Bytes of constants and commands one frame may stream
+
     std::string _applicationName;  // Name of the application window
     int _width{};  // Width of the application window
     int _height{};  // Height of the application window
     GLFWwindow *_window{nullptr};  // Pointer to the GLFW window
 
-    Camera _camera;
+    Simulation _simulation;  // Camera, input and frustum culling stepped on their own thread
+    std::unique_ptr<GeometryArena> _geometryArena;  // Shared vertex/index storage for every mesh in the scene
     std::vector<Mesh> _meshes;  // Vector to store meshes in the scene
-    std::vector<Texture> _textures;
+    std::vector<MeshFile> _meshFiles;  // Cooked meshes mapped at setup; meshes created from them view their pages
+    std::filesystem::path _modelPath;  // glTF file to load at setup, if any
+    std::unique_ptr<GltfLoader> _model;  // Loaded glTF file; its meshes view the loader's geometry
+    StaticBatch _staticBatch;  // Source ranges of the static meshes baked into one of _meshes
+    std::vector<InstanceGroup> _instanceGroups;  // Meshes drawn many times with instanced draws
+    std::vector<uint8_t> _visible;  // Per-frame frustum and occlusion test result of each of _meshes
+    OcclusionBuffer _occlusion;  // CPU depth of the visible occluders, rasterized every frame before submission
+    uint32_t _instanceCount{ 0 };  // Copies in the bottle instance group, none by default
+    TextureSet _textures;  // Textures shared by the scene's meshes
     Shader _shader;  // Shader object for rendering
+    Shader _indirectShader;  // Shader reading per-draw transforms from a storage buffer
+    Shader _instancedShader;  // Shader reading per-instance transforms from a storage buffer
+    std::unique_ptr<StreamBuffer> _streamBuffer;  // Per-frame ring the constants and indirect commands are written into
+    std::unique_ptr<IndirectRenderer> _indirectRenderer;  // Multi-draw-indirect submission path
+    std::unique_ptr<ConstantBuffers> _constantBuffers;  // Frame and per-mesh constants read by every scene shader
+    std::vector<ObjectConstants> _objectConstants;  // One entry per mesh, rebuilt each frame in immediate and sorted modes
+    std::unique_ptr<GpuCuller> _gpuCuller;  // GPU-driven submission path
+    RenderQueue _renderQueue;  // Sorted submission path
+    Raycaster _raycaster;  // Triangle hierarchies of _meshes for picking, brought up to date on each click
+    uint32_t _selectedMesh{ RayHit::None };  // Mesh picked with the left mouse button, shown in the window title
+    uint32_t _pickCount{ 0 };  // Snapshot PickCount of the last selection handled
+    RenderMode _renderMode{ RenderMode::Immediate };  // Active submission path, cycled with F1
+    VertexFormat _vertexFormat{ VertexFormat::Full };  // Vertex layout of the scene's arena
     bool _running{false};  // Flag indicating whether the application is running
 
-    bool _firstMouse { false };  // Flag to track the first mouse movement
-    glm::vec2 _lastMousePosition {-1, -1};  // Last recorded mouse position
     glm::vec2 _cameraLookSpeed {};  // Speed at which the camera looks around
 
     float _lastFrameTime { 1.f };  // Time of the last frame for deltaTime calculation
+
+    struct FrameStats {
+        uint32_t DrawCalls{ 0 };  // Draw calls issued by the last frame
+        uint32_t StateChanges{ 0 };  // Program, texture, vertex array and object index calls for the scene meshes in the last frame; immediate and sorted modes only
+        uint32_t StateCallsIssued{ 0 };  // Binds, program switches and enables GLState passed to GL in the last frame
+        uint32_t StateCallsElided{ 0 };  // Binds, program switches and enables GLState dropped as redundant in the last frame
+        uint32_t Triangles{ 0 };  // Triangles drawn by the last frame at the selected levels of detail
+        uint32_t ObjectsDrawn{ 0 };  // Meshes and instanced copies inside the frustum in the last frame
+        uint32_t ObjectsCulled{ 0 };  // Meshes and instanced copies skipped by frustum culling in the last frame
+        uint32_t ObjectsOccluded{ 0 };  // Meshes and instanced copies inside the frustum but hidden behind occluders
+        double SubmitMilliseconds{ 0.0 };  // CPU time spent in submission, summed over the reporting interval
+        double UpdateMilliseconds{ 0.0 };  // Simulation step time of the snapshots drawn, summed over the reporting interval
+        uint64_t FirstTick{ 0 };  // Simulation step of the first snapshot drawn in the reporting interval
+        uint32_t Frames{ 0 };  // Frames in the reporting interval
+        float Elapsed{ 0.f };  // Seconds in the reporting interval
+    };
+    FrameStats _frameStats;
 };
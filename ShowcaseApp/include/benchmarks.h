@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+// Command-line micro benchmarks that run without opening a window (ShowcaseApp --benchmark <name>)
+class Benchmarks {
+public:
+    static int Run(const std::string& name);  // Run one benchmark, or all of them for "all"; returns the process exit code
+
+private:
+    static void vertexFormat();  // Full vs packed vertex bytes on high-sector cylinders
+    static void generators();  // Vertices per second of the primitive generators, against the original per-vertex code
+    static void simplify();  // Serial vs parallel quadric simplification of a dense height field
+    static void meshFile();  // Generating the bottle's LOD chain vs mapping and validating its cooked file
+    static void culling();  // Scalar vs batched SIMD frustum tests over many boxes
+    static void bvh();  // Flat scans vs hierarchy queries, and refit vs rebuild, over many boxes
+    static void occlusion();  // CPU occluder rasterization per thread count, and occludee tests behind a wall
+    static void raycast();  // Brute-force triangle scans vs the triangle hierarchy, one ray and four at a time
+    static void renderQueue();  // Radix sort of render queue keys against std::sort
+    static void handoff();  // Lock-free vs locked input queue, and lockstep vs pipelined update and render
+};
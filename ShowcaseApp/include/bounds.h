@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box; an empty box has Min above Max and grows to the first point it is given.
+struct BoundingBox {
+    glm::vec3 Min{ FLT_MAX };
+    glm::vec3 Max{ -FLT_MAX };
+
+    bool IsEmpty() const { return Min.x > Max.x; }
+    glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+    glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }  // Half size along each axis
+
+    void Expand(glm::vec3 point)
+    {
+        Min = glm::min(Min, point);
+        Max = glm::max(Max, point);
+    }
+
+    void Expand(const BoundingBox& box)
+    {
+        Min = glm::min(Min, box.Min);
+        Max = glm::max(Max, box.Max);
+    }
+
+    // Box around this one after an affine transform: the centre is transformed and the extents are
+    // projected onto the new axes through the absolute matrix (Arvo)
+    BoundingBox Transformed(const glm::mat4& transform) const
+    {
+        if (IsEmpty()) {
+            return *this;
+        }
+        glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+        glm::mat3 absolute(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+        glm::vec3 extents = absolute * GetExtents();
+        return { center - extents, center + extents };
+    }
+};
+
+// Sphere around the same points as a BoundingBox, centred on the box so the two agree
+struct BoundingSphere {
+    glm::vec3 Center{ 0.0f };
+    float Radius{ 0.0f };
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.h"
+#include "frustum.h"
+
+// One node of the flattened hierarchy. Both children of an inner node sit next to each other and after their
+// parent, so a traversal reads forward through the array and a full refit is one reverse pass.
+struct BvhNode {
+    glm::vec3 Min;  // Bounds of everything below the node
+    uint32_t First;  // Leaf: first slot in the object order; inner: index of the left child (the right one follows it)
+    glm::vec3 Max;
+    uint32_t Count;  // Objects in a leaf, 0 for an inner node
+
+    bool IsLeaf() const { return Count > 0; }
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes so a sibling pair fills 64 bytes");
+
+// Bounding volume hierarchy over world-space object boxes, built with the binned surface area heuristic.
+// Moving objects refit their leaf and its ancestors in place; the tree is rebuilt once refits have made it
+// noticeably worse than a fresh build. Frustum, overlap and nearest queries descend only into nodes that can
+// contain an answer, so their cost follows the depth of the tree rather than the number of objects.
+class Bvh {
+public:
+    static constexpr uint32_t None = UINT32_MAX;  // Object index of a query that found nothing
+
+    struct Nearest {
+        uint32_t Object{ None };  // Closest object, or None
+        float Distance{ FLT_MAX };  // Distance from the query point to its box, 0 when the point is inside
+    };
+
+    void Build(std::span<const BoundingBox> bounds);  // Replace the tree with one over these boxes, indexed as given
+    bool Update(uint32_t object, const BoundingBox& box);  // Refit the path above one object; false if the box is unchanged
+    void Rebuild();  // Build again from the current object boxes
+    void Refit();  // Recompute every node from the current object boxes
+    bool NeedsRebuild() const;  // True once refits have raised the tree's cost well above its build cost
+
+    uint32_t GetObjectCount() const { return static_cast<uint32_t>(_bounds.size()); }
+    const BoundingBox& GetBounds(uint32_t object) const { return _bounds[object]; }
+    std::span<const BvhNode> GetNodes() const { return _nodes; }
+    std::span<const uint32_t> GetObjectOrder() const { return _objects; }  // Objects in leaf order; a leaf's First and Count index this
+    float GetCost() const;  // Surface area heuristic cost of the current tree
+
+    // Write 1 (visible) or 0 (culled) per object into visible and return the number visible. Planes a node lies
+    // entirely inside are not tested again below it.
+    uint32_t Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+    uint32_t QueryOverlap(const BoundingBox& box, std::vector<uint32_t>& results) const;  // Objects whose boxes touch box
+    uint32_t QueryOverlap(const BoundingSphere& sphere, std::vector<uint32_t>& results) const;  // Objects whose boxes touch sphere
+    Nearest FindNearest(glm::vec3 point, float maxDistance = FLT_MAX) const;  // Object whose box is closest to point
+
+private:
+    void subdivide(uint32_t node, uint32_t depth);
+    void refitLeaf(BvhNode& node) const;
+
+private:
+    std::vector<BvhNode> _nodes;  // Root first, then sibling pairs in depth-first order
+    std::vector<uint32_t> _objects;  // Object indices in leaf order; each leaf owns a contiguous range
+    std::vector<BoundingBox> _bounds;  // Current box of each object
+    std::vector<glm::vec3> _centroids;  // Box centres at build time, used only while splitting
+    std::vector<uint32_t> _parents;  // Parent of each node, None for the root
+    std::vector<uint32_t> _leaves;  // Leaf holding each object
+    float _buildCost{ 0.0f };  // GetCost() right after the last Build
+    bool _refitted{ false };  // Set by Update and Refit, cleared by Build
+};
@@ -6,6 +6,8 @@
 
 #include <iostream>
 #include "glm/glm.hpp"
+#include "frustum.h"
+#include "ray.h"
 class Camera {
 public:
     enum class MoveDirection {
@@ -21,6 +23,9 @@ public:
 
     glm::mat4 GetViewMatrix();
     glm::mat4 GetProjectionMatrix() const;
+    glm::vec3 GetPosition() const { return _position; }
+    Frustum GetFrustum() { return Frustum(GetProjectionMatrix() * GetViewMatrix()); }  // World-space planes of the current view
+    Ray GetRay(glm::vec2 cursor);  // World-space ray through a window position in pixels from the top left, from the near plane to the far one
 
     bool IsPerspective() const { return _isPerspective; }
     void SetIsPerspective(bool isPerspective) { _isPerspective = isPerspective; }
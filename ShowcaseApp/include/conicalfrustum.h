@@ -1,27 +1,132 @@
 #pragma once
 
 #include <mesh.h>
+#include "constmath.h"
+#include "meshoptimizer.h"
 #include <glm/glm.hpp>
+#include <array>
+#include <span>
 #include <vector>
 
 class ConicalFrustum
 {
 public:
+    ConicalFrustum() = default;  // Empty conical frustum, to be assigned a generated one
     ConicalFrustum(float topRadius, float bottomRadius, float height, int sectors);  // Constructor with parameters
 
-    Mesh GetMesh();  // Function to get the mesh representation of the conical frustum
-    std::vector<Vertex> GetVertices();  // Function to get the vertices of the conical frustum
-    std::vector<unsigned int> GetIndices();  // Function to get the indices of the conical frustum
+    struct Desc {  // Parameters of one conical frustum in a batch
+        float TopRadius;  // Top radius
+        float BottomRadius;  // Bottom radius
+        float Height;  // Height
+        int Sectors;  // Number of sectors
+    };
+    static std::vector<ConicalFrustum> GenerateBatch(std::span<const Desc> descs, uint32_t threadCount = 0);  // Generate many conical frustums across threads
+
+    static constexpr size_t VertexCount(int sectors) { return 2 + 2 * (static_cast<size_t>(sectors) + 1); }  // Centres plus a duplicated seam ring
+    static constexpr size_t IndexCount(int sectors) { return 12 * static_cast<size_t>(sectors); }  // Four triangles per sector
+
+    // Bake the conical frustum at compile time into tables that can be uploaded from read-only data
+    template <int Sectors>
+    static consteval StaticGeometry<VertexCount(Sectors), IndexCount(Sectors)> Generate(float topRadius, float bottomRadius, float height)
+    {
+        static_assert(Sectors >= 3, "A conical frustum needs at least three sectors");
+        std::array<float, Sectors + 1> cosines{};
+        std::array<float, Sectors + 1> sines{};
+        for (int i = 0; i <= Sectors; ++i) {
+            const double sectorAngle = i * (2.0 * ConstMath::Pi / Sectors);
+            cosines[i] = static_cast<float>(ConstMath::Cos(sectorAngle));
+            sines[i] = static_cast<float>(ConstMath::Sin(sectorAngle));
+        }
+
+        StaticGeometry<VertexCount(Sectors), IndexCount(Sectors)> geometry{};
+        writeVertices(topRadius, bottomRadius, height, Sectors, cosines.data(), sines.data(), geometry.Vertices.data());
+        writeIndices(Sectors, geometry.Indices.data());
+        return geometry;
+    }
+
+    static Mesh CreateLodMesh(float topRadius, float bottomRadius, float height, float chordTolerance, GeometryArena* arena = nullptr,
+                              MeshOptimizer::Report* report = nullptr);  // Optimized mesh with a chord-error LOD chain; report gets level 0's figures
+
+    Mesh GetMesh(GeometryArena* arena = nullptr) const&;  // Function to get the mesh representation of the conical frustum
+    Mesh GetMesh(GeometryArena* arena = nullptr) &&;  // Same, moving the generated geometry into the mesh
+    MeshOptimizer::Report Optimize();  // Weld and reorder the generated geometry for the vertex cache and overdraw
+    const std::vector<Vertex>& GetVertices() const { return vertices; }  // Function to get the vertices of the conical frustum
+    const std::vector<unsigned int>& GetIndices() const { return indices; }  // Function to get the indices of the conical frustum
 
 private:
     std::vector<Vertex> vertices;  // Vector to store the vertices of the conical frustum
     std::vector<unsigned int> indices;  // Vector to store the indices of the conical frustum
 
-    float topRadius;  // Top radius of the conical frustum
-    float bottomRadius;  // Bottom radius of the conical frustum
-    float height;  // Height of the conical frustum
-    int sectors;  // Number of sectors used for generating the conical frustum
+    float topRadius{ 0.0f };  // Top radius of the conical frustum
+    float bottomRadius{ 0.0f };  // Bottom radius of the conical frustum
+    float height{ 0.0f };  // Height of the conical frustum
+    int sectors{ 0 };  // Number of sectors used for generating the conical frustum
 
     void generateVertices();  // Function to generate the vertices of the conical frustum
     void generateIndices();  // Function to generate the indices of the conical frustum
+
+    // Interleave a precomputed ring (sectors + 1 cosines and sines) into vertices; shared by the run-time generator and Generate
+    static constexpr void writeVertices(float topRadius, float bottomRadius, float height, int sectors, const float* cosines, const float* sines, Vertex* out)
+    {
+        const float slope = (topRadius - bottomRadius) / height;
+
+        // Generate top vertex
+        out[0].Position = glm::vec3(0.0f, height / 2.0f, 0.0f);
+        out[0].Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        out[0].Uv = glm::vec2(0.5f, 0.5f);
+
+        // Generate bottom vertex
+        out[1].Position = glm::vec3(0.0f, -height / 2.0f, 0.0f);
+        out[1].Normal = glm::vec3(0.0f, -1.0f, 0.0f);
+        out[1].Uv = glm::vec2(6.f, 6.f);
+
+        auto normalized = [](float x, float y, float z) {
+            const auto length = static_cast<float>(ConstMath::Sqrt(x * x + y * y + z * z));
+            return glm::vec3(x / length, y / length, z / length);
+        };
+
+        // Generate side vertices
+        for (int i = 0; i <= sectors; ++i)
+        {
+            const float cosine = cosines[i];
+            const float sine = sines[i];
+            const float xTop = topRadius * cosine;
+            const float zTop = topRadius * sine;
+            const float xBottom = bottomRadius * cosine;
+            const float zBottom = bottomRadius * sine;
+
+            Vertex& sideVertexTop = out[2 + 2 * i];
+            sideVertexTop.Position = glm::vec3(xTop, height / 2.0f, zTop);
+            sideVertexTop.Normal = normalized(xTop, slope, zTop);
+            sideVertexTop.Uv = glm::vec2(static_cast<float>(i) / sectors, 1.0f);
+
+            Vertex& sideVertexBottom = out[3 + 2 * i];
+            sideVertexBottom.Position = glm::vec3(xBottom, -height / 2.0f, zBottom);
+            sideVertexBottom.Normal = normalized(xBottom, slope, zBottom);
+            sideVertexBottom.Uv = glm::vec2(static_cast<float>(i) / sectors, 0.0f);
+        }
+    }
+
+    static constexpr void writeIndices(int sectors, uint32_t* out)
+    {
+        const uint32_t topVertexIndex = 0;
+        const uint32_t bottomVertexIndex = 1;
+
+        // Per sector: top cap, bottom cap, then the two side triangles
+        for (int i = 0; i < sectors; ++i)
+        {
+            const auto currentTop = static_cast<uint32_t>(2 * (i + 2));
+            const auto nextTop = static_cast<uint32_t>(2 * ((i + 1) % sectors + 2));
+            const uint32_t currentBottom = currentTop + 1;
+            const uint32_t nextBottom = nextTop + 1;
+
+            const uint32_t sector[12] = { topVertexIndex, currentTop, nextTop,
+                                          bottomVertexIndex, currentBottom, nextBottom,
+                                          currentTop, currentBottom, nextTop,
+                                          currentBottom, nextBottom, nextTop };
+            for (int j = 0; j < 12; ++j) {
+                out[12 * i + j] = sector[j];
+            }
+        }
+    }
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "streambuffer.h"
+
+// Per-frame constants, std140 layout matching the FrameConstants block in constants.glsl
+struct FrameConstants {
+    glm::mat4 View;  // View matrix
+    glm::mat4 Projection;  // Projection matrix
+    glm::mat4 ViewProjection;  // Projection * View
+    glm::vec3 CameraPosition;  // World-space eye position
+    float Time;  // Seconds since the window opened; packs into the vec3's last std140 slot
+};
+static_assert(offsetof(FrameConstants, View) == 0, "FrameConstants must match the std140 FrameConstants block");
+static_assert(offsetof(FrameConstants, Projection) == 64, "FrameConstants must match the std140 FrameConstants block");
+static_assert(offsetof(FrameConstants, ViewProjection) == 128, "FrameConstants must match the std140 FrameConstants block");
+static_assert(offsetof(FrameConstants, CameraPosition) == 192, "FrameConstants must match the std140 FrameConstants block");
+static_assert(offsetof(FrameConstants, Time) == 204, "FrameConstants must match the std140 FrameConstants block");
+static_assert(sizeof(FrameConstants) == 208, "FrameConstants must match the std140 FrameConstants block");
+
+// Per-object constants, std430 layout matching ObjectConstants in constants.glsl, indexed by draw ID
+struct ObjectConstants {
+    glm::mat4 Model;  // Model matrix
+    glm::vec4 PositionOffset;  // Packed position decode offset in xyz; w is 1 when normals are octahedral encoded
+    glm::vec4 PositionScale;  // Packed position decode scale in xyz
+    glm::vec4 UvTransform;  // Packed UV decode offset in xy and scale in zw
+};
+static_assert(offsetof(ObjectConstants, Model) == 0, "ObjectConstants must match the std430 ObjectConstants struct");
+static_assert(offsetof(ObjectConstants, PositionOffset) == 64, "ObjectConstants must match the std430 ObjectConstants struct");
+static_assert(offsetof(ObjectConstants, PositionScale) == 80, "ObjectConstants must match the std430 ObjectConstants struct");
+static_assert(offsetof(ObjectConstants, UvTransform) == 96, "ObjectConstants must match the std430 ObjectConstants struct");
+static_assert(sizeof(ObjectConstants) == 112, "ObjectConstants must match the std430 ObjectConstants struct");
+
+// The uniform buffer of frame constants and the storage buffer of object constants the scene shaders share
+// through constants.glsl. The frame block is uploaded once per frame and stays bound; draws only say which
+// object entry they read, through a draw ID attribute or the objectIndex uniform. With a stream buffer both are
+// written into its current frame segment and bound as ranges of it; otherwise, or when the segment is full,
+// they are re-specified in buffers of their own.
+class ConstantBuffers {
+public:
+    static constexpr GLuint FrameBinding = 0;  // Uniform buffer binding of FrameConstants
+    static constexpr GLuint ObjectBinding = 0;  // Shader storage binding of the ObjectConstants array
+
+    explicit ConstantBuffers(StreamBuffer* stream = nullptr);
+    ~ConstantBuffers();
+
+    ConstantBuffers(const ConstantBuffers&) = delete;
+    ConstantBuffers& operator=(const ConstantBuffers&) = delete;
+
+    static ObjectConstants MakeObject(const glm::mat4& transform, const Mesh& level);  // With the level's vertex decode
+
+    void SetFrame(const FrameConstants& frame);  // Upload and bind to FrameBinding
+    void SetObjects(std::span<const ObjectConstants> objects);  // Upload and bind to ObjectBinding
+
+private:
+    StreamBuffer* _stream{ nullptr };  // Per-frame ring the constants are written into, if any
+    GLuint _frameBuffer{};  // GL_UNIFORM_BUFFER holding one FrameConstants
+    GLuint _objectBuffer{};  // GL_SHADER_STORAGE_BUFFER holding the ObjectConstants array
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+// Math functions usable in constant expressions. During constant evaluation they run a series or
+// Newton iteration; at run time they forward to <cmath>, so shared generator code stays fast.
+struct ConstMath {
+    static constexpr double Pi = 3.14159265358979323846;
+
+    static constexpr double Sin(double x)
+    {
+        if (!std::is_constant_evaluated()) {
+            return std::sin(x);
+        }
+
+        // Reduce to [-pi, pi], where the Taylor series converges to double precision within 20 terms
+        auto turns = x / (2.0 * Pi);
+        x -= 2.0 * Pi * static_cast<double>(static_cast<long long>(turns + (turns >= 0.0 ? 0.5 : -0.5)));
+        double term = x;
+        double sum = x;
+        for (int k = 1; k < 20; k++) {
+            term *= -x * x / ((2.0 * k) * (2.0 * k + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+
+    static constexpr double Cos(double x)
+    {
+        if (!std::is_constant_evaluated()) {
+            return std::cos(x);
+        }
+        return Sin(x + Pi / 2.0);
+    }
+
+    static constexpr double Sqrt(double x)
+    {
+        if (!std::is_constant_evaluated()) {
+            return std::sqrt(x);
+        }
+        if (x <= 0.0) {
+            return 0.0;
+        }
+
+        double guess = x >= 1.0 ? x : 1.0;
+        for (int i = 0; i < 128; i++) {
+            double next = 0.5 * (guess + x / guess);
+            if (next == guess) {
+                break;
+            }
+            guess = next;
+        }
+        return guess;
+    }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.h"
+
+// View frustum as six inward-facing planes (xyz normal, w distance), extracted from a view-projection matrix.
+class Frustum {
+public:
+    enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    Frustum() = default;  // Planes that accept everything
+    explicit Frustum(const glm::mat4& viewProjection);  // Gribb-Hartmann extraction, normalized
+
+    bool Intersects(const BoundingBox& box) const;  // False only when the box is entirely outside one plane
+    bool Intersects(const BoundingSphere& sphere) const;
+    const std::array<glm::vec4, PlaneCount>& GetPlanes() const { return _planes; }
+
+private:
+    std::array<glm::vec4, PlaneCount> _planes{};  // Inward normals in xyz, distance in w
+};
+
+// World-space boxes of many objects stored as centre and extent arrays, so the frustum test runs over eight
+// boxes per AVX instruction, or four per SSE instruction, instead of one box at a time.
+class FrustumCuller {
+public:
+    void Resize(uint32_t count);  // Keep count boxes; new ones are empty and never visible
+    void SetBounds(uint32_t index, const BoundingBox& box);
+    uint32_t GetCount() const { return _count; }
+
+    // Test every box and write 1 (visible) or 0 (culled) per box into visible; returns the number visible
+    uint32_t Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+    uint32_t CullScalar(const Frustum& frustum, std::vector<uint8_t>& visible) const;  // One box at a time; reference and fallback
+
+    static const char* GetInstructionSet();  // Widest vector path compiled in
+
+private:
+    uint32_t _count{ 0 };  // Boxes in use
+    // Centre and half extent per axis, padded to a multiple of eight with boxes that are always culled
+    std::vector<float> _centerX, _centerY, _centerZ;
+    std::vector<float> _extentX, _extentY, _extentZ;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+#include "types.h"
+#include "vertexformat.h"
+
+// Suballocates vertex and index ranges for many meshes out of a pair of large immutable buffers
+// that share a single vertex array object.
+class GeometryArena {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = UINT32_MAX;
+
+    struct Range {
+        int32_t BaseVertex{ 0 };  // First vertex of the allocation, passed as the draw's base vertex
+        uint32_t VertexCount{ 0 };  // Number of vertices in the allocation
+        uint32_t FirstIndex{ 0 };  // First index of the allocation inside the index buffer, in units of IndexType
+        uint32_t IndexCount{ 0 };  // Number of indices in the allocation
+        GLenum IndexType{ GL_UNSIGNED_INT };  // GL_UNSIGNED_SHORT when every index of the allocation fits in 16 bits
+
+        uint32_t GetIndexSize() const { return IndexType == GL_UNSIGNED_SHORT ? 2 : 4; }  // Bytes per index
+        uintptr_t GetIndexOffset() const { return static_cast<uintptr_t>(FirstIndex) * GetIndexSize(); }  // Byte offset of the first index
+    };
+
+    struct Stats {
+        size_t VertexBytesUsed{ 0 };  // Bytes of vertex storage handed out to live allocations
+        size_t VertexBytesCapacity{ 0 };  // Total bytes of vertex storage
+        size_t IndexBytesUsed{ 0 };  // Bytes of index storage handed out to live allocations
+        size_t IndexBytesCapacity{ 0 };  // Total bytes of index storage
+        float VertexFragmentation{ 0.f };  // 1 - largest free vertex block / total free vertex space
+        float IndexFragmentation{ 0.f };  // 1 - largest free index block / total free index space
+        uint32_t AllocationCount{ 0 };  // Number of live allocations
+    };
+
+    GeometryArena(uint32_t vertexCapacity, uint32_t indexCapacity, VertexFormat format = VertexFormat::Full);  // Constructor with capacities in vertices and 32 bit indices
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    Handle Allocate(const void* vertexData, uint32_t vertexCount, std::span<const uint32_t> indices);  // Upload vertices already in the arena's format; indices are stored as 16 bit when they fit
+    Handle Allocate(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                    const VertexQuantization& quantization = {});  // Upload a mesh, packing it with quantization if the arena is packed
+    void Free(Handle handle);  // Return a mesh's ranges to the free lists
+    const Range& GetRange(Handle handle) const { return _ranges[handle]; }  // Current location of an allocation
+
+    void Compact();  // Move live allocations to the front of the buffers, removing all holes
+    Stats GetStats() const;  // Report bytes used and fragmentation
+
+    VertexFormat GetVertexFormat() const { return _format; }  // Layout of every vertex in the arena
+    GLuint GetVertexArray() const { return _vertexArrayObject; }  // VAO shared by every allocation
+    GLuint GetIndexBuffer() const { return _elementBufferObject; }  // Element buffer shared by every allocation
+
+private:
+    // First-fit free list over a linear address space, kept sorted by offset so neighbours coalesce on free.
+    class FreeList {
+    public:
+        explicit FreeList(uint32_t capacity = 0) { Reset(capacity, 0); }
+
+        void Reset(uint32_t capacity, uint32_t used);  // Mark [0, used) allocated and the rest free
+        bool Allocate(uint32_t size, uint32_t alignment, uint32_t& offset);  // Take the first block that fits at an aligned offset
+        void Free(uint32_t offset, uint32_t size);  // Give a block back and merge it with its neighbours
+
+        uint32_t GetCapacity() const { return _capacity; }
+        uint32_t GetFreeSpace() const;
+        uint32_t GetLargestFreeBlock() const;
+
+    private:
+        struct Block {
+            uint32_t Offset;
+            uint32_t Size;
+        };
+
+        uint32_t _capacity{ 0 };
+        std::vector<Block> _blocks;  // Free blocks sorted by offset
+    };
+
+    void createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, GLuint& vertexBuffer, GLuint& elementBuffer);
+    void setupVertexArray();  // Point the shared VAO at the current buffers
+    void relocate(uint32_t vertexCapacity, uint32_t indexCapacity);  // Copy live ranges tightly packed into new storage; index capacity in slots
+
+private:
+    VertexFormat _format;  // Layout of every vertex in the arena
+    size_t _vertexStride;  // Bytes per vertex for _format
+    GLuint _vertexArrayObject{};  // Vertex array object shared by all meshes
+    GLuint _vertexBufferObject{};  // Immutable vertex storage
+    GLuint _elementBufferObject{};  // Immutable index storage
+
+    FreeList _vertexFreeList;  // Free vertex ranges, in vertices
+    FreeList _indexFreeList;  // Free index ranges, in 16 bit slots; 32 bit indices take two aligned slots
+
+    std::vector<Range> _ranges;  // Allocation table indexed by handle
+    std::vector<bool> _live;  // Whether the handle at the same index is allocated
+    std::vector<Handle> _freeHandles;  // Recycled handle slots
+};
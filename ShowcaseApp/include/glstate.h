@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+// Shadow of the GL binding state the renderer touches: the current program, the vertex array, the active texture
+// unit and each unit's 2D texture, generic and indexed buffer bindings, and capability flags. Calls that would
+// set what is already set are dropped. Everything that binds one of these goes through here, so the shadow
+// never disagrees with the context; anything else that changes them must call Invalidate afterwards.
+//
+// The application has one context, used only from the main thread, so the shadow is global.
+class GLState {
+public:
+    static constexpr uint32_t MaxTextureUnits = 32;  // Units shadowed; higher ones are passed through
+    static constexpr uint32_t MaxIndexedBindings = 16;  // Shader storage and uniform binding points shadowed
+
+    struct Counters {
+        uint32_t Issued{ 0 };  // State calls passed to GL
+        uint32_t Elided{ 0 };  // State calls dropped because they matched the shadow
+    };
+
+    static void UseProgram(GLuint program);
+    static void BindVertexArray(GLuint vertexArray);  // Also forgets the element buffer, which belongs to the vertex array
+    static void ActiveTexture(uint32_t unit);  // Unit index, not GL_TEXTURE0 + unit
+    static void BindTexture(uint32_t unit, GLuint texture);  // GL_TEXTURE_2D on the unit, switching the active unit only if needed
+    static void BindBuffer(GLenum target, GLuint buffer);
+    static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);  // Also sets the generic binding, as GL does
+    static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);  // Always issued
+    static void SetEnabled(GLenum capability, bool enabled);
+    static void Enable(GLenum capability) { SetEnabled(capability, true); }
+    static void Disable(GLenum capability) { SetEnabled(capability, false); }
+
+    // Deleting an object unbinds it, so its name must leave the shadow before GL can hand it out again
+    static void DeleteProgram(GLuint program);
+    static void DeleteVertexArray(GLuint vertexArray);
+    static void DeleteTexture(GLuint texture);
+    static void DeleteBuffer(GLuint buffer);
+
+    static void Invalidate();  // Forget everything, after code outside this class changed bindings or a context was made current
+    static const Counters& GetCounters();
+    static void ResetCounters();  // Start counting a new frame
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "json.h"
+#include "mappedfile.h"
+#include "mesh.h"
+#include "texture.h"
+
+// glTF 2.0 importer for .gltf (with external or data URI buffers) and .glb files. Load does all the CPU work:
+// binary buffers are mapped, accessors are decoded straight from the mapping into each mesh's Vertex and index
+// arrays, and embedded images are decoded, with meshes and images spread over worker threads. CreateMeshes then
+// uploads on the GL thread. Every primitive becomes a sub-mesh, so a glTF mesh is one Mesh with a material each.
+class GltfLoader {
+public:
+    struct MeshData {
+        std::string Name;  // Name of the glTF mesh, if any
+        std::vector<Vertex> Vertices;  // Vertices of every primitive, one after another
+        std::vector<uint32_t> Indices;  // Indices of every primitive, relative to the mesh's vertices
+        std::vector<SubMesh> SubMeshes;  // One range per triangle primitive; Material indexes the glTF materials
+    };
+
+    struct Instance {
+        uint32_t MeshIndex{ 0 };  // Mesh the node draws
+        glm::mat4 Transform{ 1.0f };  // World transform of the node
+    };
+
+    struct Stats {
+        double ReadMilliseconds{ 0.0 };  // Mapping the file and its buffers
+        double ParseMilliseconds{ 0.0 };  // Parsing the JSON and walking the scene
+        double GeometryMilliseconds{ 0.0 };  // Decoding accessors into vertices and indices
+        double ImageMilliseconds{ 0.0 };  // Decoding images
+        double UploadMilliseconds{ 0.0 };  // Creating meshes and textures in CreateMeshes
+        uint32_t Threads{ 1 };  // Worker threads used for geometry and images
+    };
+
+    bool Load(const std::filesystem::path& path, bool decodeImages = true);  // False, with the reason logged, if unusable
+
+    // Upload the decoded images and create one mesh per node instance. The meshes view the loader's geometry,
+    // so the loader must outlive them.
+    std::vector<Mesh> CreateMeshes(GeometryArena* arena = nullptr);
+
+    const std::vector<MeshData>& GetMeshes() const { return _meshes; }
+    const std::vector<Instance>& GetInstances() const { return _instances; }
+    const Stats& GetStats() const { return _stats; }
+
+private:
+    struct Material {
+        int32_t Image{ -1 };  // Image of the base color texture, or -1
+        glm::vec4 BaseColor{ 1.0f };  // Base color factor
+    };
+
+    bool loadBuffers(const std::filesystem::path& directory);  // Map or decode every buffer the document lists
+    bool loadUri(std::string_view uri, const std::filesystem::path& directory, std::span<const std::byte>& data);
+    std::span<const std::byte> getBufferView(int64_t view) const;  // Bytes of a buffer view, empty if invalid
+    bool decodeMesh(const JsonValue& mesh, MeshData& data, std::string& error) const;  // Decode every triangle primitive
+    void addNode(int64_t node, const glm::mat4& parent, size_t depth);  // Add the node and its children to _instances
+
+private:
+    JsonValue _document;  // Parsed glTF JSON
+    std::filesystem::path _path;  // File being loaded, for messages
+    std::vector<MappedFile> _files;  // .glb file or external .bin buffers, mapped
+    std::vector<std::vector<std::byte>> _decodedBuffers;  // Buffers given as base64 data URIs
+    std::vector<std::span<const std::byte>> _buffers;  // Bytes of each buffer, in a mapping or a decoded buffer
+    std::vector<MeshData> _meshes;  // Decoded meshes, in glTF order
+    std::vector<Material> _materials;  // Decoded materials, in glTF order
+    std::vector<Image> _images;  // Decoded images, in glTF order; released by CreateMeshes after upload
+    std::vector<Instance> _instances;  // Nodes of the scene that draw a mesh
+    Stats _stats;
+};
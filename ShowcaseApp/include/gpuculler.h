@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "indirectrenderer.h"
+#include "mesh.h"
+#include "shader.h"
+
+// Object-space bounds of one object, std430 layout matching ObjectBounds in cull.comp
+struct GpuObjectBounds {
+    glm::vec4 Min;  // Box minimum in xyz
+    glm::vec4 Max;  // Box maximum in xyz
+    glm::vec4 Center;  // Bounding sphere centre in xyz, where the level of detail is measured like Mesh::GetLodFor
+};
+
+// One sub-mesh of one level of detail of one object that cull.comp may emit, std430 layout matching Candidate
+struct GpuDrawCandidate {
+    DrawElementsIndirectCommand Command;  // BaseInstance is the draw ID of the object's level
+    uint32_t Object;  // Index into the bounds buffer
+    uint32_t Batch;  // Counter the survivor increments
+    uint32_t OutputFirst;  // First command of the batch's range in the output buffer
+    float Error;  // Geometric error of the level, 0 for level 0 so it is always fine enough
+    float NextError;  // Geometric error of the next coarser level, FLT_MAX for the coarsest
+};
+static_assert(sizeof(GpuDrawCandidate) == 40, "GpuDrawCandidate must match Candidate in cull.comp");
+
+// GPU-driven submission. Bounds, transforms and every candidate draw (each sub-mesh of each level of each mesh)
+// live in shader storage buffers built once; each frame a compute shader tests every candidate against the
+// frustum and a depth pyramid of the previous frame, picks levels of detail, and compacts the survivors into
+// per-batch ranges of an indirect command buffer that is drawn with no readback. The CPU's per-frame work is
+// one dispatch and one multi-draw per batch, plus uploading the transforms of meshes that moved.
+//
+// Occlusion uses the previous frame's depth projected with the previous frame's camera, so an object that
+// comes out from behind an occluder can be missing for one frame.
+class GpuCuller {
+public:
+    static constexpr GLuint BoundsBinding = 2;  // Shader storage binding of the object boxes
+    static constexpr GLuint CandidateBinding = 3;  // Shader storage binding of the candidate draws
+    static constexpr GLuint CommandBinding = 4;  // Shader storage binding of the output commands
+    static constexpr GLuint CountBinding = 5;  // Shader storage binding of the per-batch survivor counts
+    static constexpr uint32_t WorkgroupSize = 64;  // local_size_x of cull.comp
+
+    explicit GpuCuller(const Path& shaderDirectory);  // Loads cull.comp and depth_pyramid.comp from the directory
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // Upload the boxes, transforms and candidate draws of meshes, replacing any earlier set. Call again when
+    // meshes are added or removed or their sub-meshes change; moving meshes only needs UpdateTransforms.
+    void Build(const std::vector<Mesh>& meshes);
+    void UpdateTransforms(const std::vector<Mesh>& meshes);  // Upload the draw data of meshes whose Transform changed
+    uint32_t GetObjectCount() const { return static_cast<uint32_t>(_objects.size()); }
+    uint32_t GetCandidateCount() const { return static_cast<uint32_t>(_candidates.size()); }
+
+    void Cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+              float pixelTolerance = Mesh::DefaultPixelTolerance);  // Dispatch the cull shader for this frame
+    // Draw the survivors of the last Cull with a shader built on indirect_shader.vert whose view and projection
+    // are already set; meshes without an arena are drawn one by one. Returns the number of draw calls issued.
+    uint32_t Draw(std::vector<Mesh>& meshes, Shader& shader, IndirectRenderer& renderer);
+    // Copy the read framebuffer's depth after the frame is drawn and rebuild the pyramid next frame's Cull tests against
+    void CaptureDepth(int width, int height);
+
+    void SetOcclusionEnabled(bool enabled) { _occlusionEnabled = enabled; }
+    std::vector<uint32_t> ReadDrawCounts() const;  // Survivors per batch of the last Cull; waits for the GPU, so for tests only
+
+private:
+    struct Object {
+        uint32_t FirstDraw{ 0 };  // First draw ID of the object; one per level of detail
+        uint32_t LevelCount{ 0 };  // Levels, and so draw IDs, of the object
+        glm::mat4 Transform{ 0.0f };  // Transform last uploaded
+    };
+
+    struct Batch {
+        GeometryArena* Arena{ nullptr };  // Arena whose VAO and element buffer the batch draws from
+        GLenum IndexType{ GL_UNSIGNED_INT };  // Index type shared by every command in the batch
+        TextureSet Textures;  // Texture set shared by every draw in the batch
+        std::vector<GLuint> TextureHandles;  // GL names of the texture set, used as the batch key
+        uint32_t First{ 0 };  // First command of the batch's range in the output buffer
+        uint32_t Capacity{ 0 };  // Candidates that may land in the batch
+    };
+
+    void resizePyramid(int width, int height);
+
+private:
+    Shader _cullShader;  // cull.comp
+    Shader _pyramidShader;  // depth_pyramid.comp
+    GLuint _drawDataBuffer{};  // GL_SHADER_STORAGE_BUFFER of ObjectConstants, one per object level
+    GLuint _boundsBuffer{};  // GL_SHADER_STORAGE_BUFFER of GpuObjectBounds, one per object
+    GLuint _candidateBuffer{};  // GL_SHADER_STORAGE_BUFFER of GpuDrawCandidate
+    GLuint _commandBuffer{};  // Output commands, written by cull.comp and read as GL_DRAW_INDIRECT_BUFFER
+    GLuint _countBuffer{};  // Survivors per batch, written by cull.comp and read as GL_PARAMETER_BUFFER
+
+    std::vector<Object> _objects;  // One per mesh, in mesh order
+    std::vector<GpuDrawCandidate> _candidates;  // Every draw the cull shader may emit
+    std::vector<Batch> _batches;  // Draws sharing an arena, index type and texture set
+    std::vector<uint32_t> _standalone;  // Meshes without an arena, drawn on the CPU path
+    uint32_t _drawCount{ 0 };  // Draw IDs in use
+
+    GLuint _depthTexture{};  // Copy of the last frame's depth buffer
+    GLuint _pyramidTexture{};  // Farthest depth per texel, level 0 at the next power of two of the depth size
+    glm::ivec2 _depthSize{ 0 };  // Pixels of the depth copy
+    glm::ivec2 _pyramidSize{ 0 };  // Texels of the pyramid's level 0
+    int _pyramidLevels{ 0 };  // Levels in the pyramid
+    bool _pyramidValid{ false };  // The pyramid holds a frame that matches _previousViewProjection
+    bool _occlusionEnabled{ true };  // Test against the pyramid when one is available
+    glm::mat4 _viewProjection{ 1.0f };  // Camera of the last Cull
+    glm::mat4 _previousViewProjection{ 1.0f };  // Camera of the frame in the pyramid
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "constantbuffers.h"
+#include "mesh.h"
+#include "shader.h"
+#include "streambuffer.h"
+
+// Layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    uint32_t Count;  // Number of indices to draw
+    uint32_t InstanceCount;  // Number of instances to draw
+    uint32_t FirstIndex;  // First index inside the bound element buffer
+    int32_t BaseVertex;  // Value added to every index
+    uint32_t BaseInstance;  // First instance; doubles as the draw ID that indexes the transform buffer
+};
+
+// Submits every sub-mesh that shares a geometry arena, an index type and a texture set with one glMultiDrawElementsIndirect call.
+// Per-draw model matrices and vertex decode parameters live in a shader storage buffer indexed by a per-instance draw ID attribute.
+class IndirectRenderer {
+public:
+    static constexpr GLuint DrawIdAttribute = 4;  // Vertex attribute location of the draw ID stream
+    static constexpr GLuint TransformBinding = ConstantBuffers::ObjectBinding;  // Shader storage binding of the per-draw ObjectConstants
+
+    explicit IndirectRenderer(StreamBuffer* stream = nullptr);  // Commands and draw data go through the stream buffer when given
+    ~IndirectRenderer();
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // Draw the meshes and return the number of draw calls issued. When visible is given, meshes whose entry is 0 are skipped.
+    uint32_t Draw(std::vector<Mesh>& meshes, Shader& shader, std::span<const uint8_t> visible = {});
+    // Make the arena's VAO read draw IDs 0 to drawCount - 1 through base instances, for commands built elsewhere
+    void BindDrawIds(GeometryArena* arena, uint32_t drawCount);
+
+private:
+    struct BatchItem {
+        uint32_t Mesh;  // Index into the mesh list
+        uint32_t SubMesh;  // Sub-mesh of the mesh's selected level
+    };
+
+    struct Batch {
+        GeometryArena* Arena{ nullptr };  // Arena whose VAO and element buffer the batch draws from
+        GLenum IndexType{ GL_UNSIGNED_INT };  // Index type shared by every command in the batch
+        const TextureSet* Textures{ nullptr };  // Texture set shared by every draw in the batch
+        std::vector<GLuint> TextureHandles;  // GL names of the texture set, used as the batch key
+        std::vector<BatchItem> Items;  // Sub-meshes drawn by the batch, one command each
+    };
+
+    void reserveDraws(uint32_t drawCount);  // Grow the draw ID stream to cover drawCount draws
+    void attachDrawIds(GeometryArena* arena);  // Attach the draw ID stream to an arena's VAO
+
+private:
+    StreamBuffer* _stream{ nullptr };  // Per-frame ring for commands and draw data, if any
+    GLuint _commandBuffer{};  // GL_DRAW_INDIRECT_BUFFER holding one command per draw, without a stream buffer
+    GLuint _transformBuffer{};  // GL_SHADER_STORAGE_BUFFER holding one ObjectConstants per draw, without a stream buffer
+    GLuint _drawIdBuffer{};  // Sequential draw IDs read with a divisor of 1
+    uint32_t _drawIdCapacity{ 0 };  // Number of IDs in the draw ID stream
+    std::vector<GLuint> _attachedArrays;  // VAOs that already source the draw ID stream
+
+    std::vector<Batch> _batches;  // Per-frame batches, reused to avoid reallocating
+    std::vector<DrawElementsIndirectCommand> _commands;  // Per-frame commands, grouped by batch
+    std::vector<ObjectConstants> _drawData;  // Per-frame draw data, indexed by draw ID
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "frustum.h"
+#include "mesh.h"
+#include "occlusionbuffer.h"
+#include "shader.h"
+
+// Per-instance shader storage entry, std430 layout matching InstanceData in instanced_shader.vert
+struct InstanceData {
+    glm::mat4 Model;  // Model matrix of the copy
+    glm::vec4 Color;  // Multiplies the vertex color
+};
+static_assert(offsetof(InstanceData, Model) == 0, "InstanceData must match the std430 InstanceData struct");
+static_assert(offsetof(InstanceData, Color) == 64, "InstanceData must match the std430 InstanceData struct");
+static_assert(sizeof(InstanceData) == 80, "InstanceData must match the std430 InstanceData struct");
+
+// Many copies of one mesh drawn with instanced draws. Every frame the copies are binned by the level of detail
+// their size on screen calls for, and each bin reads its own range of a shader storage buffer, so the group
+// costs one draw per level and material in use however many copies it holds.
+class InstanceGroup {
+public:
+    static constexpr GLuint InstanceBinding = 1;  // Shader storage binding of the per-instance data
+
+    explicit InstanceGroup(Mesh mesh);  // Take ownership of the mesh every copy shares
+    ~InstanceGroup();
+
+    InstanceGroup(const InstanceGroup&) = delete;
+    InstanceGroup& operator=(const InstanceGroup&) = delete;
+    InstanceGroup(InstanceGroup&& other) noexcept;
+    InstanceGroup& operator=(InstanceGroup&& other) noexcept;
+
+    uint32_t Add(const glm::mat4& transform, glm::vec4 color = glm::vec4(1.0f));  // Add a copy and return its index
+    void SetTransform(uint32_t instance, const glm::mat4& transform) { _instances[instance].Model = transform; }
+    void SetColor(uint32_t instance, glm::vec4 color) { _instances[instance].Color = color; }
+    void Clear() { _instances.clear(); }
+    uint32_t GetInstanceCount() const { return static_cast<uint32_t>(_instances.size()); }
+    Mesh& GetMesh() { return _mesh; }
+
+    // Draw every copy inside the view frustum, and not hidden in occlusion if one is given, with a shader built on
+    // instanced_shader.vert whose view and projection are already set. Returns the number of draw calls issued.
+    uint32_t Draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                  const OcclusionBuffer* occlusion = nullptr);
+    uint64_t GetTriangleCount() const { return _triangleCount; }  // Triangles drawn by the last Draw
+    uint32_t GetVisibleCount() const { return _visibleCount; }  // Copies drawn by the last Draw
+    uint32_t GetOccludedCount() const { return _occludedCount; }  // Copies inside the frustum but hidden in the last Draw
+
+private:
+    Mesh _mesh;  // Geometry and materials shared by every copy
+    std::vector<InstanceData> _instances;  // Copies in the order they were added
+    std::vector<InstanceData> _binned;  // Per-frame copies grouped by level, each bin at an aligned offset
+    std::vector<uint32_t> _levels;  // Per-frame level of each copy
+    FrustumCuller _culler;  // Per-frame world-space boxes of the copies
+    std::vector<uint8_t> _visible;  // Per-frame frustum test result of each copy
+    uint32_t _visibleCount{ 0 };  // Copies drawn by the last Draw
+    uint32_t _occludedCount{ 0 };  // Copies hidden behind occluders in the last Draw
+    GLuint _instanceBuffer{};  // GL_SHADER_STORAGE_BUFFER holding _binned
+    size_t _binGranularity{ 1 };  // Entries each bin's first copy is a multiple of, from the storage offset alignment
+    uint64_t _triangleCount{ 0 };  // Triangles drawn by the last Draw
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only JSON document model, enough for asset descriptions such as glTF. Lookups never fail: a missing
+// member or out of range element yields a null value, and the typed accessors fall back to a default.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    static bool Parse(std::string_view text, JsonValue& value);  // Parse a whole document; false, with the offset logged, if malformed
+
+    Type GetType() const { return _type; }
+    bool IsNull() const { return _type == Type::Null; }
+    bool IsNumber() const { return _type == Type::Number; }
+    bool IsString() const { return _type == Type::String; }
+    bool IsArray() const { return _type == Type::Array; }
+    bool IsObject() const { return _type == Type::Object; }
+
+    bool AsBool(bool fallback = false) const { return _type == Type::Bool ? _bool : fallback; }
+    double AsNumber(double fallback = 0.0) const { return _type == Type::Number ? _number : fallback; }
+    int64_t AsInt(int64_t fallback = -1) const { return _type == Type::Number ? static_cast<int64_t>(_number) : fallback; }
+    std::string_view AsString() const { return _string; }  // Empty unless the value is a string
+
+    size_t Size() const { return _elements.size(); }  // Elements of an array or members of an object
+    const JsonValue& operator[](size_t index) const;  // Array element, or null
+    const JsonValue& operator[](std::string_view key) const;  // Object member, or null
+    bool Has(std::string_view key) const { return !(*this)[key].IsNull(); }
+    const std::vector<JsonValue>& GetElements() const { return _elements; }  // Array elements or object member values
+    const std::string& GetKey(size_t member) const { return _keys[member]; }  // Name of an object member
+
+private:
+    friend class JsonParser;
+
+    Type _type{ Type::Null };
+    bool _bool{ false };
+    double _number{ 0.0 };
+    std::string _string;
+    std::vector<JsonValue> _elements;  // Array elements, or object member values in document order
+    std::vector<std::string> _keys;  // Object member names, parallel to _elements
+};
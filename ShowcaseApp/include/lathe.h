@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mesh.h>
+#include "meshoptimizer.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Surface of revolution: a 2D profile swept around the y axis. Consecutive profile segments share their rings,
+// so the surface has no hidden interior caps and no cracks; only the two ends of the profile are capped.
+// Triangles are counter-clockwise seen from outside and grouped into one sub-mesh per material.
+class Lathe
+{
+public:
+    struct ProfilePoint {
+        float Radius{ 0.0f };  // Distance from the axis
+        float Height{ 0.0f };  // Position along the axis
+        uint32_t Material{ 0 };  // Material of the segment from this point to the next
+    };
+
+    static constexpr float CreaseCosine = 0.5f;  // Profile corners sharper than 60 degrees get a normal per side
+
+    struct LodLevel;
+
+    Lathe() = default;  // Empty lathe, to be assigned a generated one
+    Lathe(std::vector<ProfilePoint> profile, int sectors, bool capBottom = true, bool capTop = true);  // Sweep a profile given bottom to top
+
+    static std::vector<ProfilePoint> SmoothProfile(std::span<const ProfilePoint> controlPoints, int subdivisions);  // Catmull-Rom spline through the points
+    static std::vector<LodLevel> CreateLodLevels(const std::vector<ProfilePoint>& profile, float chordTolerance,
+                                                 MeshOptimizer::Report* report = nullptr);  // Optimized chord-error LOD chain on the CPU, finest first
+    static Mesh CreateLodMesh(const std::vector<ProfilePoint>& profile, float chordTolerance, GeometryArena* arena = nullptr,
+                              MeshOptimizer::Report* report = nullptr);  // Optimized mesh with a chord-error LOD chain; report gets level 0's figures
+
+    Mesh GetMesh(GeometryArena* arena = nullptr) const&;  // Mesh with one sub-mesh per material
+    Mesh GetMesh(GeometryArena* arena = nullptr) &&;  // Same, moving the generated geometry into the mesh
+    MeshOptimizer::Report Optimize();  // Reorder each material range for the vertex cache and overdraw, then the vertices for fetch
+    const std::vector<Vertex>& GetVertices() const { return vertices; }  // Function to get the vertices of the lathe
+    const std::vector<uint32_t>& GetIndices() const { return indices; }  // Function to get the indices of the lathe
+    const std::vector<SubMesh>& GetSubMeshes() const { return subMeshes; }  // Material ranges of the indices
+
+private:
+    std::vector<ProfilePoint> profile;  // Profile swept around the axis, bottom to top
+    int sectors{ 0 };  // Number of sectors around the axis
+    bool capBottom{ true };  // Close the first profile point with a disc
+    bool capTop{ true };  // Close the last profile point with a disc
+
+    std::vector<Vertex> vertices;  // Vector to store the vertices of the lathe
+    std::vector<uint32_t> indices;  // Vector to store the indices of the lathe, sorted by material
+    std::vector<SubMesh> subMeshes;  // One range per material that has triangles
+
+    void generate();  // Function to generate the rings, caps and material ranges
+};
+
+// One level of a lathe's LOD chain, before it is uploaded
+struct Lathe::LodLevel {
+    Lathe Geometry;  // Optimized geometry of the level
+    float GeometricError{ 0.0f };  // Chord error of the level in object units
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+// Sector counts for a surface of revolution, finest first, chosen from a bound on the chord error:
+// the distance between a circle of the given radius and the polygon that approximates it.
+class LodChain {
+public:
+    static constexpr int MinSectors = 6;  // Coarsest level still reads as round
+    static constexpr int MaxSectors = 1024;  // Cap for tolerances too small to be useful
+
+    struct Level {
+        int Sectors;  // Sector count of the level
+        float ChordError;  // Largest distance from the polygon to the true surface, in object units
+    };
+
+    static float ChordError(float radius, int sectors);  // r * (1 - cos(pi / n))
+    static int SectorsForChordError(float radius, float tolerance);  // Fewest sectors whose chord error is within tolerance
+    static std::vector<Level> FromChordTolerance(float radius, float tolerance, int maxLevels = 4);  // Halve the sector count per level
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read-only view of a whole file through the OS page cache; move-only so the mapping is released exactly once.
+// Pages are only read from disk when first touched, and the mapping address stays fixed until Close.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::filesystem::path& path);  // Map the file, closing any previous mapping; false if it cannot be mapped
+    void Close();
+
+    bool IsOpen() const { return _data != nullptr; }
+    std::span<const std::byte> GetData() const { return { _data, _size }; }
+
+private:
+    const std::byte* _data{ nullptr };  // Start of the mapping
+    size_t _size{ 0 };  // Bytes mapped
+#ifdef _WIN32
+    void* _file{ nullptr };  // HANDLE of the open file
+    void* _mapping{ nullptr };  // HANDLE of the file mapping object
+#endif
+};
@@ -1,39 +1,119 @@
 #pragma once
 
+#include <span>
 #include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glad/glad.h>
 #include "types.h"
+#include "bounds.h"
 #include "texture.h"
+#include "geometryarena.h"
+#include "vertexformat.h"
 
+// Contiguous run of a mesh's indices drawn with one material
+struct SubMesh {
+    uint32_t FirstIndex{ 0 };  // First index of the run, relative to the mesh's own indices
+    uint32_t IndexCount{ 0 };  // Number of indices in the run
+    uint32_t Material{ 0 };  // Index into the mesh's materials
+};
+
+// Owns its GPU geometry (private buffers or an arena allocation); move-only so it is released exactly once.
 class Mesh {
 public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);  // Constructor with vertices and indices
+    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, GeometryArena* arena = nullptr);  // Constructor with vertices, indices and an optional shared arena
+    Mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryArena* arena = nullptr);  // Constructor viewing data that outlives the mesh, such as the constexpr Shapes tables
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
 
-    void Draw();  // Function to draw the mesh
+    void Draw();  // Function to draw every sub-mesh at the selected level of detail
+    void DrawSubMesh(uint32_t subMesh, uint32_t instanceCount = 1);  // Draw one sub-mesh at the selected level of detail
+    void SubmitSubMesh(uint32_t subMesh, uint32_t instanceCount = 1) const;  // DrawSubMesh for callers that already bound GetVertexArray()
+    GLuint GetVertexArray() const;  // VAO the selected level draws from: the arena's or the mesh's own
+    void DrawInstanced(uint32_t instanceCount);  // Draw every sub-mesh instanceCount times; the shader tells copies apart by gl_InstanceID
     glm::mat4 Transform{ 1.0f };  // Transformation matrix for the mesh
+    bool Static{ false };  // Never moves after setup, so StaticBatch may bake the transform into its vertices
+    bool Occluder{ false };  // Large and solid enough to hide other objects; rasterized into the CPU occlusion buffer
     float GetHeight() const { return _height; }  // Method to retrieve the mesh height
 
-    std::vector<Vertex> GetVertices() const { return _vertices; }  // Function to get the vertices of the mesh
-    std::vector<uint32_t> GetIndices() const { return _indices; }  // Function to get the indices of the mesh
+    // Object-space bounds cover every level of detail; the world-space box follows Transform and is only
+    // recomputed when Transform has changed since the last call
+    const BoundingBox& GetBounds() const { return _bounds; }
+    const BoundingSphere& GetBoundingSphere() const { return _sphere; }
+    const BoundingBox& GetWorldBounds() const;
+
+    std::span<const Vertex> GetVertices() const { return _vertices; }  // Function to get the vertices of the mesh
+    std::span<const uint32_t> GetIndices() const { return _indices; }  // Function to get the indices of the mesh
+
+    void SetColor(glm::vec3 color);  // Function to set the color of the CPU-side vertices, copying viewed data first
+    void SetTextures(TextureSet textures) { _materials.assign(1, std::move(textures)); }  // Use one material for the whole mesh
+    const TextureSet& GetTextures() const { return GetMaterial(0); }
+
+    // Materials are texture sets shared by every level of detail; sub-meshes pick one by index. A mesh starts
+    // with a single sub-mesh covering all of its indices with material 0.
+    void SetMaterials(std::vector<TextureSet> materials) { _materials = std::move(materials); }
+    const TextureSet& GetMaterial(uint32_t material) const;  // Empty set when the material is out of range
+    void SetSubMeshes(std::vector<SubMesh> subMeshes) { _subMeshes = std::move(subMeshes); }  // Ranges of this level
+    std::span<const SubMesh> GetSubMeshes() const { return active()._subMeshes; }  // Ranges of the selected level
 
-    void SetColor(glm::vec3 color) {  // Function to set the color of the mesh
-        for (auto& vertex : _vertices) {
-            vertex.Color = color;
-        }
-    }
-    void SetTextures(const std::vector<Texture>& textures) { _textures = textures; }
-    std::vector<Texture>& GetTextures() { return _textures; }
+    // Coarser levels of detail, each with the geometric error it introduces in object units. Levels are
+    // added finest to coarsest; this mesh itself is level 0. The GPU accessors below follow the selected level.
+    void AddLod(Mesh lod, float geometricError);
+    void SetGeometricError(float geometricError) { _geometricError = geometricError; }  // Error of level 0
+    uint32_t SelectLod(const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                       float pixelTolerance = DefaultPixelTolerance);  // Pick the coarsest level within the tolerance on screen
+    uint32_t GetLodFor(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                       float pixelTolerance = DefaultPixelTolerance) const;  // Same choice for a copy at transform, without hysteresis
+    uint32_t GetLodCount() const { return static_cast<uint32_t>(_lods.size()) + 1; }
+    uint32_t GetActiveLod() const { return _activeLod; }
+    uint32_t GetTriangleCount() const;  // Triangles drawn by the sub-meshes of the selected level
+    const Mesh& GetLod(uint32_t level) const { return level == 0 ? *this : _lods[level - 1]; }  // Level 0 is this mesh
+    Mesh& GetLod(uint32_t level) { return level == 0 ? *this : _lods[level - 1]; }
+    float GetGeometricError(uint32_t level) const { return GetLod(level)._geometricError; }  // Object-space error of a level
+
+    const VertexQuantization& GetQuantization() const { return active()._quantization; }  // Decode parameters for packed vertices
+    bool HasPackedVertices() const { return GetArena() && GetArena()->GetVertexFormat() == VertexFormat::Packed; }
+
+    GeometryArena* GetArena() const { return active()._arena; }  // Arena the mesh was allocated from, if any
+    GeometryArena::Handle GetArenaHandle() const { return active()._arenaHandle; }  // Handle of the mesh's ranges in the arena
+
+    static constexpr float DefaultPixelTolerance = 1.0f;  // Screen-space error allowed before a finer level is used
+    static constexpr float LodHysteresis = 0.75f;  // A coarser level must be this far inside the tolerance before switching to it
+
+private:
+    void initialize(GeometryArena* arena);  // Upload the viewed vertices and indices
+    void release();  // Give the GPU geometry back
+    float pixelsPerUnit(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection,
+                        float viewportHeight) const;  // Screen pixels covered by one object unit at the centre of the bounds
+    const Mesh& active() const { return GetLod(_activeLod); }  // Selected level of detail
 
 private:
     uint32_t _elementCount{ 0 };  // Number of elements (indices)
+    GLenum _indexType{ GL_UNSIGNED_INT };  // Type of the private element buffer
     GLuint _vertexBufferObject{};  // Vertex buffer object
     GLuint _vertexArrayObject{};  // Vertex array object
     GLuint _elementBufferObject{};  // Element buffer object
+    GeometryArena* _arena{ nullptr };  // Shared arena holding the mesh's geometry, or null for private buffers
+    GeometryArena::Handle _arenaHandle{ GeometryArena::InvalidHandle };  // Handle of the mesh's ranges in the arena
     float _height{ 0.0f };  // Height of the mesh
+    BoundingBox _bounds;  // Object-space box around this level and every coarser one
+    BoundingSphere _sphere;  // Object-space sphere around the same points, centred on _bounds
+    mutable BoundingBox _worldBounds;  // _bounds transformed by _worldBoundsTransform
+    mutable glm::mat4 _worldBoundsTransform{ 0.0f };  // Transform _worldBounds was computed for; zero forces the first update
+    VertexQuantization _quantization;  // Identity unless the vertices were packed
+
+    std::vector<Vertex> _ownedVertices;  // Storage for vertices handed over by value; empty when viewing external data
+    std::vector<uint32_t> _ownedIndices;  // Storage for indices handed over by value; empty when viewing external data
+    std::span<const Vertex> _vertices;  // Vertices of the mesh, in _ownedVertices or in external read-only data
+    std::span<const uint32_t> _indices;  // Indices of the mesh, in _ownedIndices or in external read-only data
+    std::vector<TextureSet> _materials;  // Texture sets of the mesh, shared with other meshes
+    std::vector<SubMesh> _subMeshes;  // Material ranges of this level's indices
 
-    std::vector<Vertex> _vertices;  // Vector to store the vertices of the mesh
-    std::vector<uint32_t> _indices;  // Vector to store the indices of the mesh
-    std::vector<Texture> _textures; // Vector to store textures associated with the mesh
+    float _geometricError{ 0.0f };  // Object-space error of this level relative to the true surface
+    std::vector<Mesh> _lods;  // Coarser levels, finest first
+    uint32_t _activeLod{ 0 };  // Selected level; 0 is this mesh
 };
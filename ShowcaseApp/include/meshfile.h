@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "mappedfile.h"
+#include "mesh.h"
+
+// On-disk layout of a precooked mesh (.scmf). Every structure is little-endian and naturally aligned, and the
+// blobs start on Alignment boundaries, so a mapped file is used in place:
+//   MeshFileHeader | MeshFileLod[LodCount] | SubMesh[SubMeshCount] | per level: Vertex[] then uint32_t[] indices
+struct MeshFileAttribute {
+    uint16_t Offset;  // Byte offset inside the vertex
+    uint16_t Components;  // Number of fp32 components
+};
+
+struct MeshFileHeader {
+    static constexpr uint32_t AttributeCount = 5;  // Position, Color, Normal, Uv, Uv2
+
+    uint32_t Magic;  // MeshFile::Magic
+    uint32_t Version;  // MeshFile::Version
+    uint64_t FileSize;  // Total bytes, padding included
+    uint64_t Checksum;  // MeshFile::Checksum of every byte after the header
+    uint32_t LodCount;  // Entries in the LOD table, finest first
+    uint32_t SubMeshCount;  // Entries in the sub-mesh table, shared by every level
+    float BoundsMin[3];  // Object-space bounds of level 0
+    float BoundsMax[3];
+    uint32_t VertexStride;  // Bytes per vertex
+    MeshFileAttribute Attributes[AttributeCount];  // Vertex layout, checked against Vertex on load
+};
+
+struct MeshFileLod {
+    uint64_t VertexOffset;  // Byte offset of the level's vertices from the start of the file
+    uint64_t IndexOffset;  // Byte offset of the level's 32 bit indices from the start of the file
+    uint32_t VertexCount;  // Vertices in the level
+    uint32_t IndexCount;  // Indices in the level
+    uint32_t FirstSubMesh;  // First entry of the level's material ranges in the sub-mesh table
+    uint32_t SubMeshCount;  // Number of material ranges of the level
+    float GeometricError;  // Object-space error of the level
+    uint32_t Padding;
+};
+
+static_assert(std::is_trivially_copyable_v<Vertex> && std::is_trivially_copyable_v<SubMesh>, "Mesh file blobs are used in place");
+static_assert(sizeof(MeshFileHeader) == 80 && sizeof(MeshFileLod) == 40 && sizeof(SubMesh) == 12, "Mesh file layout changed");
+
+// Precooked mesh container: written offline by the mesh cooker, mapped at run time and uploaded straight from
+// the mapping. Meshes created from a file view its pages, so the MeshFile must outlive them.
+class MeshFile {
+public:
+    static constexpr uint32_t Magic = 0x464D4353;  // "SCMF"
+    static constexpr uint32_t Version = 1;  // Bumped on any layout change; older files are rejected and recooked
+    static constexpr uint64_t Alignment = 16;  // Alignment of every blob inside the file
+
+    struct Level {
+        std::span<const Vertex> Vertices;  // Vertices of the level
+        std::span<const uint32_t> Indices;  // Indices of the level, sorted by material range
+        std::span<const SubMesh> SubMeshes;  // Material ranges of the level
+        float GeometricError{ 0.0f };  // Object-space error of the level
+    };
+
+    static bool Write(const std::filesystem::path& path, std::span<const Level> levels);  // Lay out, checksum and write the levels
+    static uint64_t Checksum(std::span<const std::byte> data);  // FNV-1a over 64-bit words, zero-extending the tail
+
+    bool Open(const std::filesystem::path& path);  // Map and validate a file; false, with the reason logged, if unusable
+    Mesh CreateMesh(GeometryArena* arena = nullptr) const;  // Mesh with every level and its material ranges, viewing the mapping
+
+    uint32_t GetLodCount() const { return static_cast<uint32_t>(_levels.size()); }
+    const Level& GetLevel(uint32_t level) const { return _levels[level]; }
+    glm::vec3 GetBoundsMin() const { return _boundsMin; }
+    glm::vec3 GetBoundsMax() const { return _boundsMax; }
+
+private:
+    MappedFile _file;  // Mapping every level views
+    std::vector<Level> _levels;  // Spans into the mapping
+    glm::vec3 _boundsMin{ 0.0f };  // Object-space bounds of level 0
+    glm::vec3 _boundsMax{ 0.0f };
+};
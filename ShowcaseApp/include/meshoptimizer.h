@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+// Index and vertex reordering passes that work on any triangle list.
+class MeshOptimizer {
+public:
+    static constexpr uint32_t DefaultCacheSize = 16;  // FIFO size the passes and the analysis model
+
+    struct CacheStats {
+        float Acmr{ 0.f };  // Average cache miss ratio: transformed vertices per triangle
+        float Atvr{ 0.f };  // Average transform to vertex ratio: transformed vertices per referenced vertex
+    };
+
+    struct Report {
+        CacheStats Before;  // Cache behaviour of the input
+        CacheStats After;  // Cache behaviour of the output
+        uint32_t VerticesBefore{ 0 };  // Vertex count of the input
+        uint32_t VerticesAfter{ 0 };  // Vertex count after welding and dropping unreferenced vertices
+        uint32_t Clusters{ 0 };  // Number of clusters the overdraw pass sorted
+    };
+
+    static Report Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                           uint32_t cacheSize = DefaultCacheSize);  // Run every pass below in order
+
+    static CacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                         uint32_t cacheSize = DefaultCacheSize);  // Simulate a FIFO post-transform cache
+
+    static void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);  // Merge bitwise-identical vertices
+    static std::vector<uint32_t> OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                                     uint32_t cacheSize = DefaultCacheSize);  // Forsyth reorder; returns cluster start triangles
+    static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                 const std::vector<uint32_t>& clusters);  // Order clusters outside-in
+    static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);  // Renumber vertices in first-use order
+};
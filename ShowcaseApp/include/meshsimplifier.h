@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "types.h"
+
+class Mesh;
+class GeometryArena;
+
+// Quadric edge-collapse simplification for any indexed triangle list. Each collapse moves a vertex onto one of its
+// neighbours, so the output only references input vertices; vertices on open borders and attribute seams
+// (UV, normal or color splits sharing a position) stay in place.
+class MeshSimplifier {
+public:
+    struct Options {
+        uint32_t TargetTriangleCount{ 0 };  // Stop once at most this many triangles remain
+        float TargetError{ FLT_MAX };  // Never collapse further than this object-space distance from the input surface
+        float AttributeWeight{ 1.0f };  // Weight of the normal, UV and color change relative to the position error
+        uint32_t ThreadCount{ 1 };  // Above 1, slabs along the longest axis are simplified in parallel with their shared vertices locked
+    };
+
+    struct Result {
+        std::vector<Vertex> Vertices;  // Vertices still referenced, in first-use order
+        std::vector<uint32_t> Indices;  // Simplified triangle list
+        float Error{ 0.0f };  // Largest collapse error, in object units
+    };
+
+    static Result Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const Options& options);
+
+    // Append levelCount coarser levels to a mesh, each with reduction times the previous level's triangles,
+    // optimized for the vertex cache and ready for Mesh::SelectLod. Stops early once a level no longer shrinks.
+    static uint32_t GenerateLods(Mesh& mesh, GeometryArena* arena, uint32_t levelCount, float reduction, Options options);
+    static uint32_t GenerateLods(Mesh& mesh, GeometryArena* arena, uint32_t levelCount = 3, float reduction = 0.5f) {
+        return GenerateLods(mesh, arena, levelCount, reduction, Options());
+    }
+};
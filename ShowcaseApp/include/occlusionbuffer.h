@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.h"
+#include "mesh.h"
+#include "types.h"
+
+// Low-resolution depth buffer rasterized on the CPU from a few large occluder meshes, used to skip objects
+// hidden behind them before anything is submitted. Depth is stored in 8x8 pixel tiles so each tile is one
+// contiguous block that a thread owns outright: triangles are binned to the tiles they touch and the covered tiles
+// are rasterized in parallel on the shared worker pool, four pixels at a time with SSE2. Each tile also keeps its farthest depth, which lets
+// most occludee tests settle a whole tile with one comparison.
+class OcclusionBuffer {
+public:
+    static constexpr uint32_t TileWidth = 8;  // Pixels per tile row
+    static constexpr uint32_t TileHeight = 8;  // Rows per tile
+    static constexpr uint32_t DefaultWidth = 320;  // Horizontal resolution the application rasterizes at
+
+    void Resize(uint32_t width, uint32_t height);  // Rounded up to whole tiles; does nothing if that size is unchanged
+    uint32_t GetWidth() const { return _width; }
+    uint32_t GetHeight() const { return _height; }
+
+    void Begin(const glm::mat4& viewProjection);  // Clear the depth and the queued occluders for a new view
+    void AddOccluder(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const glm::mat4& transform);
+    void AddOccluder(const Mesh& mesh);  // The mesh's coarsest level of detail at its Transform
+    void Rasterize(uint32_t threadCount = 0);  // Draw every queued triangle; 0 uses every thread of the shared pool, few triangles use one
+
+    // False only when every pixel the box covers holds an occluder nearer than the box's nearest point.
+    // Boxes crossing the near plane or outside the screen are reported visible and left to frustum culling.
+    bool IsVisible(const BoundingBox& worldBox) const;
+
+    float GetDepth(uint32_t x, uint32_t y) const;  // Window depth in [0, 1] of one pixel, 1 where nothing was drawn
+    uint32_t GetTriangleCount() const { return static_cast<uint32_t>(_triangles.size()); }  // Triangles queued since Begin
+
+private:
+    struct Triangle {
+        glm::vec3 EdgeX, EdgeY, EdgeOffset;  // Edge functions, positive inside: EdgeX * x + EdgeY * y + EdgeOffset
+        glm::vec3 DepthPlane;  // Depth = x * DepthPlane.x + y * DepthPlane.y + DepthPlane.z
+        int MinX, MinY, MaxX, MaxY;  // Pixel bounds clamped to the buffer
+    };
+
+    void addTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c);  // Clip against the near plane and queue what is left
+    void setupTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);  // Queue one triangle given in pixels and window depth
+    void rasterizeTile(uint32_t tile);
+
+private:
+    uint32_t _width{ 0 };  // Pixels, a multiple of TileWidth
+    uint32_t _height{ 0 };  // Pixels, a multiple of TileHeight
+    uint32_t _tilesX{ 0 };  // Tiles per row
+    uint32_t _tilesY{ 0 };  // Rows of tiles
+    glm::mat4 _viewProjection{ 1.0f };  // View given to Begin
+    std::vector<float> _depth;  // TileWidth * TileHeight values per tile, tile after tile, rows within a tile
+    std::vector<float> _tileMaxDepth;  // Farthest depth stored in each tile
+    std::vector<Triangle> _triangles;  // Occluder triangles queued since Begin
+    std::vector<std::vector<uint32_t>> _bins;  // Triangles touching each tile, reused between frames
+    std::vector<uint32_t> _activeTiles;  // Tiles with a non-empty bin, handed out to the worker threads
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join helper: splits [0, count) into one contiguous chunk per thread and runs body(begin, end) on each.
+struct Parallel {
+    static uint32_t GetThreadCount(uint32_t requested = 0)  // 0 asks for one thread per hardware thread
+    {
+        if (requested > 0) {
+            return requested;
+        }
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    template <typename Body>
+    static void For(size_t count, Body&& body, uint32_t threadCount = 0)
+    {
+        auto threads = static_cast<size_t>(std::min<size_t>(GetThreadCount(threadCount), count));
+        if (threads <= 1) {
+            if (count > 0) {
+                body(size_t{ 0 }, count);
+            }
+            return;
+        }
+
+        // The calling thread takes the first chunk instead of idling in join
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        auto chunk = (count + threads - 1) / threads;
+        for (size_t t = 1; t < threads; t++) {
+            auto begin = t * chunk;
+            auto end = std::min(count, begin + chunk);
+            if (begin < end) {
+                workers.emplace_back([&body, begin, end]() { body(begin, end); });
+            }
+        }
+        body(size_t{ 0 }, std::min(count, chunk));
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+};
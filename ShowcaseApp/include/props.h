@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "lathe.h"
+
+// Procedural props shared by the application and the mesh cooker, so a cooked file and its fallback match
+struct Props {
+    static constexpr float BottleScale = 0.90f;  // Scale of the bottle's dimensions and of its transform
+    static constexpr float ChordTolerance = 0.00025f;  // Largest distance from a true circle, in object units
+
+    enum BottleMaterial : uint32_t { BottleLabel, BottleGlass };  // Body with the label, plain glass shoulder and neck
+
+    // The whole bottle is one surface of revolution: the body carries the label, the shoulder and neck are plain glass.
+    // Profile heights start at the base, so the bottle stands on the origin.
+    static std::vector<Lathe::ProfilePoint> BottleProfile()
+    {
+        float bottleRadius = 0.25f * BottleScale; // Reduced radius
+        float bottleHeight = 2.25f * BottleScale; // Reduced height
+        float shoulderRadius = 0.15f * BottleScale; // Radius where the shoulder meets the neck
+        float shoulderHeight = 0.5f * BottleScale; // Reduced height
+        float neckRadius = 0.1f * BottleScale; // Radius of the mouth
+        float neckHeight = 1.5f * BottleScale; // Reduced height
+        return {
+                { bottleRadius, 0.0f, BottleLabel },
+                { bottleRadius, bottleHeight, BottleGlass },
+                { shoulderRadius, bottleHeight + shoulderHeight, BottleGlass },
+                { neckRadius, bottleHeight + shoulderHeight + neckHeight, BottleGlass },
+        };
+    }
+};
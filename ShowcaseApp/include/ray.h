@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Half-line from Origin along Direction. Direction need not be unit length; hit distances are measured in
+// multiples of it, so a ray from a to b with Direction b - a and MaxDistance 1 ends exactly at b.
+struct Ray {
+    glm::vec3 Origin{ 0.0f };
+    glm::vec3 Direction{ 0.0f, 0.0f, -1.0f };
+    float MaxDistance{ FLT_MAX };  // Hits farther along the ray than this are ignored
+
+    glm::vec3 GetPoint(float distance) const { return Origin + Direction * distance; }
+};
+
+// Closest triangle a ray hit, if any
+struct RayHit {
+    static constexpr uint32_t None = UINT32_MAX;  // Object of a ray that hit nothing
+
+    uint32_t Object{ None };  // Index of the mesh that was hit
+    uint32_t Triangle{ 0 };  // Triangle within the mesh's index list, that is first index / 3
+    float Distance{ FLT_MAX };  // Along the ray, in multiples of its Direction
+    glm::vec2 Barycentric{ 0.0f };  // Weights of the triangle's second and third vertices at the hit point
+
+    bool IsHit() const { return Object != None; }
+};
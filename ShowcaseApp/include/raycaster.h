@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bvh.h"
+#include "mesh.h"
+#include "ray.h"
+
+// Four rays traced together, one per SIMD lane, stored as one array per component. Lanes that are not in
+// use have a negative MaxDistance so they fail every test.
+struct RayPacket {
+    static constexpr uint32_t Width = 4;  // Rays per packet
+
+    alignas(16) float OriginX[Width], OriginY[Width], OriginZ[Width];
+    alignas(16) float DirectionX[Width], DirectionY[Width], DirectionZ[Width];
+    alignas(16) float InverseX[Width], InverseY[Width], InverseZ[Width];  // 1 / Direction, for the slab tests
+    alignas(16) float MaxDistance[Width];  // Shrinks to the closest hit so far
+
+    void Set(uint32_t lane, const Ray& ray);  // Load one ray and compute its inverse direction
+    void Clear(uint32_t lane);  // Mark a lane unused
+};
+
+// Closest hits of a packet's rays, one per lane
+struct RayPacketHit {
+    alignas(16) float U[RayPacket::Width], V[RayPacket::Width];  // Barycentric weights of the hit
+    uint32_t Triangle[RayPacket::Width];  // Triangle hit, meaningful only where Object is set
+    uint32_t Object[RayPacket::Width];  // Mesh hit, or RayHit::None
+};
+
+// Bounding volume hierarchy over the triangles of one mesh in object space. Triangles are copied out in leaf
+// order with their edges precomputed, so a leaf's triangles are read contiguously by the ray tests.
+class TriangleBvh {
+public:
+    void Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    uint32_t GetTriangleCount() const { return static_cast<uint32_t>(_triangles.size()); }
+    BoundingBox GetBounds() const;  // Box of every triangle, empty before Build
+
+    // Shorten each lane's MaxDistance to its closest triangle and record it in hits with object as the Object.
+    // With anyHit the search stops for a lane at its first hit, which is enough for line-of-sight tests.
+    void Intersect(RayPacket& packet, RayPacketHit& hits, uint32_t object, bool anyHit = false) const;
+
+private:
+    struct Triangle {
+        glm::vec3 Corner;  // First vertex
+        uint32_t Index;  // Triangle within the mesh's index list
+        glm::vec3 Edge1;  // Second vertex minus the first
+        glm::vec3 Edge2;  // Third vertex minus the first
+    };
+
+private:
+    std::vector<BvhNode> _nodes;  // Copied from the builder's tree; leaves index _triangles directly
+    std::vector<Triangle> _triangles;  // In leaf order
+};
+
+// Raycasts against the triangles of a mesh list: one TriangleBvh per mesh in object space under a Bvh over
+// the meshes' world boxes. Rays are transformed into each mesh's space on the way down, so moving a mesh only
+// refits the top level. Rays are traced in packets of RayPacket::Width with SIMD box and triangle tests, and
+// batches are split across worker threads.
+class Raycaster {
+public:
+    // Build a triangle hierarchy per mesh, in parallel, and the top level over them. Call again when meshes are
+    // added, removed or change shape; for meshes that only moved, UpdateTransforms is enough.
+    void Build(const std::vector<Mesh>& meshes, uint32_t threadCount = 0);
+    void UpdateTransforms(const std::vector<Mesh>& meshes);  // Refit the top level after Transform changes
+    uint32_t GetObjectCount() const { return static_cast<uint32_t>(_objects.size()); }
+
+    RayHit Raycast(const Ray& ray) const;  // Closest triangle along the ray
+    bool HasLineOfSight(glm::vec3 from, glm::vec3 to) const;  // True when no triangle lies between the points
+    // Closest hit of every ray, written to hits (which must be as long as rays). Rays are packed in the order
+    // given, so neighbouring rays should point in similar directions; 0 threads uses one per hardware thread.
+    void RaycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, uint32_t threadCount = 0) const;
+
+private:
+    struct Object {
+        TriangleBvh Triangles;  // Object-space hierarchy
+        glm::mat4 Transform{ 0.0f };  // Transform the object's world box and inverse were computed for
+        glm::mat4 InverseTransform{ 1.0f };  // World to object space
+        BoundingBox LocalBounds;  // Object-space box of the triangles
+    };
+
+    void trace(RayPacket& packet, RayPacketHit& hits, bool anyHit) const;  // Walk the top level and each mesh the packet reaches
+
+private:
+    std::vector<Object> _objects;  // One per mesh, in mesh order
+    Bvh _topLevel;  // Over the objects' world boxes
+};
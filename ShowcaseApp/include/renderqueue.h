@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "shader.h"
+#include "texture.h"
+
+// GL state calls issued while submitting one frame
+struct StateChanges {
+    uint32_t Programs{ 0 };  // glUseProgram
+    uint32_t Textures{ 0 };  // glActiveTexture and glBindTexture pairs
+    uint32_t VertexArrays{ 0 };  // glBindVertexArray
+    uint32_t Uniforms{ 0 };  // glUniform* for samplers and object indices
+
+    uint32_t GetTotal() const { return Programs + Textures + VertexArrays + Uniforms; }
+};
+
+// Draws recorded as 64 bit sort keys plus the mesh and sub-mesh to draw, sorted each frame so draws sharing a
+// program, texture set and vertex array end up next to each other, nearest first. Submission then only issues
+// the state that differs from the previous draw. Key fields, most significant first:
+//
+//   pass (4) | program (8) | texture set (16) | vertex array (12) | depth (24)
+//
+// Programs, texture sets and vertex arrays are numbered in the order the frame first uses them. Each item also
+// carries its full ids, which is what Submit binds from, so a frame with more ids than a field holds still draws
+// correctly: the overflowing ids saturate their field and only lose their grouping in the sort.
+class RenderQueue {
+public:
+    static constexpr uint32_t PassBits = 4;
+    static constexpr uint32_t ProgramBits = 8;
+    static constexpr uint32_t TextureSetBits = 16;
+    static constexpr uint32_t VertexArrayBits = 12;
+    static constexpr uint32_t DepthBits = 24;
+
+    struct Item {
+        uint64_t Key;  // Sort key built by MakeKey
+        uint32_t Mesh;  // Index into the mesh list given to Submit
+        uint32_t SubMesh;  // Sub-mesh of the mesh's selected level
+        uint32_t Program{ 0 };  // Program id, unlike the key's field never saturated
+        uint32_t TextureSet{ 0 };  // Texture set id
+        uint32_t VertexArray{ 0 };  // Vertex array id
+    };
+
+    // Pack the fields, each clamped to the largest value its width holds; depth is clamped to [0, 1] and quantized
+    static uint64_t MakeKey(uint32_t pass, uint32_t program, uint32_t textureSet, uint32_t vertexArray, float depth);
+
+    void Begin(const glm::mat4& viewProjection);  // Drop last frame's draws; depth is measured with this camera
+    // Record every sub-mesh of the mesh's selected level, keyed by its window depth at the centre of its world box
+    void Add(Shader& shader, const Mesh& mesh, uint32_t meshIndex, uint32_t pass = 0);
+    void Add(uint64_t key, uint32_t meshIndex, uint32_t subMesh);  // Record one draw with a ready-made key; its ids are read back from the key
+    void Sort();  // Least significant digit radix sort on the keys, skipping bytes every key shares
+    std::span<const Item> GetItems() const { return _items; }
+    uint32_t GetOverflowCount() const { return _overflows; }  // Draws this frame whose ids did not fit their key fields
+
+    // Draw the sorted items and return the state changes issued. Each draw reads the ObjectConstants entry at its
+    // mesh index, so the caller uploads one entry per mesh in the list before submitting.
+    StateChanges Submit(const std::vector<Mesh>& meshes);
+
+private:
+    template <typename T>
+    static uint32_t idOf(std::vector<T>& table, const T& value);  // Position of value in table, appending it if new
+
+private:
+    glm::mat4 _viewProjection{ 1.0f };  // Camera given to Begin
+    std::vector<Item> _items;  // Draws of this frame, sorted by Sort
+    std::vector<Item> _scratch;  // Ping-pong buffer for the radix passes
+    std::vector<Shader*> _programs;  // Program of each program id
+    std::vector<const TextureSet*> _textureSets;  // Texture set of each texture set id
+    std::vector<std::vector<GLuint>> _textureHandles;  // GL names of each texture set, which is what the ids compare
+    std::vector<GLuint> _vertexArrays;  // VAO of each vertex array id
+    uint32_t _overflows{ 0 };  // Draws added this frame with a saturated key field
+    bool _overflowReported{ false };  // The first overflow has been logged
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+// Unit-circle samples for the surface-of-revolution generators, kept as separate cosine and sine arrays
+// so the trigonometry runs four sectors at a time before being interleaved into vertices.
+class Ring {
+public:
+    static void SinCos(int sectors, float* cosines, float* sines);  // sectors + 1 samples at i * 2pi / sectors, vectorized where SSE2 is available
+    static void SinCosScalar(int sectors, float* cosines, float* sines);  // One std::cos/std::sin pair per sample; reference and fallback
+};
@@ -3,28 +3,170 @@
 //
 
 #pragma once
+#include <cstdint>
 #include <filesystem>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 using Path = std::filesystem::path;
 
+// Uniform name and its FNV-1a hash. Built from a string literal the hash is computed at compile time, so setting a
+// uniform by name costs one table lookup and no string.
+class UniformName {
+public:
+    template <size_t N>
+    consteval UniformName(const char (&name)[N]) : UniformName(std::string_view(name, N - 1)) {}
+    constexpr explicit UniformName(std::string_view name) : _name(name), _hash(Hash(name)) {}
+
+    static constexpr uint32_t Hash(std::string_view name)
+    {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    constexpr std::string_view GetName() const { return _name; }
+    constexpr uint32_t GetHash() const { return _hash; }
+
+private:
+    std::string_view _name;
+    uint32_t _hash;
+};
+
+// Handle to one active uniform of one program, typed by the value it takes; inactive handles ignore every Set
+template <typename T>
+class Uniform {
+public:
+    bool IsActive() const { return _index >= 0; }
+
+private:
+    friend class Shader;
+    int32_t _index{ -1 };  // Into the program's reflected uniforms
+};
+
+// Owns one linked GL program; move-only so the program is deleted exactly once.
+// Active uniforms, blocks and attributes are reflected once after linking. Uniforms are looked up by hashed name
+// and remember the value last uploaded, so setting a uniform to the value it already has issues no GL call.
 class Shader {
 public:
+    static constexpr uint32_t MaxTextureSamplers = 8;  // Units GetSamplerName has names for
+
+    struct UniformInfo {
+        std::string Name;  // Without the "[0]" GL appends to arrays
+        uint32_t Hash;  // UniformName::Hash of Name
+        GLint Location;
+        GLenum Type;  // GL_FLOAT_MAT4, GL_SAMPLER_2D, ...
+        GLint Size;  // Array length, 1 for non-arrays
+        uint32_t ValueOffset;  // Bytes into the program's value cache
+        bool ValueKnown;  // The cache holds what the program has
+    };
+
+    struct BlockInfo {
+        std::string Name;
+        GLint Binding;  // Uniform buffer or shader storage binding point
+        GLint DataSize;  // Bytes, the minimum buffer size for uniform blocks and the fixed part for storage blocks
+    };
+
+    struct AttributeInfo {
+        std::string Name;
+        GLint Location;
+        GLenum Type;
+    };
+
     Shader() = default;
+    ~Shader();
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+    Shader(Shader&& other) noexcept;
+    Shader& operator=(Shader&& other) noexcept;
 
     Shader(const std::string& vertexSource, const std::string& fragmentSource);  // Constructor with shader source code
-    Shader(const Path& vertexPath, const Path& fragmentPath);  // Constructor with shader file paths
+    // Constructors with shader file paths; #include "file" lines are replaced by the file, relative to the shader
+    Shader(const Path& vertexPath, const Path& fragmentPath);
+    explicit Shader(const Path& computePath);
 
     void Bind();  // Function to bind the shader program
 
-    void SetMat4(const std::string& uniformName, const glm::mat4& mat4);  // Function to set a 4x4 matrix uniform
-    void SetInt(const std::string& uniformName, int value);
+    // Handle for a uniform, or an inactive one if the program has no such uniform or it does not take a T
+    template <typename T>
+    Uniform<T> GetUniform(UniformName name) const;
+    template <typename T>
+    void Set(Uniform<T> uniform, const T& value) { upload(uniform._index, valueType<T>(), &value, 1); }
+
+    // Setters by name; the program must be bound, and names it does not have are ignored
+    void SetMat4(UniformName uniformName, const glm::mat4& mat4);  // Function to set a 4x4 matrix uniform
+    void SetFloat(UniformName uniformName, float value);
+    void SetVec2(UniformName uniformName, const glm::vec2& vec2);
+    void SetIVec2(UniformName uniformName, const glm::ivec2& ivec2);
+    void SetVec3(UniformName uniformName, const glm::vec3& vec3);
+    void SetVec4(UniformName uniformName, const glm::vec4& vec4);
+    void SetVec4Array(UniformName uniformName, std::span<const glm::vec4> values);  // From element 0
+    void SetInt(UniformName uniformName, int value);
+
+    static UniformName GetSamplerName(uint32_t unit);  // "tex0", "tex1", ... as the fragment shaders name them; empty past MaxTextureSamplers
+
+    std::span<const UniformInfo> GetUniforms() const { return _uniforms; }
+    std::span<const BlockInfo> GetUniformBlocks() const { return _uniformBlocks; }
+    std::span<const BlockInfo> GetStorageBlocks() const { return _storageBlocks; }
+    std::span<const AttributeInfo> GetAttributes() const { return _attributes; }
+
 private:
     void load(const std::string& vertexSource, const std::string& fragmentSource);  // Function to load and compile the shader program
-    GLint getUniformLocation(const std::string& uniformName);  // Function to get the location of a uniform variable
+    void loadCompute(const std::string& computeSource);  // Function to compile and link a compute-only program
+    void reflect();  // Fill the uniform, block and attribute tables from the linked program
+
+    int32_t findUniform(UniformName name) const;  // Index into _uniforms, or -1
+    static bool accepts(GLenum uniformType, GLenum valueType);  // A value of valueType can be uploaded to a uniform of uniformType
+    // Upload count values of valueType to the uniform unless they match the cache; ignored for index -1 or a type mismatch
+    void upload(int32_t index, GLenum valueType, const void* values, GLint count);
+
+    template <typename T>
+    static constexpr GLenum valueType()
+    {
+        if constexpr (std::is_same_v<T, int>) {
+            return GL_INT;
+        } else if constexpr (std::is_same_v<T, float>) {
+            return GL_FLOAT;
+        } else if constexpr (std::is_same_v<T, glm::vec2>) {
+            return GL_FLOAT_VEC2;
+        } else if constexpr (std::is_same_v<T, glm::ivec2>) {
+            return GL_INT_VEC2;
+        } else if constexpr (std::is_same_v<T, glm::vec3>) {
+            return GL_FLOAT_VEC3;
+        } else if constexpr (std::is_same_v<T, glm::vec4>) {
+            return GL_FLOAT_VEC4;
+        } else {
+            static_assert(std::is_same_v<T, glm::mat4>, "uniform type without an upload path");
+            return GL_FLOAT_MAT4;
+        }
+    }
 
 private:
-    GLuint _shaderProgram;  // ID of the shader program
+    GLuint _shaderProgram{};  // ID of the shader program
+    std::vector<UniformInfo> _uniforms;  // Active uniforms outside blocks
+    std::unordered_map<uint32_t, uint32_t> _uniformIndex;  // Name hash to index into _uniforms
+    std::vector<std::byte> _values;  // Last value uploaded to each uniform, at its ValueOffset
+    std::vector<BlockInfo> _uniformBlocks;
+    std::vector<BlockInfo> _storageBlocks;
+    std::vector<AttributeInfo> _attributes;
 };
+
+template <typename T>
+Uniform<T> Shader::GetUniform(UniformName name) const
+{
+    Uniform<T> uniform;
+    int32_t index = findUniform(name);
+    if (index >= 0 && accepts(_uniforms[index].Type, valueType<T>())) {
+        uniform._index = index;
+    }
+    return uniform;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "bounds.h"
+#include "bvh.h"
+#include "camera.h"
+#include "mesh.h"
+#include "ray.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+// One GLFW callback, recorded on the thread that polls events and replayed on the simulation thread
+struct InputEvent {
+    enum class Type : uint8_t {
+        Key,  // Button is a GLFW key, Action its GLFW action
+        CursorMove,  // Value is the cursor position in pixels from the top left
+        MouseButton,  // Button is a GLFW mouse button, Action its GLFW action, Value the cursor position
+        Scroll,  // Value is the scroll offset
+        Resize  // Value is the new framebuffer size
+    };
+
+    Type EventType{ Type::Key };
+    int Button{ 0 };
+    int Action{ 0 };
+    glm::dvec2 Value{ 0.0 };
+};
+
+// Everything the render thread needs from one simulation step. Published whole and never modified after, so the
+// render thread reads it without locks while the next step is being computed.
+struct SceneSnapshot {
+    uint64_t Tick{ 0 };  // Steps completed when this was published
+    float Time{ 0.f };  // Seconds since the window opened
+    double UpdateMilliseconds{ 0.0 };  // CPU time the step took on the simulation thread
+    glm::mat4 View{ 1.0f };  // Camera view matrix
+    glm::mat4 Projection{ 1.0f };  // Camera projection matrix
+    glm::vec3 CameraPosition{ 0.0f };  // World-space eye position
+    std::vector<glm::mat4> Transforms;  // Model matrix of each mesh, indexed like the render thread's meshes
+    std::vector<uint8_t> Visible;  // Frustum test result of each mesh; occlusion is left to the render thread
+    uint32_t VisibleCount{ 0 };  // Entries of Visible that are 1
+    uint32_t PickCount{ 0 };  // Clicks so far; a change means PickRay is a new selection request
+    Ray PickRay;  // World-space ray through the last click
+};
+
+// Camera, input and scene state stepped on a thread of its own. GLFW callbacks on the render thread push their
+// events into a lock-free single-producer queue; each step drains it, moves the camera, culls the scene hierarchy
+// against the new frustum and publishes a snapshot through a triple buffer. The render thread draws the newest
+// snapshot it finds, so a frame costs the longer of update and render instead of their sum.
+class Simulation {
+public:
+    static constexpr double StepSeconds = 1.0 / 120.0;  // Target step interval; steps that run long start the next one late
+    static constexpr size_t InputCapacity = 1024;  // Events the queue holds between two steps; later ones are dropped
+
+    explicit Simulation(const Camera& camera);
+    ~Simulation();  // Stops the thread
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Take the meshes' transforms and bounds, publish a first snapshot and start stepping; meshes are not touched afterwards
+    void Start(std::span<const Mesh> meshes);
+    void Stop();  // Join the thread; Start may be called again
+
+    bool PushInput(const InputEvent& event);  // Render thread only; false if the queue is full
+    bool AcquireSnapshot() { return _snapshots.Acquire(); }  // Render thread only; true if a newer snapshot was taken
+    const SceneSnapshot& GetSnapshot() const { return _snapshots.GetReadBuffer(); }  // Newest snapshot acquired
+
+private:
+    void run();  // Thread body: step at StepSeconds until stopped
+    void step(float deltaTime, float time);  // Apply input, move the camera, cull and publish
+    void handleEvent(const InputEvent& event);
+    void updateSceneBvh();  // Refit the hierarchy to the current transforms, rebuilding once it has loosened too far
+    void publish(float time, double updateMilliseconds);
+
+private:
+    Camera _camera;
+    std::vector<glm::mat4> _transforms;  // Model matrix of each mesh
+    std::vector<BoundingBox> _bounds;  // Object-space bounds of each mesh
+    Bvh _sceneBvh;  // Hierarchy over the world-space boxes of the meshes
+    std::vector<uint8_t> _visible;  // Frustum test result of the last step
+    uint32_t _visibleCount{ 0 };
+    bool _keysDown[GLFW_KEY_LAST + 1]{};  // Keys pressed and not yet released
+    bool _firstMouse{ false };  // Set once the first cursor position has been seen
+    glm::vec2 _lastMousePosition{ -1, -1 };  // Cursor position of the last move event
+    uint32_t _pickCount{ 0 };
+    Ray _pickRay;
+    uint64_t _tick{ 0 };
+
+    SpscQueue<InputEvent, InputCapacity> _inputs;  // GLFW callbacks to the simulation thread
+    TripleBuffer<SceneSnapshot> _snapshots;  // Simulation thread to the render thread
+    std::atomic<bool> _running{ false };
+    std::thread _thread;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. Each side owns one index and
+// only reads the other's, so a push or pop is a copy plus one release store; the indices sit on separate cache
+// lines so the two threads do not invalidate each other's line on every operation.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    bool TryPush(const T& item)  // Producer only; false when the queue is full
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        _items[head & (Capacity - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& item)  // Consumer only; false when the queue is empty
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[tail & (Capacity - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> _head{ 0 };  // Next slot to write; only the producer stores it
+    alignas(64) std::atomic<size_t> _tail{ 0 };  // Next slot to read; only the consumer stores it
+    alignas(64) std::array<T, Capacity> _items{};
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// Bakes meshes that never move into a single mesh: vertices are pre-transformed into world space and the
+// indices of every source are grouped by material, so the whole set costs one model matrix and one draw per
+// material. Each source keeps its own index ranges inside the batch, so it can still be hidden on its own.
+// Sources with levels of detail contribute their matching level to each level of the batch.
+class StaticBatch {
+public:
+    struct Source {
+        uint32_t MeshIndex{ 0 };  // Position of the source in the mesh list given to Build
+        std::vector<std::vector<SubMesh>> Ranges;  // Per batch level, the source's index ranges tagged with batch materials
+        bool Visible{ true };  // Hidden sources are left out of the batch's sub-meshes
+    };
+
+    // Move every mesh flagged Static out of meshes and append the batch in their place. Meshes behind a
+    // removed source shift down. Returns false, leaving meshes untouched, when fewer than two meshes are static.
+    bool Build(std::vector<Mesh>& meshes, GeometryArena* arena = nullptr);
+
+    void SetVisible(std::vector<Mesh>& meshes, uint32_t source, bool visible);  // Show or hide one source of the batch in meshes
+    bool IsVisible(uint32_t source) const { return _sources[source].Visible; }
+    uint32_t GetSourceCount() const { return static_cast<uint32_t>(_sources.size()); }
+    const Source& GetSource(uint32_t source) const { return _sources[source]; }
+    uint32_t GetMeshIndex() const { return _meshIndex; }  // Position of the batch in the mesh list
+
+private:
+    void updateSubMeshes(Mesh& batch) const;  // Merge the visible sources' ranges into one sub-mesh per contiguous run
+
+private:
+    std::vector<Source> _sources;  // Baked meshes, in their original order
+    uint32_t _levelCount{ 0 };  // Levels of detail of the batch
+    uint32_t _meshIndex{ UINT32_MAX };  // Position of the batch in the mesh list, or UINT32_MAX before Build
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <glad/glad.h>
+
+// Per-frame ring of GPU-visible memory for data rewritten every frame: constants, dynamic vertices and indirect
+// commands. One immutable buffer is persistently mapped for writing and split into SegmentCount frame segments.
+// Each frame writes into its own segment through the mapping, and a fence placed at the end of the frame guards
+// the segment until the GPU has consumed it. The mapping is coherent, so nothing needs flushing, and nothing is
+// ever re-specified, so the driver never has to orphan or synchronize behind the application's back.
+class StreamBuffer {
+public:
+    static constexpr uint32_t SegmentCount = 3;  // Frames in flight: one written by the CPU, up to two read by the GPU
+
+    // One suballocation; Data stays valid until the segment is reused SegmentCount frames later
+    struct Allocation {
+        void* Data{ nullptr };  // Mapped write pointer
+        GLintptr Offset{ 0 };  // Bytes from the start of the buffer, aligned as requested
+        GLsizeiptr Size{ 0 };  // Bytes requested
+
+        bool IsValid() const { return Data != nullptr; }
+    };
+
+    struct Stats {
+        uint32_t Frames{ 0 };  // BeginFrame calls
+        uint32_t Stalls{ 0 };  // Frames whose segment was still in use by the GPU
+        double StallMilliseconds{ 0.0 };  // CPU time spent waiting on segment fences
+        uint64_t BytesAllocated{ 0 };  // Bytes handed out, alignment padding included
+        uint32_t Overflows{ 0 };  // Allocations refused because the frame's segment was full
+    };
+
+    explicit StreamBuffer(GLsizeiptr segmentSize);  // Bytes each frame may allocate
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    bool IsValid() const { return _mapping != nullptr; }  // The buffer was created and mapped
+
+    void BeginFrame();  // Move to the next segment, waiting until the GPU has finished reading it
+    void EndFrame();  // Fence the segment behind the frame's GL commands; call after its last draw
+
+    // Reserve size bytes of the current segment at an offset that is a multiple of alignment; invalid if full
+    Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment);
+    Allocation AllocateUniforms(GLsizeiptr size) { return Allocate(size, _uniformAlignment); }  // For glBindBufferRange on GL_UNIFORM_BUFFER
+    Allocation AllocateStorage(GLsizeiptr size) { return Allocate(size, _storageAlignment); }  // For glBindBufferRange on GL_SHADER_STORAGE_BUFFER
+    Allocation AllocateVertices(GLsizeiptr size, GLsizeiptr stride) { return Allocate(size, stride); }  // Offset is a whole number of vertices
+    Allocation AllocateCommands(GLsizeiptr size) { return Allocate(size, sizeof(uint32_t)); }  // For indirect draw and dispatch offsets
+
+    // Allocate and copy in one step; invalid if full
+    template <typename T>
+    Allocation Write(std::span<const T> data, GLsizeiptr alignment);
+
+    GLuint GetBuffer() const { return _buffer; }  // Bind to whichever target the allocation is read through
+    GLsizeiptr GetSegmentSize() const { return _segmentSize; }
+    GLsizeiptr GetUniformAlignment() const { return _uniformAlignment; }
+    GLsizeiptr GetStorageAlignment() const { return _storageAlignment; }
+    const Stats& GetStats() const { return _stats; }
+    void ResetStats() { _stats = {}; }
+
+private:
+    GLuint _buffer{};  // Immutable storage of SegmentCount segments
+    std::byte* _mapping{ nullptr };  // Persistent coherent write mapping of the whole buffer
+    GLsizeiptr _segmentSize{ 0 };  // Bytes per segment, a multiple of the uniform and storage alignments
+    GLsync _fences[SegmentCount]{};  // Signalled once the GPU is done with each segment's frame
+    uint32_t _segment{ SegmentCount - 1 };  // Segment being written
+    GLsizeiptr _head{ 0 };  // Next free byte of the current segment, relative to its start
+    GLsizeiptr _uniformAlignment{ 256 };  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    GLsizeiptr _storageAlignment{ 256 };  // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    Stats _stats;
+};
+
+template <typename T>
+StreamBuffer::Allocation StreamBuffer::Write(std::span<const T> data, GLsizeiptr alignment)
+{
+    Allocation allocation = Allocate(static_cast<GLsizeiptr>(data.size_bytes()), alignment);
+    if (allocation.IsValid()) {
+        std::copy(data.begin(), data.end(), static_cast<T*>(allocation.Data));
+    }
+    return allocation;
+}
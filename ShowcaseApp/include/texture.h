@@ -3,13 +3,52 @@
 //
 
 #pragma once
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
 #include <glad/glad.h>
 
+// RGBA8 pixels decoded on the CPU; decoding is safe on worker threads, the upload happens later on the GL thread.
+class Image {
+public:
+    static Image Decode(std::span<const std::byte> encoded);  // Decode a PNG, JPEG, TGA or BMP held in memory; invalid on failure
+
+    bool IsValid() const { return _pixels != nullptr; }
+    int GetWidth() const { return _width; }
+    int GetHeight() const { return _height; }
+    const unsigned char* GetPixels() const { return _pixels.get(); }  // Rows top to bottom
+
+private:
+    struct Deleter {
+        void operator()(unsigned char* pixels) const;  // Hand the pixels back to stb_image
+    };
+
+    std::unique_ptr<unsigned char, Deleter> _pixels;  // Pixels owned by stb_image
+    int _width{ 0 };
+    int _height{ 0 };
+};
+
+// Owns one GL texture object; move-only so a GL name is deleted exactly once.
 class Texture {
 public:
     Texture(const std::filesystem::path& path);
-    void Bind();
+    Texture(int width, int height, const unsigned char* pixels);  // Upload RGBA8 pixels decoded elsewhere
+    ~Texture();
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+    Texture(Texture&& other) noexcept;
+    Texture& operator=(Texture&& other) noexcept;
+
+    void Bind(uint32_t unit);  // Bind to the texture unit, through GLState
+    GLuint GetHandle() const { return _textureHandle; }
 private:
-    GLuint _textureHandle;
-};
\ No newline at end of file
+    void upload(int width, int height, const unsigned char* pixels);  // Create the texture object from RGBA8 pixels, if any
+
+    GLuint _textureHandle{};
+};
+
+// Textures are shared between meshes explicitly through shared ownership
+using TextureSet = std::vector<std::shared_ptr<Texture>>;
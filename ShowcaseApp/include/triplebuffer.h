@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of whole values from one writer thread to one reader thread. Three slots rotate between the
+// writer, the reader and a shared middle slot: publishing swaps the written slot into the middle, acquiring swaps
+// the middle out to the reader. Neither side ever waits for the other; a reader that falls behind skips straight
+// to the newest value, and a writer that runs ahead overwrites values nobody picked up.
+template <typename T>
+class TripleBuffer {
+public:
+    // The slot the writer fills next; it may hold a value from two publishes ago, so overwrite all of it
+    T& GetWriteBuffer() { return _slots[_write]; }
+
+    void Publish()  // Writer only: make the write slot the newest value
+    {
+        _write = _middle.exchange(_write | FreshBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    bool Acquire()  // Reader only: take the newest value if one was published since the last call
+    {
+        if ((_middle.load(std::memory_order_relaxed) & FreshBit) == 0) {
+            return false;
+        }
+        _read = _middle.exchange(_read, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+
+    const T& GetReadBuffer() const { return _slots[_read]; }  // Stays unchanged until the next successful Acquire
+
+private:
+    static constexpr uint32_t IndexMask = 3;  // Slot index bits of _middle
+    static constexpr uint32_t FreshBit = 4;  // Set in _middle when it holds a value the reader has not taken
+
+    T _slots[3]{};
+    uint32_t _write{ 0 };  // Owned by the writer
+    alignas(64) std::atomic<uint32_t> _middle{ 1 };  // Slot index plus FreshBit, swapped by both sides
+    alignas(64) uint32_t _read{ 2 };  // Owned by the reader
+};
@@ -3,6 +3,8 @@
 //
 
 #pragma once
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <vector>
 
@@ -14,9 +16,17 @@ struct Vertex{
     glm::vec2 Uv2 {1.f, 1.f};
 };
 
+// Vertex and index tables sized at compile time, as produced by the consteval generators
+template <size_t VertexCount, size_t IndexCount>
+struct StaticGeometry {
+    std::array<Vertex, VertexCount> Vertices;
+    std::array<uint32_t, IndexCount> Indices;
+};
+
+// Fixed primitives as constant tables; they live in read-only data and need no initialization at startup
 struct Shapes {
 
-    static inline std::vector<Vertex> tableTopVertices {
+    static constexpr std::array<Vertex, 8> tableTopVertices {{
             // Table top vertices (positions and colors)
             // Top face
             { .Position = {-2.0f, 0.2f, -2.0f}, .Color = {1.0f, .0f, 1.0f} }, // Bottom-left
@@ -29,9 +39,9 @@ struct Shapes {
             { .Position = {2.0f, 0.0f, -2.0f}, .Color = {1.0f, 1.0f, .0f} },  // Bottom-right
             { .Position = {2.0f, 0.0f, 2.0f}, .Color = {1.0f, 1.0f, .0f} },   // Top-right
             { .Position = {-2.0f, 0.0f, 2.0f}, .Color = {1.0f, 1.0f, .0f} }   // Top-left
-    };
+    }};
 
-    static inline std::vector<uint32_t> tableTopElements {
+    static constexpr std::array<uint32_t, 36> tableTopElements {{
             // Table top indices to form triangles
             // Top face
             0, 1, 2, // First triangle
@@ -53,24 +63,24 @@ struct Shapes {
 
             3, 7, 6, // Front side face
             6, 2, 3
-    };
+    }};
 
 
-    static inline std::vector<Vertex> planeVertices {
+    static constexpr std::array<Vertex, 4> planeVertices {{
             // Plane vertices (positions and colors)
             { .Position = {-2.0f, 0.0f, -2.0f}, .Color = {0.0f, 1.0f, 0.0f} }, // Bottom-left, green
             { .Position = {2.0f, 0.0f, -2.0f}, .Color = {0.0f, 1.0f, 0.0f} },  // Bottom-right, green
             { .Position = {2.0f, 0.0f, 2.0f}, .Color = {0.0f, 1.0f, 0.0f} },   // Top-right, green
             { .Position = {-2.0f, 0.0f, 2.0f}, .Color = {0.0f, 1.0f, 0.0f} }   // Top-left, green
-    };
+    }};
 
-    static inline std::vector<uint32_t> planeElements {
+    static constexpr std::array<uint32_t, 6> planeElements {{
             // Plane indices to form two triangles
             0, 1, 2, // First triangle
             2, 3, 0  // Second triangle
-    };
+    }};
 
-    static inline std::vector<Vertex> cubeVertices {
+    static constexpr std::array<Vertex, 8> cubeVertices {{
             // Cube vertices (positions and colors)
             { .Position = {-0.5f, -0.5f, 0.5f}, .Color = {1.f, 0.f, 1.f} }, // Front-bottom-left, pink
             { .Position = {0.5f, -0.5f, 0.5f}, .Color = {1.f, 1.f, 0.f} },  // Front-bottom-right, yellow
@@ -81,9 +91,9 @@ struct Shapes {
             { .Position = {0.5f, -0.5f, -0.5f}, .Color = {0.f, 1.f, 0.f} },  // Back-bottom-right, green
             { .Position = {0.5f, 0.5f, -0.5f}, .Color = {1.f, 0.f, 0.f} },  // Back-top-right, red
             { .Position = {-0.5f, 0.5f, -0.5f}, .Color = {0.f, 0.5f, 0.5f} } // Back-top-left, teal
-    };
+    }};
 
-    static inline std::vector<uint32_t> cubeElements {
+    static constexpr std::array<uint32_t, 36> cubeElements {{
             // Cube indices for front, back, and connecting faces
             0, 1, 2,
             2, 3, 0,
@@ -97,9 +107,9 @@ struct Shapes {
             3, 6, 7,
             3, 7, 0,
             0, 7, 4
-    };
+    }};
 
-    static inline std::vector<Vertex> pyramidVertices {
+    static constexpr std::array<Vertex, 5> pyramidVertices {{
             // Pyramid vertices (positions, colors, and UVs)
             { .Position = {-0.5f, -0.5f, 0.5f}, .Color = {1.f, 0.f, 1.f}, .Uv = {0.f, 0.f} }, // Front-bottom-left, pink
             { .Position = {0.5f, -0.5f, 0.5f}, .Color = {1.f, 1.f, 0.f}, .Uv = {1.f, 0.f} },  // Front-bottom-right, yellow
@@ -107,9 +117,9 @@ struct Shapes {
             { .Position = {-0.5f, -0.5f, -0.5f}, .Color = {0.f, 0.f, 1.f}, .Uv = {0.f, 1.f} }, // Back-bottom-left, blue
             // Apex vertex with white color and center UV
             { .Position = {0.f, 0.5f, 0.f}, .Color = {1.f, 1.f, 1.f}, .Uv = {0.5f, 0.5f} }
-    };
+    }};
 
-    static inline std::vector<uint32_t> pyramidElements {
+    static constexpr std::array<uint32_t, 18> pyramidElements {{
             // Pyramid indices for the base and side faces
             0, 1, 2,
             2, 3, 0,
@@ -117,5 +127,5 @@ struct Shapes {
             1, 4, 2,
             2, 4, 3,
             3, 4, 0
-    };
+    }};
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "types.h"
+
+enum class VertexFormat {
+    Full,  // Vertex as declared, all attributes fp32
+    Packed  // PackedVertex, quantized against the mesh bounds
+};
+
+// 20-byte vertex: snorm16 position against the mesh bounds, octahedral normal in 2_10_10_10_REV,
+// unorm16 UV against the UV bounds and RGBA8 color. Uv2 is dropped since no attribute reads it.
+struct PackedVertex {
+    int16_t Position[4];  // xyz in [-1, 1] relative to the bounds, w is padding
+    uint32_t Normal;  // Octahedral xy in the two low 10-bit fields
+    uint16_t Uv[2];  // uv in [0, 1] relative to the UV bounds
+    uint8_t Color[4];  // rgb plus an opaque alpha
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// Affine decode parameters: value = Offset + Scale * quantized
+struct VertexQuantization {
+    glm::vec3 PositionOffset{ 0.f };
+    glm::vec3 PositionScale{ 1.f };
+    glm::vec2 UvOffset{ 0.f };
+    glm::vec2 UvScale{ 1.f };
+};
+
+class VertexEncoder {
+public:
+    static size_t GetStride(VertexFormat format);  // Size of one vertex in the given format
+    static void SetupAttributes(VertexFormat format);  // Describe the format to the bound VAO and GL_ARRAY_BUFFER
+
+    static VertexQuantization ComputeQuantization(std::span<const Vertex> vertices);  // Bounds-based decode parameters
+    static std::vector<PackedVertex> Pack(std::span<const Vertex> vertices, const VertexQuantization& quantization);
+    static Vertex Unpack(const PackedVertex& vertex, const VertexQuantization& quantization);  // CPU reference decode
+
+    static glm::vec2 EncodeOctahedral(glm::vec3 normal);  // Unit vector to [-1, 1]^2
+    static glm::vec3 DecodeOctahedral(glm::vec2 encoded);  // [-1, 1]^2 to unit vector
+};
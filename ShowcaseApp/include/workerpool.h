@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads started once and reused for per-frame parallel loops, where creating and joining threads every call
+// would cost more than the work. Items are handed out one at a time from an atomic counter, so threads that draw
+// cheap items simply take more of them and an uneven loop still finishes together.
+class WorkerPool {
+public:
+    explicit WorkerPool(uint32_t threadCount = 0);  // Threads taking part in a loop, the caller included; 0 is one per hardware thread
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    static WorkerPool& Shared();  // Process-wide pool with one thread per hardware thread, started on first use
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(_workers.size()) + 1; }
+
+    // Run body(item) for every item in [0, count) and return once all are done. The calling thread works too;
+    // threadCount caps the threads used, 0 uses them all. Calls are serialized; a body must not call ForEach.
+    template <typename Body>
+    void ForEach(size_t count, Body&& body, uint32_t threadCount = 0)
+    {
+        auto invoke = [](void* context, size_t item) { (*static_cast<Body*>(context))(item); };
+        run(count, invoke, &body, threadCount);
+    }
+
+private:
+    using Invoke = void (*)(void* context, size_t item);
+
+    void run(size_t count, Invoke invoke, void* context, uint32_t threadCount);
+    void work();  // Take items until none are left
+    void workerLoop(uint32_t index);
+
+private:
+    std::vector<std::thread> _workers;
+    std::mutex _callMutex;  // Held for a whole ForEach so concurrent callers take turns
+    std::mutex _mutex;  // Guards the job description and the counters below
+    std::condition_variable _wake;  // Workers wait here for a new generation
+    std::condition_variable _done;  // The caller waits here for _busy to reach zero
+    uint64_t _generation{ 0 };  // Bumped for every job
+    uint32_t _participants{ 0 };  // Workers with a lower index than this join the current job
+    uint32_t _busy{ 0 };  // Workers still inside the current job
+    bool _stopping{ false };
+    Invoke _invoke{ nullptr };
+    void* _context{ nullptr };
+    size_t _count{ 0 };
+    alignas(64) std::atomic<size_t> _next{ 0 };  // Next item to hand out
+};
@@ -3,13 +3,18 @@
 #include <types.h>
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp>
-#include <cylinder.h>
-#include "conicalfrustum.h"
+#include "lathe.h"
+#include "props.h"
 #include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include "glstate.h"
 
 Application::Application(std::string WindowTitle, int width, int height)
         : _applicationName{std::move(WindowTitle)}, _width{width}, _height{height},
-          _camera{width, height, {0.5f, 0.f, 3.f}, true},
+          _simulation{Camera{width, height, {0.5f, 0.f, 3.f}, true}},
           _cameraLookSpeed {0.02f, 0.02f}
 {
     // Constructor that initializes the member variables
@@ -27,6 +32,9 @@ void Application::Run() {
     // Setup the scene
     setupScene();
 
+    // The simulation thread owns the camera and scene state from here on; this thread renders its snapshots
+    _simulation.Start(_meshes);
+
     // Run application
     while (_running) {
         float currentTime = glfwGetTime();
@@ -42,12 +50,16 @@ void Application::Run() {
         }
 
         // Update
-        update(deltaTime);
+        update();
 
         // Draw
         draw();
+
+        updateFrameStats(deltaTime);
     }
 
+    _simulation.Stop();
+    teardownScene();  // Release every GPU object while the context is still alive
     glfwTerminate();  // Cleanup and terminate GLFW
 }
 
@@ -55,7 +67,7 @@ bool Application::openWindow() {
     // Initialize and configure GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Create a GLFW window
@@ -78,7 +90,7 @@ bool Application::openWindow() {
         app->_width = width;
         app->_height = height;
 
-        app->_camera.SetSize(width, height);
+        app->_simulation.PushInput({ InputEvent::Type::Resize, 0, 0, { width, height } });
     });
 
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
@@ -86,7 +98,8 @@ bool Application::openWindow() {
         glfwTerminate();
         return false;  // Return false if GLAD initialization fails
     }
-    glEnable(GL_DEPTH_TEST);
+    GLState::Invalidate();  // Nothing is known about a fresh context
+    GLState::Enable(GL_DEPTH_TEST);
     return true;  // Return true if window opening and initialization succeed
 
 }
@@ -95,6 +108,8 @@ void Application::setupInputs() {
     glfwSetKeyCallback(_window, [](GLFWwindow *window, int key, int scancode, int action, int mods) {
         auto *app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
 
+        // The simulation tracks held keys and camera toggles; quitting and the render mode stay on this thread
+        app->_simulation.PushInput({ InputEvent::Type::Key, key, action, {} });
         switch (key) {
             case GLFW_KEY_ESCAPE: {
                 if (action == GLFW_PRESS) {
@@ -102,10 +117,15 @@ void Application::setupInputs() {
                 }
                 break;
             }
-            case GLFW_KEY_F11:{
+            case GLFW_KEY_F1: {
                 if (action == GLFW_PRESS) {
-                    app->_camera.SetIsPerspective(!app->_camera.IsPerspective());
+                    app->_renderMode = app->_renderMode == RenderMode::Immediate         ? RenderMode::Sorted
+                                     : app->_renderMode == RenderMode::Sorted            ? RenderMode::MultiDrawIndirect
+                                     : app->_renderMode == RenderMode::MultiDrawIndirect ? RenderMode::GpuDriven
+                                                                                         : RenderMode::Immediate;
+                    app->_frameStats = {};
                 }
+                break;
             }
             default: {}
         }
@@ -113,70 +133,111 @@ void Application::setupInputs() {
 
     glfwSetCursorPosCallback(_window, [](GLFWwindow* window, double xpos, double ypos) {
         auto *app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
-        app->mousePositionCallback(xpos, ypos);
+        app->_simulation.PushInput({ InputEvent::Type::CursorMove, 0, 0, { xpos, ypos } });
+    });
+
+    glfwSetMouseButtonCallback(_window, [](GLFWwindow* window, int button, int action, int mods) {
+        auto *app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
+        double xpos, ypos;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        app->_simulation.PushInput({ InputEvent::Type::MouseButton, button, action, { xpos, ypos } });
     });
 
     glfwSetScrollCallback(_window, [](GLFWwindow* window, double xOffset, double yOffset){
         auto *app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
-        app->_camera.IncrementSpeed(yOffset * .2);
+        app->_simulation.PushInput({ InputEvent::Type::Scroll, 0, 0, { xOffset, yOffset } });
     });
 }
 
+// Function to print the vertex cache figures of a generated mesh before and after optimization
+void Application::printOptimizationReport(const char* name, const MeshOptimizer::Report& report) {
+    std::cout << name << ": ACMR " << report.Before.Acmr << " -> " << report.After.Acmr
+              << ", ATVR " << report.Before.Atvr << " -> " << report.After.Atvr
+              << ", vertices " << report.VerticesBefore << " -> " << report.VerticesAfter << std::endl;
+}
+
 // Function to set up the scene
 void Application::setupScene() {
 
+    // Every mesh suballocates from one set of buffers so they all draw through a single VAO
+    _geometryArena = std::make_unique<GeometryArena>(65536, 262144, _vertexFormat);
+
     Path texturePath = std::filesystem::current_path() / "assets" / "textures";
-    _textures.emplace_back(texturePath / "bottle.jpg");
-    _textures.emplace_back(texturePath / "rootbeerLabel.jpg");
-
-    // Define the scale factor
-    float scaleFactor = 0.90f;
-
-    // Create a cylinder
-    float bottleRadius = 0.25f * scaleFactor; // Reduced radius
-    float bottleHeight = 2.25f * scaleFactor; // Reduced height
-    int bottleSectors = 64;
-    Cylinder cylinder(bottleRadius, bottleHeight, bottleSectors);
-    auto cylinderMesh = cylinder.GetMesh();
-    cylinderMesh.Transform = glm::scale(glm::mat4(1.0f), glm::vec3(scaleFactor, scaleFactor, scaleFactor)) *
-                             glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, bottleHeight / 2.0f, 0.0f)) *
-                             cylinderMesh.Transform;
-    cylinderMesh.SetTextures({_textures[1], _textures[0]});
-
-    _meshes.emplace_back(cylinderMesh);
-
-    // Create a conical frustum for the middle part of the bottle
-    float middleBottleTopRadius = 0.15f * scaleFactor; // Reduced top radius
-    float middleBottleBottomRadius = 0.25f * scaleFactor; // Reduced bottom radius
-    float middleBottleHeight = 0.5f * scaleFactor; // Reduced height
-    int middleBottleSectors = 64;
-    ConicalFrustum middleConicalFrustum(middleBottleTopRadius, middleBottleBottomRadius, middleBottleHeight,
-                                        middleBottleSectors);
-    auto middleConicalFrustumMesh = middleConicalFrustum.GetMesh();
-    middleConicalFrustumMesh.Transform = glm::scale(glm::mat4(1.0f), glm::vec3(scaleFactor, scaleFactor, scaleFactor)) *
-                                         glm::translate(glm::mat4(1.0f),
-                                                        glm::vec3(0.0f, bottleHeight + middleBottleHeight / 2.0f,
-                                                                  0.0f)) * middleConicalFrustumMesh.Transform;
-    middleConicalFrustumMesh.SetTextures({_textures[0]});
-    _meshes.emplace_back(middleConicalFrustumMesh);
-
-    // Create a conical frustum for the top part of the bottle
-    float topBottleTopRadius = 0.1f * scaleFactor; // Reduced top radius
-    float topBottleBottomRadius = 0.15f * scaleFactor; // Reduced bottom radius
-    float topBottleHeight = 1.5f * scaleFactor; // Reduced height
-    int topBottleSectors = 64;
-    ConicalFrustum topConicalFrustum(topBottleTopRadius, topBottleBottomRadius, topBottleHeight, topBottleSectors);
-    auto topConicalFrustumMesh = topConicalFrustum.GetMesh();
-    topConicalFrustumMesh.Transform = glm::scale(glm::mat4(1.0f), glm::vec3(scaleFactor, scaleFactor, scaleFactor)) *
-                                      glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,
-                                                                                bottleHeight + middleBottleHeight +
-                                                                                topBottleHeight / 2.0f, 0.0f)) *
-                                      topConicalFrustumMesh.Transform;
-    topConicalFrustumMesh.SetTextures({_textures[0]});
-    _meshes.emplace_back(topConicalFrustumMesh);
+    _textures.push_back(std::make_shared<Texture>(texturePath / "bottle.jpg"));
+    _textures.push_back(std::make_shared<Texture>(texturePath / "rootbeerLabel.jpg"));
+
+    // Every piece gets as many sectors as it needs to stay within Props::ChordTolerance of a true circle,
+    // plus coarser levels picked per frame from its size on screen. The bottle is cooked offline by MeshCooker;
+    // without the cooked file it is generated here instead.
+    auto bottleStart = std::chrono::steady_clock::now();
+    MeshFile bottleFile;
+    bool cooked = bottleFile.Open(std::filesystem::current_path() / "assets" / "meshes" / "bottle.scmf");
+    MeshOptimizer::Report report;
+    Mesh bottleMesh = cooked ? bottleFile.CreateMesh(_geometryArena.get())
+                             : Lathe::CreateLodMesh(Props::BottleProfile(), Props::ChordTolerance, _geometryArena.get(), &report);
+    if (cooked) {
+        _meshFiles.push_back(std::move(bottleFile));  // The mapping stays put, so the mesh's views survive the move
+    } else {
+        printOptimizationReport("Bottle", report);
+    }
+    std::cout << "Bottle " << (cooked ? "loaded from cooked file" : "generated") << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bottleStart).count()
+              << " ms" << std::endl;
+
+    bottleMesh.Transform = glm::scale(glm::mat4(1.0f), glm::vec3(Props::BottleScale));
+    bottleMesh.SetMaterials({ {_textures[1], _textures[0]}, {_textures[0]} });
+    bottleMesh.Static = true;
+    _meshes.push_back(std::move(bottleMesh));
 
     // Plane
-    _meshes.emplace_back(Shapes::tableTopVertices, Shapes::tableTopElements);
+    _meshes.emplace_back(Shapes::tableTopVertices, Shapes::tableTopElements, _geometryArena.get());
+    _meshes.back().Static = true;
+    _meshes.back().Occluder = true;  // Hides whatever is under the table
+
+    // Nothing above moves after setup, so it is baked into one mesh drawn once per material
+    _staticBatch.Build(_meshes, _geometryArena.get());
+
+    // Optional glTF model, placed as authored
+    if (!_modelPath.empty()) {
+        auto model = std::make_unique<GltfLoader>();
+        if (model->Load(_modelPath)) {
+            auto modelMeshes = model->CreateMeshes(_geometryArena.get());
+            const auto& stats = model->GetStats();
+            std::cout << "Model " << _modelPath.string() << ": " << modelMeshes.size() << " meshes; read " << stats.ReadMilliseconds
+                      << " ms, parse " << stats.ParseMilliseconds << " ms, geometry " << stats.GeometryMilliseconds
+                      << " ms, images " << stats.ImageMilliseconds << " ms on " << stats.Threads << " threads, upload "
+                      << stats.UploadMilliseconds << " ms" << std::endl;
+            for (auto& mesh : modelMeshes) {
+                mesh.Occluder = true;  // Authored scenery such as walls and furniture
+                _meshes.push_back(std::move(mesh));
+            }
+            _model = std::move(model);
+        }
+    }
+
+    // Optional crowd of small bottles on the table top, every copy sharing one mesh and one instance buffer
+    if (_instanceCount > 0) {
+        auto crowdMesh = _meshFiles.empty() ? Lathe::CreateLodMesh(Props::BottleProfile(), Props::ChordTolerance, _geometryArena.get())
+                                            : _meshFiles.front().CreateMesh(_geometryArena.get());
+        crowdMesh.SetMaterials({ {_textures[1], _textures[0]}, {_textures[0]} });
+        InstanceGroup crowd(std::move(crowdMesh));
+
+        auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(_instanceCount))));
+        float spacing = 3.6f / side;
+        float crowdScale = std::min(0.15f, spacing * 0.8f);
+        for (uint32_t i = 0; i < _instanceCount; i++) {
+            glm::vec3 position(-1.8f + spacing * (i % side + 0.5f), 0.2f, -1.8f + spacing * (i / side + 0.5f));
+            float tint = 0.75f + 0.25f * static_cast<float>(i % 5) / 4.0f;
+            crowd.Add(glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(crowdScale)),
+                      glm::vec4(tint, tint, 1.0f, 1.0f));
+        }
+        _instanceGroups.push_back(std::move(crowd));
+    }
+
+    auto arenaStats = _geometryArena->GetStats();
+    std::cout << "Geometry arena: " << arenaStats.AllocationCount << " meshes, "
+              << arenaStats.VertexBytesUsed << "/" << arenaStats.VertexBytesCapacity << " vertex bytes, "
+              << arenaStats.IndexBytesUsed << "/" << arenaStats.IndexBytesCapacity << " index bytes" << std::endl;
 
 
     // Set up the path to the "shaders" directory in the "assets" folder.
@@ -184,14 +245,49 @@ void Application::setupScene() {
 
     // Create a Shader object using the vertex and fragment shader files located in the "shaders" directory.
     _shader = Shader(shaderPath / "basic_shader.vert", shaderPath / "basic_shader.frag");
+    _indirectShader = Shader(shaderPath / "indirect_shader.vert", shaderPath / "basic_shader.frag");
+    _instancedShader = Shader(shaderPath / "instanced_shader.vert", shaderPath / "basic_shader.frag");
+    _streamBuffer = std::make_unique<StreamBuffer>(StreamSegmentSize);
+    _indirectRenderer = std::make_unique<IndirectRenderer>(_streamBuffer.get());
+    _constantBuffers = std::make_unique<ConstantBuffers>(_streamBuffer.get());
+    _gpuCuller = std::make_unique<GpuCuller>(shaderPath);
 
 }
 
 
-bool Application::update(float deltaTime) {
-    glfwPollEvents();
+void Application::teardownScene() {
+    // Meshes hand their ranges back to the arena, so they go before it
+    _meshes.clear();
+    _instanceGroups.clear();
+    _raycaster = Raycaster();
+    _selectedMesh = RayHit::None;
+    _staticBatch = StaticBatch();
+    _meshFiles.clear();  // Mapped files and the model go after the meshes viewing them
+    _model.reset();
+    _textures.clear();
+    _indirectRenderer.reset();
+    _constantBuffers.reset();
+    _streamBuffer.reset();
+    _gpuCuller.reset();
+    _geometryArena.reset();
+    _shader = Shader();
+    _indirectShader = Shader();
+    _instancedShader = Shader();
+}
+
+bool Application::update() {
+    glfwPollEvents();  // Callbacks queue their events for the simulation thread
 
-    handleInput(deltaTime);
+    // Draw the newest state the simulation has published; without a newer one the last snapshot is drawn again
+    _simulation.AcquireSnapshot();
+    const SceneSnapshot& snapshot = _simulation.GetSnapshot();
+    for (size_t i = 0; i < _meshes.size() && i < snapshot.Transforms.size(); i++) {
+        _meshes[i].Transform = snapshot.Transforms[i];
+    }
+    if (snapshot.PickCount != _pickCount) {
+        _pickCount = snapshot.PickCount;
+        selectAt(snapshot.PickRay);
+    }
 
     return false;
 }
@@ -200,73 +296,230 @@ bool Application::draw() {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 view = _camera.GetViewMatrix();
-    glm::mat4 projection = _camera.GetProjectionMatrix();
+    const SceneSnapshot& snapshot = _simulation.GetSnapshot();
+    const glm::mat4& view = snapshot.View;
+    const glm::mat4& projection = snapshot.Projection;
+
+    auto submitStart = std::chrono::steady_clock::now();
+    GLState::ResetCounters();
+    _streamBuffer->BeginFrame();
+    _constantBuffers->SetFrame({ view, projection, projection * view, snapshot.CameraPosition, snapshot.Time });
+
+    const OcclusionBuffer* occlusion = nullptr;
+    if (_renderMode == RenderMode::GpuDriven) {
+        // Culling and level selection happen on the GPU, so the CPU only uploads what moved and dispatches
+        if (_gpuCuller->GetObjectCount() != _meshes.size()) {
+            _gpuCuller->Build(_meshes);
+        } else {
+            _gpuCuller->UpdateTransforms(_meshes);
+        }
+        _gpuCuller->Cull(view, projection, static_cast<float>(_height));
+        for (auto& mesh : _meshes) {
+            if (!mesh.GetLod(0).GetArena()) {
+                mesh.SelectLod(view, projection, static_cast<float>(_height));
+            }
+        }
+
+        _indirectShader.Bind();
+        _frameStats.DrawCalls = _gpuCuller->Draw(_meshes, _indirectShader, *_indirectRenderer);
+        _frameStats.Triangles = 0;
+        _frameStats.ObjectsDrawn = 0;
+        _frameStats.ObjectsCulled = 0;
+        _frameStats.ObjectsOccluded = 0;
+    } else {
+        _frameStats.ObjectsDrawn = cullOnCpu(snapshot);
+        if (_occlusion.GetTriangleCount() > 0) {
+            occlusion = &_occlusion;
+        }
 
-    _shader.Bind();
-    _shader.SetMat4("projection", projection);
-    _shader.SetMat4("view", view);
+        _frameStats.Triangles = 0;
+        for (size_t i = 0; i < _meshes.size(); i++) {
+            if (_visible[i]) {
+                _meshes[i].SelectLod(view, projection, static_cast<float>(_height));
+                _frameStats.Triangles += _meshes[i].GetTriangleCount();
+            }
+        }
 
-    // Loop through the meshes and draw them with their respective textures
-    for (size_t i = 0; i < _meshes.size(); i++) {
-        Mesh& mesh = _meshes[i];
-        std::vector<Texture>& textures = mesh.GetTextures();
-        
-        for (size_t j = 0; j < textures.size(); j++) {
-            glActiveTexture(GL_TEXTURE0 + j);
-            textures[j].Bind();
-            _shader.SetInt("tex" + std::to_string(j), j); // Set the uniform value dynamically
+        // Immediate and sorted draws read their mesh's entry; multi-draw indirect uploads its own per-draw entries
+        if (_renderMode == RenderMode::Sorted || _renderMode == RenderMode::Immediate) {
+            _objectConstants.clear();
+            for (const auto& mesh : _meshes) {
+                _objectConstants.push_back(ConstantBuffers::MakeObject(mesh.Transform, mesh));
+            }
+            _constantBuffers->SetObjects(_objectConstants);
+        }
+
+        if (_renderMode == RenderMode::Sorted) {
+            _shader.Bind();
+            _renderQueue.Begin(projection * view);
+            for (uint32_t i = 0; i < _meshes.size(); i++) {
+                if (_visible[i]) {
+                    _renderQueue.Add(_shader, _meshes[i], i);
+                }
+            }
+            _renderQueue.Sort();
+            _frameStats.StateChanges = _renderQueue.Submit(_meshes).GetTotal();
+            _frameStats.DrawCalls = static_cast<uint32_t>(_renderQueue.GetItems().size());
+        } else if (_renderMode == RenderMode::MultiDrawIndirect) {
+            _indirectShader.Bind();
+            _frameStats.DrawCalls = _indirectRenderer->Draw(_meshes, _indirectShader, _visible);
+        } else {
+            _shader.Bind();
+            _frameStats.DrawCalls = drawImmediate();
         }
+    }
 
-        _shader.SetMat4("model", mesh.Transform);
-        mesh.Draw();
+    // Instance groups take the same path in every mode: one instanced draw per level and material in use
+    if (!_instanceGroups.empty()) {
+        _instancedShader.Bind();
+        for (auto& group : _instanceGroups) {
+            _frameStats.DrawCalls += group.Draw(_instancedShader, view, projection, static_cast<float>(_height), occlusion);
+            _frameStats.Triangles += static_cast<uint32_t>(group.GetTriangleCount());
+            _frameStats.ObjectsDrawn += group.GetVisibleCount();
+            _frameStats.ObjectsOccluded += group.GetOccludedCount();
+            _frameStats.ObjectsCulled += group.GetInstanceCount() - group.GetVisibleCount() - group.GetOccludedCount();
+        }
     }
 
+    // The finished depth buffer becomes the pyramid the next frame's GPU cull tests against
+    if (_renderMode == RenderMode::GpuDriven) {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(_window, &framebufferWidth, &framebufferHeight);
+        _gpuCuller->CaptureDepth(framebufferWidth, framebufferHeight);
+    }
+    _streamBuffer->EndFrame();
+    _frameStats.StateCallsIssued = GLState::GetCounters().Issued;
+    _frameStats.StateCallsElided = GLState::GetCounters().Elided;
+
+    _frameStats.SubmitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+
     glfwSwapBuffers(_window);
     return false;
 }
 
-void Application::handleInput(float deltaTime) {
-
-    auto moveAmount = _camera.GetSpeed() * deltaTime * 4;
+uint32_t Application::cullOnCpu(const SceneSnapshot& snapshot) {
+    // The simulation thread has already culled its scene hierarchy against the snapshot's frustum
+    _visible.assign(snapshot.Visible.begin(), snapshot.Visible.end());
+    _visible.resize(_meshes.size(), 0);
+    uint32_t visibleCount = snapshot.VisibleCount;
+    _frameStats.ObjectsCulled = static_cast<uint32_t>(_meshes.size()) - visibleCount;
 
-    if(glfwGetKey(_window, GLFW_KEY_W)){
-        _camera.MoveCamera(Camera::MoveDirection::Forward, moveAmount);
-    }
-    if(glfwGetKey(_window, GLFW_KEY_A)){
-        _camera.MoveCamera(Camera::MoveDirection::Left, moveAmount);
-    }
-    if(glfwGetKey(_window, GLFW_KEY_S)){
-        _camera.MoveCamera(Camera::MoveDirection::Backward, moveAmount);
+    // Rasterize the visible occluders into a small CPU depth buffer and drop whatever they hide
+    _occlusion.Resize(OcclusionBuffer::DefaultWidth, OcclusionBuffer::DefaultWidth * static_cast<uint32_t>(_height) / std::max(static_cast<uint32_t>(_width), 1u));
+    _occlusion.Begin(snapshot.Projection * snapshot.View);
+    for (size_t i = 0; i < _meshes.size(); i++) {
+        if (_visible[i] && _meshes[i].Occluder) {
+            _occlusion.AddOccluder(_meshes[i]);
+        }
     }
-    if(glfwGetKey(_window, GLFW_KEY_D)){
-        _camera.MoveCamera(Camera::MoveDirection::Right, moveAmount);
+    _frameStats.ObjectsOccluded = 0;
+    if (_occlusion.GetTriangleCount() > 0) {
+        _occlusion.Rasterize();
+        for (size_t i = 0; i < _meshes.size(); i++) {
+            if (_visible[i] && !_occlusion.IsVisible(_meshes[i].GetWorldBounds())) {
+                _visible[i] = 0;
+                _frameStats.ObjectsOccluded++;
+            }
+        }
     }
-    if(glfwGetKey(_window, GLFW_KEY_Q)){
-        _camera.MoveCamera(Camera::MoveDirection::Up, moveAmount);
+    return visibleCount - _frameStats.ObjectsOccluded;
+}
+
+uint32_t Application::drawImmediate() {
+    // Loop through the meshes and draw each material range with its textures, whether or not they are already bound
+    uint32_t drawCalls = 0;
+    StateChanges changes;
+    changes.Programs = 1;
+    for (size_t i = 0; i < _meshes.size(); i++) {
+        if (!_visible[i]) {
+            continue;
+        }
+        Mesh& mesh = _meshes[i];
+
+        _shader.SetInt("objectIndex", static_cast<int>(i));
+        changes.Uniforms++;
+
+        auto subMeshes = mesh.GetSubMeshes();
+        for (uint32_t s = 0; s < subMeshes.size(); s++) {
+            const TextureSet& textures = mesh.GetMaterial(subMeshes[s].Material);
+            for (size_t j = 0; j < textures.size(); j++) {
+                textures[j]->Bind(j);
+                _shader.SetInt(Shader::GetSamplerName(j), j);
+            }
+            changes.Textures += static_cast<uint32_t>(textures.size());
+            changes.Uniforms += static_cast<uint32_t>(textures.size());
+            mesh.DrawSubMesh(s);
+            changes.VertexArrays++;
+            drawCalls++;
+        }
     }
-    if(glfwGetKey(_window, GLFW_KEY_E)){
-        _camera.MoveCamera(Camera::MoveDirection::Down, moveAmount);
+
+    _frameStats.StateChanges = changes.GetTotal();
+    return drawCalls;
+}
+
+void Application::selectAt(const Ray& ray) {
+    // Building is deferred to the first click; later clicks only refit the meshes that moved
+    if (_raycaster.GetObjectCount() != _meshes.size()) {
+        _raycaster.Build(_meshes);
+    } else {
+        _raycaster.UpdateTransforms(_meshes);
     }
 
-    double xpos, ypos;
-    glfwGetCursorPos(_window, &xpos, &ypos);
-    mousePositionCallback(xpos, ypos);
+    RayHit hit = _raycaster.Raycast(ray);
+    _selectedMesh = hit.Object;
+    if (hit.IsHit()) {
+        glm::vec3 point = ray.GetPoint(hit.Distance);
+        std::cout << "Selected mesh " << hit.Object << ", triangle " << hit.Triangle << " at ("
+                  << point.x << ", " << point.y << ", " << point.z << ")" << std::endl;
+    } else {
+        std::cout << "Selection cleared" << std::endl;
+    }
 }
 
-void Application::mousePositionCallback(double xpos, double ypos) {
-    if (!_firstMouse) {
-        _lastMousePosition.x = static_cast<float>(xpos);
-        _lastMousePosition.y = static_cast<float>(ypos);
-        _firstMouse = true;
+void Application::updateFrameStats(float deltaTime) {
+    const SceneSnapshot& snapshot = _simulation.GetSnapshot();
+    if (_frameStats.Frames == 0) {
+        _frameStats.FirstTick = snapshot.Tick;
+    }
+    _frameStats.UpdateMilliseconds += snapshot.UpdateMilliseconds;
+    _frameStats.Frames++;
+    _frameStats.Elapsed += deltaTime;
+    if (_frameStats.Elapsed < 1.f) {
+        return;
     }
 
-    glm::vec2 moveAmount {
-            xpos - _lastMousePosition.x,
-            _lastMousePosition.y - ypos
-    };
-    _lastMousePosition.x = static_cast<float>(xpos);
-    _lastMousePosition.y = static_cast<float>(ypos);
+    // Report once a second so the comparison between submission paths is readable
+    std::ostringstream title;
+    title << _applicationName << " | "
+          << (_renderMode == RenderMode::GpuDriven           ? "GPU-driven"
+              : _renderMode == RenderMode::MultiDrawIndirect ? "Multi-draw indirect"
+              : _renderMode == RenderMode::Sorted            ? "Sorted"
+                                                             : "Immediate") << " | "
+          << _frameStats.DrawCalls << " draws | ";
+    if (_renderMode == RenderMode::Immediate || _renderMode == RenderMode::Sorted) {
+        title << _frameStats.StateChanges << " state changes | ";
+    }
+    title << _frameStats.StateCallsIssued << " GL state calls, " << _frameStats.StateCallsElided << " elided | ";
+    // What the GPU culls is never read back, so the counts below only cover the instance groups in that mode
+    if (_renderMode == RenderMode::GpuDriven) {
+        title << _gpuCuller->GetCandidateCount() << " candidate draws culled on GPU | instances: ";
+    }
+    title << _frameStats.Triangles << " triangles | "
+          << _frameStats.ObjectsDrawn << "/" << _frameStats.ObjectsDrawn + _frameStats.ObjectsCulled + _frameStats.ObjectsOccluded
+          << " objects visible, " << _frameStats.ObjectsOccluded << " occluded | "
+          << _frameStats.SubmitMilliseconds / _frameStats.Frames << " ms submit, "
+          << _streamBuffer->GetStats().StallMilliseconds / _frameStats.Frames << " ms stalled on stream fences | "
+          << _frameStats.UpdateMilliseconds / _frameStats.Frames << " ms update, "
+          << static_cast<uint32_t>((snapshot.Tick - _frameStats.FirstTick) / _frameStats.Elapsed) << " steps/s on the simulation thread";
+    if (_selectedMesh != RayHit::None) {
+        title << " | selected mesh " << _selectedMesh;
+    }
+    glfwSetWindowTitle(_window, title.str().c_str());
 
-    _camera.RotateBy(moveAmount.x * _camera.GetSpeed(), moveAmount.y * _camera.GetSpeed());
-}
\ No newline at end of file
+    _frameStats.SubmitMilliseconds = 0.0;
+    _frameStats.UpdateMilliseconds = 0.0;
+    _streamBuffer->ResetStats();
+    _frameStats.Frames = 0;
+    _frameStats.Elapsed = 0.f;
+}
@@ -0,0 +1,877 @@
+#include "benchmarks.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <glm/gtc/constants.hpp>
+#include <random>
+#include <thread>
+#include "bvh.h"
+#include "cylinder.h"
+#include "frustum.h"
+#include "lathe.h"
+#include "meshfile.h"
+#include "meshsimplifier.h"
+#include "occlusionbuffer.h"
+#include "parallel.h"
+#include "props.h"
+#include "raycaster.h"
+#include "renderqueue.h"
+#include "ring.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+#include "vertexformat.h"
+
+namespace {
+    // The cylinder generator as it was before the ring tables: one cosf/sinf pair and two push_backs per sector
+    // into unreserved vectors, plus an engine that is seeded and never used
+    std::vector<Vertex> legacyCylinder(float radius, float height, int sectors, std::vector<uint32_t>& indices)
+    {
+        std::vector<Vertex> vertices;
+        const float sectorStep = 2.0f * glm::pi<float>() / sectors;
+
+        Vertex topVertex;
+        topVertex.Position = glm::vec3(0.0f, height / 2.0f, 0.0f);
+        topVertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        topVertex.Uv = glm::vec2(0.5f, 0.5f);
+        vertices.push_back(topVertex);
+
+        Vertex bottomVertex;
+        bottomVertex.Position = glm::vec3(0.0f, -height / 2.0f, 0.0f);
+        bottomVertex.Normal = glm::vec3(0.0f, -1.0f, 0.0f);
+        bottomVertex.Uv = glm::vec2(0.5f, 0.5f);
+        vertices.push_back(bottomVertex);
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_real_distribution<float> colorDistribution(0.0f, 1.0f);
+
+        for (int i = 0; i <= sectors; ++i) {
+            const float sectorAngle = i * sectorStep;
+            const float x = radius * cosf(sectorAngle);
+            const float z = radius * sinf(sectorAngle);
+
+            Vertex sideVertexTop;
+            sideVertexTop.Position = glm::vec3(x, height / 2.0f, z);
+            sideVertexTop.Normal = glm::normalize(glm::vec3(x, 0.0f, z));
+            sideVertexTop.Uv = glm::vec2(1.0f - static_cast<float>(i) / sectors, 1.0f);
+            vertices.push_back(sideVertexTop);
+
+            Vertex sideVertexBottom;
+            sideVertexBottom.Position = glm::vec3(x, -height / 2.0f, z);
+            sideVertexBottom.Normal = glm::normalize(glm::vec3(x, 0.0f, z));
+            sideVertexBottom.Uv = glm::vec2(1.0f - static_cast<float>(i) / sectors, 0.0f);
+            vertices.push_back(sideVertexBottom);
+        }
+
+        for (int i = 0; i < sectors; ++i) {
+            const uint32_t currentTop = 2 * (i + 2);
+            const uint32_t nextTop = 2 * ((i + 1) % sectors + 2);
+            const uint32_t currentBottom = currentTop + 1;
+            const uint32_t nextBottom = nextTop + 1;
+            for (uint32_t index : { 0u, currentTop, nextTop, 1u, currentBottom, nextBottom,
+                                    currentTop, currentBottom, nextTop, currentBottom, nextBottom, nextTop }) {
+                indices.push_back(index);
+            }
+        }
+        return vertices;
+    }
+
+    // Stand-in for a fixed amount of update or render work
+    void spinFor(double milliseconds)
+    {
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                            std::chrono::duration<double, std::milli>(milliseconds));
+        while (std::chrono::steady_clock::now() < end) {
+        }
+    }
+
+    // Grid of gridSize x gridSize quads over [-2, 2] with a sine ripple, every position multiplied by scale
+    void rippledGrid(uint32_t gridSize, float scale, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        vertices.reserve((gridSize + 1) * (gridSize + 1));
+        for (uint32_t z = 0; z <= gridSize; z++) {
+            for (uint32_t x = 0; x <= gridSize; x++) {
+                Vertex vertex;
+                auto u = static_cast<float>(x) / gridSize;
+                auto v = static_cast<float>(z) / gridSize;
+                vertex.Position = scale * glm::vec3(u * 4.f - 2.f, 0.1f * std::sin(u * 12.f) * std::cos(v * 9.f), v * 4.f - 2.f);
+                vertex.Normal = glm::vec3(0.f, 1.f, 0.f);
+                vertex.Uv = glm::vec2(u, v);
+                vertices.push_back(vertex);
+            }
+        }
+        indices.reserve(gridSize * gridSize * 6);
+        for (uint32_t z = 0; z < gridSize; z++) {
+            for (uint32_t x = 0; x < gridSize; x++) {
+                auto corner = z * (gridSize + 1) + x;
+                indices.insert(indices.end(), { corner, corner + gridSize + 1, corner + 1,
+                                                corner + 1, corner + gridSize + 1, corner + gridSize + 2 });
+            }
+        }
+    }
+
+    template <typename Generate>
+    double millisecondsFor(Generate&& generate)
+    {
+        auto start = std::chrono::steady_clock::now();
+        generate();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int Benchmarks::Run(const std::string& name)
+{
+    bool all = name == "all";
+    bool ran = false;
+
+    if (all || name == "vertex-format") {
+        vertexFormat();
+        ran = true;
+    }
+
+    if (all || name == "generators") {
+        generators();
+        ran = true;
+    }
+
+    if (all || name == "simplify") {
+        simplify();
+        ran = true;
+    }
+
+    if (all || name == "meshfile") {
+        meshFile();
+        ran = true;
+    }
+
+    if (all || name == "culling") {
+        culling();
+        ran = true;
+    }
+
+    if (all || name == "bvh") {
+        bvh();
+        ran = true;
+    }
+
+    if (all || name == "occlusion") {
+        occlusion();
+        ran = true;
+    }
+
+    if (all || name == "raycast") {
+        raycast();
+        ran = true;
+    }
+
+    if (all || name == "renderqueue") {
+        renderQueue();
+        ran = true;
+    }
+
+    if (all || name == "handoff") {
+        handoff();
+        ran = true;
+    }
+
+    if (!ran) {
+        std::cerr << "Unknown benchmark: " << name << " (expected vertex-format, generators, simplify, meshfile, culling, bvh, occlusion, raycast, renderqueue, handoff or all)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void Benchmarks::vertexFormat()
+{
+    std::cout << "Vertex format: " << sizeof(Vertex) << "-byte Vertex vs " << sizeof(PackedVertex) << "-byte PackedVertex" << std::endl;
+    std::cout << std::setw(8) << "sectors" << std::setw(10) << "vertices" << std::setw(14) << "full bytes"
+              << std::setw(14) << "packed bytes" << std::setw(8) << "ratio" << std::setw(14) << "encode ms"
+              << std::setw(14) << "max pos err" << std::setw(14) << "max nrm deg" << std::endl;
+
+    for (int sectors : { 64, 256, 1024, 4096, 16384 }) {
+        Cylinder cylinder(0.225f, 2.025f, sectors);
+        const auto& vertices = cylinder.GetVertices();
+
+        auto start = std::chrono::steady_clock::now();
+        auto quantization = VertexEncoder::ComputeQuantization(vertices);
+        auto packed = VertexEncoder::Pack(vertices, quantization);
+        auto encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Decode on the CPU exactly like the vertex shader to bound the quantization error
+        float maxPositionError = 0.f;
+        float maxNormalDegrees = 0.f;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto decoded = VertexEncoder::Unpack(packed[i], quantization);
+            maxPositionError = std::max(maxPositionError, glm::length(decoded.Position - vertices[i].Position));
+            auto cosine = glm::clamp(glm::dot(decoded.Normal, glm::normalize(vertices[i].Normal)), -1.f, 1.f);
+            maxNormalDegrees = std::max(maxNormalDegrees, glm::degrees(std::acos(cosine)));
+        }
+
+        // Every unique vertex is fetched at least once per draw, so these are also the per-draw fetch bytes
+        auto fullBytes = vertices.size() * sizeof(Vertex);
+        auto packedBytes = packed.size() * sizeof(PackedVertex);
+        std::cout << std::setw(8) << sectors << std::setw(10) << vertices.size() << std::setw(14) << fullBytes
+                  << std::setw(14) << packedBytes << std::setw(8) << std::fixed << std::setprecision(2)
+                  << static_cast<double>(fullBytes) / packedBytes << std::setw(14) << std::setprecision(3) << encodeMs
+                  << std::setw(14) << std::scientific << std::setprecision(2) << maxPositionError
+                  << std::setw(14) << std::fixed << std::setprecision(3) << maxNormalDegrees << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+void Benchmarks::simplify()
+{
+    // A rippled grid has no seams or borders inside it, so every interior vertex is a collapse candidate
+    constexpr uint32_t gridSize = 512;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    rippledGrid(gridSize, 1.0f, vertices, indices);
+
+    auto triangles = static_cast<uint32_t>(indices.size() / 3);
+    std::cout << "Simplify: " << triangles << " triangles" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(10) << "target" << std::setw(12) << "triangles"
+              << std::setw(12) << "vertices" << std::setw(12) << "error" << std::setw(12) << "ms" << std::endl;
+
+    auto threadCount = std::max(std::thread::hardware_concurrency(), 2u);
+    for (float ratio : { 0.5f, 0.1f, 0.02f }) {
+        for (uint32_t threads : { 1u, threadCount }) {
+            MeshSimplifier::Options options;
+            options.TargetTriangleCount = static_cast<uint32_t>(triangles * ratio);
+            options.ThreadCount = threads;
+
+            auto start = std::chrono::steady_clock::now();
+            auto result = MeshSimplifier::Simplify(vertices, indices, options);
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << std::setw(10) << threads << std::setw(10) << options.TargetTriangleCount
+                      << std::setw(12) << result.Indices.size() / 3 << std::setw(12) << result.Vertices.size()
+                      << std::setw(12) << std::scientific << std::setprecision(2) << result.Error
+                      << std::setw(12) << std::fixed << std::setprecision(1) << ms << std::endl;
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+
+    // The error is an object-space distance, so scaling the mesh scales it by the same factor
+    std::cout << "Simplify error against mesh scale, 64 x 64 grid to 10%" << std::endl;
+    std::cout << std::setw(10) << "scale" << std::setw(12) << "error" << std::setw(14) << "error/scale" << std::endl;
+    float unitError = 0.0f;
+    bool linear = true;
+    for (float scale : { 1.0f, 0.1f, 10.0f }) {
+        std::vector<Vertex> scaledVertices;
+        std::vector<uint32_t> scaledIndices;
+        rippledGrid(64, scale, scaledVertices, scaledIndices);
+        MeshSimplifier::Options options;
+        options.TargetTriangleCount = static_cast<uint32_t>(scaledIndices.size() / 3 / 10);
+        auto result = MeshSimplifier::Simplify(scaledVertices, scaledIndices, options);
+        if (scale == 1.0f) {
+            unitError = result.Error;
+        }
+        linear &= std::abs(result.Error / scale - unitError) <= 1e-3f * unitError;
+        std::cout << std::setw(10) << scale << std::setw(12) << std::scientific << std::setprecision(2) << result.Error
+                  << std::setw(14) << result.Error / scale << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    std::cout << "  error scales linearly: " << (linear ? "yes" : "NO") << std::endl;
+}
+
+void Benchmarks::generators()
+{
+    constexpr int propCount = 2000;
+    constexpr float radius = 0.225f;
+    constexpr float height = 2.025f;
+
+    std::cout << "Generators: " << propCount << " cylinders kept per row, million vertices per second" << std::endl;
+    std::cout << std::setw(8) << "sectors" << std::setw(12) << "legacy" << std::setw(12) << "ring"
+              << std::setw(12) << "batch" << std::setw(10) << "threads" << std::setw(14) << "max sin err" << std::endl;
+
+    auto threads = Parallel::GetThreadCount();
+    for (int sectors : { 16, 64, 256, 1024 }) {
+        const auto vertexCount = static_cast<double>(Cylinder::VertexCount(sectors)) * propCount;
+        auto rate = [&](double milliseconds) { return vertexCount / (milliseconds * 1000.0); };
+
+        // Every row keeps all of its output alive, as a scene load would
+        std::vector<std::vector<Vertex>> legacy;
+        std::vector<std::vector<uint32_t>> legacyIndices(propCount);
+        legacy.reserve(propCount);
+        auto legacyMs = millisecondsFor([&]() {
+            for (int i = 0; i < propCount; i++) {
+                legacy.push_back(legacyCylinder(radius, height, sectors, legacyIndices[i]));
+            }
+        });
+        legacy.clear();
+        legacyIndices.clear();
+
+        std::vector<Cylinder> serial;
+        serial.reserve(propCount);
+        auto ringMs = millisecondsFor([&]() {
+            for (int i = 0; i < propCount; i++) {
+                serial.emplace_back(radius, height, sectors);
+            }
+        });
+        serial.clear();
+
+        std::vector<Cylinder::Desc> descs(propCount, Cylinder::Desc{ radius, height, sectors });
+        auto batchMs = millisecondsFor([&]() {
+            serial = Cylinder::GenerateBatch(descs);
+        });
+        serial.clear();
+
+        std::vector<float> cosines(sectors + 1);
+        std::vector<float> sines(sectors + 1);
+        std::vector<float> referenceCosines(sectors + 1);
+        std::vector<float> referenceSines(sectors + 1);
+        Ring::SinCos(sectors, cosines.data(), sines.data());
+        Ring::SinCosScalar(sectors, referenceCosines.data(), referenceSines.data());
+        float maxError = 0.f;
+        for (int s = 0; s <= sectors; s++) {
+            maxError = std::max({ maxError, std::abs(cosines[s] - referenceCosines[s]), std::abs(sines[s] - referenceSines[s]) });
+        }
+
+        std::cout << std::setw(8) << sectors << std::fixed << std::setprecision(1)
+                  << std::setw(12) << rate(legacyMs) << std::setw(12) << rate(ringMs)
+                  << std::setw(12) << rate(batchMs) << std::setw(10) << threads
+                  << std::setw(14) << std::scientific << std::setprecision(2) << maxError << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+void Benchmarks::meshFile()
+{
+    constexpr int loadCount = 20;
+
+    // Cook the bottle once, as MeshCooker does at build time
+    auto lods = Lathe::CreateLodLevels(Props::BottleProfile(), Props::ChordTolerance);
+    std::vector<MeshFile::Level> levels;
+    for (const auto& lod : lods) {
+        levels.push_back({ lod.Geometry.GetVertices(), lod.Geometry.GetIndices(), lod.Geometry.GetSubMeshes(), lod.GeometricError });
+    }
+    auto path = std::filesystem::temp_directory_path() / "showcase_benchmark.scmf";
+    if (!MeshFile::Write(path, levels)) {
+        return;
+    }
+    auto fileBytes = std::filesystem::file_size(path);
+
+    // Both sides end with every level's vertices and indices in memory, ready to upload
+    size_t generatedVertices = 0;
+    auto generateMs = millisecondsFor([&]() {
+        for (int i = 0; i < loadCount; i++) {
+            auto generated = Lathe::CreateLodLevels(Props::BottleProfile(), Props::ChordTolerance);
+            generatedVertices += generated.front().Geometry.GetVertices().size();
+        }
+    });
+
+    size_t mappedVertices = 0;
+    auto mapMs = millisecondsFor([&]() {
+        for (int i = 0; i < loadCount; i++) {
+            MeshFile file;
+            if (file.Open(path)) {
+                mappedVertices += file.GetLevel(0).Vertices.size();
+            }
+        }
+    });
+    std::filesystem::remove(path);
+
+    std::cout << "Mesh file: bottle with " << levels.size() << " levels, " << fileBytes << " bytes cooked" << std::endl;
+    std::cout << std::fixed << std::setprecision(3)
+              << "  generate + optimize: " << generateMs / loadCount << " ms per load" << std::endl
+              << "  map + validate:      " << mapMs / loadCount << " ms per load (" << generateMs / std::max(mapMs, 1e-6)
+              << "x faster)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    if (generatedVertices != mappedVertices) {
+        std::cerr << "Mesh file: cooked level 0 does not match the generated one" << std::endl;
+    }
+}
+
+void Benchmarks::culling()
+{
+    constexpr int repeats = 50;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(glm::perspective(glm::radians(75.0f), 4.0f / 3.0f, 0.1f, 100.0f) * view);
+
+    std::cout << "Culling: boxes scattered around the camera, " << FrustumCuller::GetInstructionSet() << " path" << std::endl;
+    std::cout << std::setw(10) << "boxes" << std::setw(10) << "visible" << std::setw(14) << "scalar ms"
+              << std::setw(14) << "batched ms" << std::setw(10) << "speedup" << std::endl;
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        FrustumCuller culler;
+        culler.Resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            glm::vec3 center(position(random), position(random) * 0.1f, position(random));
+            glm::vec3 extents(size(random));
+            culler.SetBounds(i, { center - extents, center + extents });
+        }
+
+        std::vector<uint8_t> scalarVisible, batchedVisible;
+        uint32_t scalarCount = 0, batchedCount = 0;
+        auto scalarMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                scalarCount = culler.CullScalar(frustum, scalarVisible);
+            }
+        }) / repeats;
+        auto batchedMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                batchedCount = culler.Cull(frustum, batchedVisible);
+            }
+        }) / repeats;
+
+        std::cout << std::setw(10) << count << std::setw(10) << batchedCount << std::fixed << std::setprecision(4)
+                  << std::setw(14) << scalarMs << std::setw(14) << batchedMs << std::setprecision(1)
+                  << std::setw(10) << scalarMs / std::max(batchedMs, 1e-9) << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        if (scalarCount != batchedCount || scalarVisible != batchedVisible) {
+            std::cerr << "Culling: batched results differ from the scalar reference" << std::endl;
+        }
+    }
+}
+
+void Benchmarks::bvh()
+{
+    constexpr int repeats = 20;
+    constexpr int queries = 1000;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(glm::perspective(glm::radians(75.0f), 4.0f / 3.0f, 0.1f, 100.0f) * view);
+
+    std::cout << "BVH: hierarchy speedup over flat scans per query (" << FrustumCuller::GetInstructionSet() << " flat frustum test)" << std::endl;
+    std::cout << std::setw(10) << "boxes" << std::setw(10) << "build ms" << std::setw(10) << "refit ms"
+              << std::setw(12) << "frustum" << std::setw(12) << "sphere" << std::setw(12) << "nearest" << std::endl;
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        std::vector<BoundingBox> boxes(count);
+        FrustumCuller culler;
+        culler.Resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            glm::vec3 center(position(random), position(random) * 0.1f, position(random));
+            glm::vec3 extents(size(random));
+            boxes[i] = { center - extents, center + extents };
+            culler.SetBounds(i, boxes[i]);
+        }
+        std::vector<BoundingSphere> spheres(queries);
+        for (auto& sphere : spheres) {
+            sphere = { glm::vec3(position(random), 0.0f, position(random)), 5.0f };
+        }
+
+        Bvh hierarchy;
+        auto buildMs = millisecondsFor([&]() { hierarchy.Build(boxes); });
+
+        // Flat references: the SIMD frustum scan and brute-force loops over every box
+        std::vector<uint8_t> flatVisible, treeVisible;
+        uint32_t flatCount = 0, treeCount = 0;
+        auto flatFrustumMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                flatCount = culler.Cull(frustum, flatVisible);
+            }
+        }) / repeats;
+        auto treeFrustumMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                treeCount = hierarchy.Cull(frustum, treeVisible);
+            }
+        }) / repeats;
+
+        uint64_t flatOverlaps = 0, treeOverlaps = 0;
+        std::vector<uint32_t> results;
+        auto flatSphereMs = millisecondsFor([&]() {
+            for (const auto& sphere : spheres) {
+                for (const auto& box : boxes) {
+                    glm::vec3 outside = glm::max(glm::max(box.Min - sphere.Center, sphere.Center - box.Max), glm::vec3(0.0f));
+                    flatOverlaps += glm::dot(outside, outside) <= sphere.Radius * sphere.Radius;
+                }
+            }
+        }) / queries;
+        auto treeSphereMs = millisecondsFor([&]() {
+            for (const auto& sphere : spheres) {
+                treeOverlaps += hierarchy.QueryOverlap(sphere, results);
+            }
+        }) / queries;
+
+        bool nearestMatches = true;
+        std::vector<float> flatNearest(queries, FLT_MAX);
+        auto flatNearestMs = millisecondsFor([&]() {
+            for (int q = 0; q < queries; q++) {
+                for (const auto& box : boxes) {
+                    glm::vec3 outside = glm::max(glm::max(box.Min - spheres[q].Center, spheres[q].Center - box.Max), glm::vec3(0.0f));
+                    flatNearest[q] = std::min(flatNearest[q], glm::length(outside));
+                }
+            }
+        }) / queries;
+        std::vector<Bvh::Nearest> treeNearest(queries);
+        auto treeNearestMs = millisecondsFor([&]() {
+            for (int q = 0; q < queries; q++) {
+                treeNearest[q] = hierarchy.FindNearest(spheres[q].Center);
+            }
+        }) / queries;
+        for (int q = 0; q < queries; q++) {
+            nearestMatches = nearestMatches && std::abs(treeNearest[q].Distance - flatNearest[q]) <= 1e-4f;
+        }
+
+        // Nudge every box as if each object moved a little, then refit in place
+        for (auto& box : boxes) {
+            glm::vec3 offset(jitter(random), 0.0f, jitter(random));
+            box = { box.Min + offset, box.Max + offset };
+        }
+        auto refitMs = millisecondsFor([&]() {
+            for (uint32_t i = 0; i < count; i++) {
+                hierarchy.Update(i, boxes[i]);
+            }
+        });
+        culler.Resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            culler.SetBounds(i, boxes[i]);
+        }
+        flatCount = culler.Cull(frustum, flatVisible);
+        treeCount = hierarchy.Cull(frustum, treeVisible);
+
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(3) << std::setw(10) << buildMs << std::setw(10) << refitMs
+                  << std::setprecision(1) << std::setw(11) << flatFrustumMs / std::max(treeFrustumMs, 1e-9) << "x"
+                  << std::setw(11) << flatSphereMs / std::max(treeSphereMs, 1e-9) << "x"
+                  << std::setw(11) << flatNearestMs / std::max(treeNearestMs, 1e-9) << "x" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        if (flatCount != treeCount || flatVisible != treeVisible || flatOverlaps != treeOverlaps || !nearestMatches) {
+            std::cerr << "BVH: hierarchy results differ from the flat reference" << std::endl;
+        }
+        if (hierarchy.NeedsRebuild()) {
+            std::cout << std::setw(10) << "" << " refit cost " << hierarchy.GetCost() << " passed the rebuild threshold" << std::endl;
+        }
+    }
+}
+
+void Benchmarks::occlusion()
+{
+    constexpr int repeats = 20;
+    constexpr uint32_t wallQuads = 64;  // Per side, two triangles each
+    constexpr float wallSize = 64.0f;  // One unit per quad, so the window below falls on quad edges
+    constexpr float wallDistance = 10.0f;
+    const glm::vec2 windowMin(-3.0f, -1.0f), windowMax(3.0f, 5.0f);  // Hole in the wall the camera looks through
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = glm::perspective(glm::radians(75.0f), 4.0f / 3.0f, 0.1f, 100.0f) * view;
+
+    // A finely tessellated wall across the whole view with a window in it
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    float step = wallSize / wallQuads;
+    for (uint32_t y = 0; y < wallQuads; y++) {
+        for (uint32_t x = 0; x < wallQuads; x++) {
+            glm::vec2 min(-wallSize * 0.5f + x * step, -wallSize * 0.5f + y * step);
+            glm::vec2 max = min + step;
+            if (min.x >= windowMin.x && max.x <= windowMax.x && min.y >= windowMin.y && max.y <= windowMax.y) {
+                continue;
+            }
+            auto first = static_cast<uint32_t>(vertices.size());
+            for (glm::vec2 corner : { min, glm::vec2(max.x, min.y), max, glm::vec2(min.x, max.y) }) {
+                Vertex vertex;
+                vertex.Position = glm::vec3(corner, -wallDistance);
+                vertices.push_back(vertex);
+            }
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+    }
+
+    std::cout << "Occlusion: " << indices.size() / 3 << "-triangle wall with a window, " << OcclusionBuffer::DefaultWidth << "x240 buffer" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(14) << "raster ms" << std::endl;
+    OcclusionBuffer buffer;
+    buffer.Resize(OcclusionBuffer::DefaultWidth, 240);
+    std::vector<uint32_t> threadCounts{ 1 };
+    if (Parallel::GetThreadCount() > 1) {
+        threadCounts.push_back(Parallel::GetThreadCount());
+    }
+    for (uint32_t threads : threadCounts) {
+        auto rasterMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                buffer.Begin(viewProjection);
+                buffer.AddOccluder(vertices, indices, glm::mat4(1.0f));
+                buffer.Rasterize(threads);
+            }
+        }) / repeats;
+        std::cout << std::setw(10) << threads << std::fixed << std::setprecision(4) << std::setw(14) << rasterMs << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    // Boxes in front of the wall must never be hidden, nor may boxes seen through the window
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> across(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> depth(-90.0f, -1.0f);
+    std::uniform_real_distribution<float> size(0.1f, 1.0f);
+    std::vector<BoundingBox> boxes(10000);
+    for (auto& box : boxes) {
+        float z = depth(random);
+        glm::vec3 center(across(random) * -z / 40.0f, 2.0f + across(random) * -z / 60.0f, z);
+        glm::vec3 extents(size(random));
+        box = { center - extents, center + extents };
+    }
+    std::vector<uint8_t> visible(boxes.size());
+    auto testMs = millisecondsFor([&]() {
+        for (size_t i = 0; i < boxes.size(); i++) {
+            visible[i] = buffer.IsVisible(boxes[i]);
+        }
+    });
+
+    auto toScreen = [&](glm::vec3 point) {
+        glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+        return glm::vec2(clip) / clip.w;
+    };
+    glm::vec2 windowScreenMin = toScreen(glm::vec3(windowMin, -wallDistance));
+    glm::vec2 windowScreenMax = toScreen(glm::vec3(windowMax, -wallDistance));
+    uint32_t behind = 0, hidden = 0, wronglyHidden = 0;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        const BoundingBox& box = boxes[i];
+        bool inFront = box.Max.z > -wallDistance;
+        bool throughWindow = false;
+        if (!inFront) {
+            glm::vec2 near0 = toScreen(glm::vec3(box.Min.x, box.Min.y, box.Max.z)), near1 = toScreen(box.Max);
+            glm::vec2 far0 = toScreen(box.Min), far1 = toScreen(glm::vec3(box.Max.x, box.Max.y, box.Min.z));
+            glm::vec2 min = glm::min(glm::min(near0, near1), glm::min(far0, far1));
+            glm::vec2 max = glm::max(glm::max(near0, near1), glm::max(far0, far1));
+            throughWindow = min.x <= windowScreenMax.x && max.x >= windowScreenMin.x && min.y <= windowScreenMax.y && max.y >= windowScreenMin.y;
+            behind++;
+        }
+        hidden += !visible[i];
+        wronglyHidden += !visible[i] && (inFront || throughWindow);
+    }
+    std::cout << boxes.size() << " boxes tested in " << testMs << " ms; " << hidden << " of the " << behind
+              << " behind the wall hidden" << std::endl;
+    if (wronglyHidden > 0) {
+        std::cerr << "Occlusion: " << wronglyHidden << " boxes in front of the wall or behind its window were hidden" << std::endl;
+    }
+}
+
+void Benchmarks::raycast()
+{
+    constexpr uint32_t gridSize = 64;  // Rays per side of the view
+    constexpr uint32_t bruteForceRays = 64;  // Brute force is timed on this many rays and scaled to the whole grid
+
+    std::cout << "Raycast: " << gridSize * gridSize << " camera rays at a lathed bottle, brute force estimated from "
+              << bruteForceRays << " rays" << std::endl;
+    std::cout << std::setw(8) << "sectors" << std::setw(11) << "triangles" << std::setw(10) << "build ms" << std::setw(12) << "brute ms"
+              << std::setw(12) << "single ms" << std::setw(12) << "packet ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatches" << std::endl;
+    for (int sectors : { 64, 256, 1024 }) {
+        Lathe lathe(Props::BottleProfile(), sectors);
+        auto vertices = lathe.GetVertices();
+        auto indices = lathe.GetIndices();
+
+        TriangleBvh tree;
+        auto buildMs = millisecondsFor([&]() { tree.Build(vertices, indices); });
+
+        // A grid of rays from in front of the bottle, covering its box
+        BoundingBox bounds = tree.GetBounds();
+        glm::vec3 extents = bounds.GetExtents();
+        glm::vec3 eye = bounds.GetCenter() + glm::vec3(0.0f, 0.0f, 4.0f * std::max(extents.x, extents.y));
+        std::vector<Ray> rays;
+        for (uint32_t y = 0; y < gridSize; y++) {
+            for (uint32_t x = 0; x < gridSize; x++) {
+                glm::vec3 target = bounds.GetCenter() + extents * glm::vec3(2.0f * x / (gridSize - 1) - 1.0f, 2.0f * y / (gridSize - 1) - 1.0f, 0.0f);
+                rays.push_back({ eye, glm::normalize(target - eye) });
+            }
+        }
+
+        // Scalar Moller-Trumbore over every triangle
+        auto bruteForce = [&](const Ray& ray) {
+            float closest = ray.MaxDistance;
+            for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                glm::vec3 corner = vertices[indices[t]].Position;
+                glm::vec3 edge1 = vertices[indices[t + 1]].Position - corner;
+                glm::vec3 edge2 = vertices[indices[t + 2]].Position - corner;
+                glm::vec3 p = glm::cross(ray.Direction, edge2);
+                float inverse = 1.0f / glm::dot(edge1, p);
+                glm::vec3 toOrigin = ray.Origin - corner;
+                float u = glm::dot(toOrigin, p) * inverse;
+                glm::vec3 q = glm::cross(toOrigin, edge1);
+                float v = glm::dot(ray.Direction, q) * inverse;
+                float distance = glm::dot(edge2, q) * inverse;
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < closest) {
+                    closest = distance;
+                }
+            }
+            return closest;
+        };
+        std::vector<float> expected(bruteForceRays);
+        uint32_t stride = static_cast<uint32_t>(rays.size()) / bruteForceRays;
+        auto bruteMs = millisecondsFor([&]() {
+            for (uint32_t i = 0; i < bruteForceRays; i++) {
+                expected[i] = bruteForce(rays[i * stride]);
+            }
+        }) * stride;
+
+        // The same rays through the tree with only the first lane of each packet in use, then four at a time
+        std::vector<float> single(rays.size()), packed(rays.size());
+        RayPacket packet;
+        RayPacketHit hits;
+        auto singleMs = millisecondsFor([&]() {
+            for (size_t i = 0; i < rays.size(); i++) {
+                packet.Set(0, rays[i]);
+                for (uint32_t lane = 1; lane < RayPacket::Width; lane++) {
+                    packet.Clear(lane);
+                }
+                tree.Intersect(packet, hits, 0);
+                single[i] = packet.MaxDistance[0];
+            }
+        });
+        auto packetMs = millisecondsFor([&]() {
+            for (size_t i = 0; i < rays.size(); i += RayPacket::Width) {
+                for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                    packet.Set(lane, rays[i + lane]);
+                }
+                tree.Intersect(packet, hits, 0);
+                std::copy(packet.MaxDistance, packet.MaxDistance + RayPacket::Width, packed.begin() + i);
+            }
+        });
+
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < bruteForceRays; i++) {
+            float a = expected[i], b = single[i * stride], c = packed[i * stride];
+            bool same = a == FLT_MAX ? b == FLT_MAX && c == FLT_MAX : std::fabs(a - b) <= 1e-4f * a && std::fabs(a - c) <= 1e-4f * a;
+            mismatches += same ? 0 : 1;
+        }
+        std::cout << std::setw(8) << sectors << std::setw(11) << indices.size() / 3 << std::fixed << std::setprecision(3)
+                  << std::setw(10) << buildMs << std::setw(12) << bruteMs << std::setw(12) << singleMs << std::setw(12) << packetMs
+                  << std::setprecision(1) << std::setw(9) << bruteMs / std::max(packetMs, 1e-9) << "x" << std::setw(12) << mismatches << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+void Benchmarks::renderQueue()
+{
+    constexpr int repeats = 10;
+
+    // Keys shaped like a scene's: a few programs, some hundreds of texture sets, a handful of vertex arrays and any depth
+    std::mt19937 random(9);
+    std::uniform_int_distribution<uint32_t> program(0, 3);
+    std::uniform_int_distribution<uint32_t> textureSet(0, 299);
+    std::uniform_int_distribution<uint32_t> vertexArray(0, 7);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+    std::cout << "Render queue: keys of draws spread over 4 programs, 300 texture sets and 8 vertex arrays" << std::endl;
+    std::cout << std::setw(10) << "draws" << std::setw(12) << "radix ms" << std::setw(12) << "std ms" << std::setw(10) << "speedup"
+              << std::setw(8) << "same" << std::endl;
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        std::vector<RenderQueue::Item> items(count);
+        for (uint32_t i = 0; i < count; i++) {
+            items[i] = { RenderQueue::MakeKey(0, program(random), textureSet(random), vertexArray(random), depth(random)), i, 0 };
+        }
+
+        RenderQueue queue;
+        auto radixMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                queue.Begin(glm::mat4(1.0f));
+                for (const auto& item : items) {
+                    queue.Add(item.Key, item.Mesh, item.SubMesh);
+                }
+                queue.Sort();
+            }
+        }) / repeats;
+
+        std::vector<RenderQueue::Item> sorted;
+        auto stdMs = millisecondsFor([&]() {
+            for (int r = 0; r < repeats; r++) {
+                sorted = items;
+                std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.Key < b.Key; });
+            }
+        }) / repeats;
+
+        auto result = queue.GetItems();
+        bool same = std::equal(result.begin(), result.end(), sorted.begin(), sorted.end(),
+                               [](const auto& a, const auto& b) { return a.Key == b.Key && a.Mesh == b.Mesh; });
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(4) << std::setw(12) << radixMs << std::setw(12) << stdMs
+                  << std::setprecision(1) << std::setw(9) << stdMs / std::max(radixMs, 1e-9) << "x" << std::setw(8) << (same ? "yes" : "NO") << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+void Benchmarks::handoff()
+{
+    // Events from one producer thread to one consumer, as the GLFW callbacks feed the simulation thread
+    constexpr uint32_t eventCount = 1000000;
+    auto spscMs = millisecondsFor([&]() {
+        auto queue = std::make_unique<SpscQueue<uint32_t, 1024>>();
+        std::thread producer([&]() {
+            for (uint32_t i = 0; i < eventCount;) {
+                if (queue->TryPush(i)) {
+                    i++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        uint32_t event;
+        for (uint32_t received = 0; received < eventCount;) {
+            if (queue->TryPop(event)) {
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+    });
+    auto mutexMs = millisecondsFor([&]() {
+        std::mutex mutex;
+        std::deque<uint32_t> queue;
+        std::thread producer([&]() {
+            for (uint32_t i = 0; i < eventCount; i++) {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(i);
+            }
+        });
+        for (uint32_t received = 0; received < eventCount;) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!queue.empty()) {
+                queue.pop_front();
+                received++;
+            }
+        }
+        producer.join();
+    });
+    std::cout << "Input queue: " << eventCount << " events between two threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "  lock-free SPSC " << spscMs << " ms, mutex and deque " << mutexMs << " ms ("
+              << std::setprecision(1) << mutexMs / std::max(spscMs, 1e-9) << "x)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    // Frames of fixed update and render cost, one after the other on one thread against a simulation thread
+    // publishing snapshots the render loop picks up; with a core each the frame costs the longer of the two
+    constexpr int frames = 60;
+    std::cout << "Frame loop: " << frames << " frames on " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::setw(12) << "update ms" << std::setw(12) << "render ms" << std::setw(14) << "lockstep ms" << std::setw(14) << "pipelined ms"
+              << std::setw(10) << "speedup" << std::endl;
+    for (auto [updateMs, renderMs] : { std::pair{ 2.0, 4.0 }, std::pair{ 4.0, 4.0 }, std::pair{ 4.0, 2.0 } }) {
+        auto lockstepMs = millisecondsFor([&]() {
+            for (int f = 0; f < frames; f++) {
+                spinFor(updateMs);
+                spinFor(renderMs);
+            }
+        }) / frames;
+
+        TripleBuffer<uint64_t> snapshots;
+        std::atomic<bool> running{ true };
+        std::thread simulation([&]() {
+            for (uint64_t tick = 1; running.load(std::memory_order_acquire); tick++) {
+                spinFor(updateMs);
+                snapshots.GetWriteBuffer() = tick;
+                snapshots.Publish();
+            }
+        });
+        auto pipelinedMs = millisecondsFor([&]() {
+            for (int f = 0; f < frames; f++) {
+                snapshots.Acquire();
+                spinFor(renderMs);
+            }
+        }) / frames;
+        running.store(false, std::memory_order_release);
+        simulation.join();
+
+        std::cout << std::fixed << std::setprecision(2) << std::setw(12) << updateMs << std::setw(12) << renderMs << std::setw(14) << lockstepMs
+                  << std::setw(14) << pipelinedMs << std::setprecision(1) << std::setw(9) << lockstepMs / std::max(pipelinedMs, 1e-9) << "x" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
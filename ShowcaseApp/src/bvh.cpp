@@ -0,0 +1,444 @@
+#include "bvh.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace {
+    constexpr uint32_t BinCount = 12;  // Candidate split planes per axis are the boundaries between these bins
+    constexpr uint32_t MaxLeafObjects = 4;  // Larger leaves are split even when the heuristic prefers not to
+    constexpr uint32_t SahDepth = 32;  // Deeper nodes split at the median, which bounds the depth at about 64
+    constexpr uint32_t StackSize = 96;  // Traversal stacks hold at most one entry per level plus one
+    constexpr float TraversalCost = 1.0f;  // Cost of visiting an inner node relative to testing one object
+    constexpr float RebuildRatio = 1.5f;  // Refitted cost over build cost at which a rebuild pays for itself
+
+    float halfArea(glm::vec3 min, glm::vec3 max)
+    {
+        if (min.x > max.x) {
+            return 0.0f;
+        }
+        glm::vec3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    float squaredDistance(glm::vec3 point, glm::vec3 min, glm::vec3 max)
+    {
+        if (min.x > max.x) {
+            return FLT_MAX;
+        }
+        glm::vec3 outside = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(outside, outside);
+    }
+
+    bool overlaps(const BoundingBox& box, glm::vec3 min, glm::vec3 max)
+    {
+        return box.Min.x <= max.x && box.Max.x >= min.x && box.Min.y <= max.y && box.Max.y >= min.y
+            && box.Min.z <= max.z && box.Max.z >= min.z;
+    }
+
+    // -1 when the box is outside the plane, 1 when it is entirely inside, 0 when it straddles it
+    int classify(const glm::vec4& plane, glm::vec3 min, glm::vec3 max)
+    {
+        glm::vec3 center = (min + max) * 0.5f;
+        glm::vec3 extents = (max - min) * 0.5f;
+        float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+        if (distance + radius < 0.0f) {
+            return -1;
+        }
+        return distance - radius >= 0.0f ? 1 : 0;
+    }
+}
+
+void Bvh::Build(std::span<const BoundingBox> bounds)
+{
+    auto count = static_cast<uint32_t>(bounds.size());
+    _bounds.assign(bounds.begin(), bounds.end());
+    _objects.resize(count);
+    std::iota(_objects.begin(), _objects.end(), 0u);
+    _centroids.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        _centroids[i] = _bounds[i].IsEmpty() ? glm::vec3(0.0f) : _bounds[i].GetCenter();
+    }
+    _leaves.assign(count, None);
+
+    _nodes.clear();
+    _parents.clear();
+    _refitted = false;
+    if (count == 0) {
+        _buildCost = 0.0f;
+        return;
+    }
+
+    // A binary tree over n leaves of at least one object has at most 2n - 1 nodes; reserving keeps indices stable
+    _nodes.reserve(2 * count - 1);
+    _parents.reserve(2 * count - 1);
+    _nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), count });
+    _parents.push_back(None);
+    subdivide(0, 0);
+
+    _centroids.clear();
+    _centroids.shrink_to_fit();
+    _buildCost = GetCost();
+}
+
+void Bvh::Rebuild()
+{
+    std::vector<BoundingBox> bounds = std::move(_bounds);
+    Build(bounds);
+}
+
+void Bvh::subdivide(uint32_t nodeIndex, uint32_t depth)
+{
+    BvhNode& node = _nodes[nodeIndex];
+    refitLeaf(node);
+    uint32_t first = node.First;
+    uint32_t count = node.Count;
+
+    auto makeLeaf = [&]() {
+        for (uint32_t i = first; i < first + count; i++) {
+            _leaves[_objects[i]] = nodeIndex;
+        }
+    };
+    if (count == 1) {
+        makeLeaf();
+        return;
+    }
+
+    BoundingBox centroidBounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        centroidBounds.Expand(_centroids[_objects[i]]);
+    }
+    glm::vec3 centroidSize = centroidBounds.Max - centroidBounds.Min;
+
+    // Binned surface area heuristic: sweep the bin boundaries of each axis for the cheapest split
+    int bestAxis = -1;
+    uint32_t bestBin = 0;
+    float bestCost = static_cast<float>(count);  // Cost of keeping every object in this leaf
+    if (depth < SahDepth) {
+        float parentArea = halfArea(node.Min, node.Max);
+        for (int axis = 0; axis < 3; axis++) {
+            if (centroidSize[axis] <= 0.0f || parentArea <= 0.0f) {
+                continue;
+            }
+            std::array<BoundingBox, BinCount> bins;
+            std::array<uint32_t, BinCount> binCounts{};
+            float scale = BinCount / centroidSize[axis];
+            for (uint32_t i = first; i < first + count; i++) {
+                uint32_t object = _objects[i];
+                auto bin = std::min(BinCount - 1, static_cast<uint32_t>((_centroids[object][axis] - centroidBounds.Min[axis]) * scale));
+                bins[bin].Expand(_bounds[object]);
+                binCounts[bin]++;
+            }
+
+            // Right-hand areas and counts for every boundary, then a left-to-right sweep
+            std::array<float, BinCount> rightArea{};
+            std::array<uint32_t, BinCount> rightCount{};
+            BoundingBox right;
+            uint32_t rightObjects = 0;
+            for (uint32_t b = BinCount - 1; b > 0; b--) {
+                right.Expand(bins[b]);
+                rightObjects += binCounts[b];
+                rightArea[b] = halfArea(right.Min, right.Max);
+                rightCount[b] = rightObjects;
+            }
+            BoundingBox left;
+            uint32_t leftObjects = 0;
+            for (uint32_t b = 1; b < BinCount; b++) {
+                left.Expand(bins[b - 1]);
+                leftObjects += binCounts[b - 1];
+                if (leftObjects == 0 || rightCount[b] == 0) {
+                    continue;
+                }
+                float cost = TraversalCost + (halfArea(left.Min, left.Max) * leftObjects + rightArea[b] * rightCount[b]) / parentArea;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+        if (bestAxis < 0 && count <= MaxLeafObjects) {
+            makeLeaf();
+            return;
+        }
+    }
+
+    auto begin = _objects.begin() + first;
+    auto end = begin + count;
+    auto middle = begin;
+    if (bestAxis >= 0) {
+        float scale = BinCount / centroidSize[bestAxis];
+        float minimum = centroidBounds.Min[bestAxis];
+        middle = std::partition(begin, end, [&](uint32_t object) {
+            return std::min(BinCount - 1, static_cast<uint32_t>((_centroids[object][bestAxis] - minimum) * scale)) < bestBin;
+        });
+    }
+    if (middle == begin || middle == end) {
+        // No useful split plane (too deep, or every centroid in one place): halve along the widest centroid axis
+        int axis = centroidSize.x >= centroidSize.y && centroidSize.x >= centroidSize.z ? 0 : (centroidSize.y >= centroidSize.z ? 1 : 2);
+        middle = begin + count / 2;
+        std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) { return _centroids[a][axis] < _centroids[b][axis]; });
+    }
+
+    auto leftCount = static_cast<uint32_t>(middle - begin);
+    auto leftIndex = static_cast<uint32_t>(_nodes.size());
+    _nodes.push_back({ glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount });
+    _nodes.push_back({ glm::vec3(0.0f), first + leftCount, glm::vec3(0.0f), count - leftCount });
+    _parents.push_back(nodeIndex);
+    _parents.push_back(nodeIndex);
+    _nodes[nodeIndex].First = leftIndex;
+    _nodes[nodeIndex].Count = 0;
+    subdivide(leftIndex, depth + 1);
+    subdivide(leftIndex + 1, depth + 1);
+}
+
+void Bvh::refitLeaf(BvhNode& node) const
+{
+    BoundingBox box;
+    for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+        box.Expand(_bounds[_objects[i]]);
+    }
+    node.Min = box.Min;
+    node.Max = box.Max;
+}
+
+bool Bvh::Update(uint32_t object, const BoundingBox& box)
+{
+    if (box.Min == _bounds[object].Min && box.Max == _bounds[object].Max) {
+        return false;
+    }
+    _bounds[object] = box;
+    _refitted = true;
+
+    uint32_t index = _leaves[object];
+    refitLeaf(_nodes[index]);
+    // Walk up until an ancestor's bounds come out unchanged; everything above it is then still correct
+    for (index = _parents[index]; index != None; index = _parents[index]) {
+        BvhNode& node = _nodes[index];
+        const BvhNode& left = _nodes[node.First];
+        const BvhNode& right = _nodes[node.First + 1];
+        glm::vec3 min = glm::min(left.Min, right.Min);
+        glm::vec3 max = glm::max(left.Max, right.Max);
+        if (min == node.Min && max == node.Max) {
+            break;
+        }
+        node.Min = min;
+        node.Max = max;
+    }
+    return true;
+}
+
+void Bvh::Refit()
+{
+    // Children always follow their parent, so a reverse pass sees both children before the parent
+    for (auto node = _nodes.rbegin(); node != _nodes.rend(); ++node) {
+        if (node->IsLeaf()) {
+            refitLeaf(*node);
+        } else {
+            node->Min = glm::min(_nodes[node->First].Min, _nodes[node->First + 1].Min);
+            node->Max = glm::max(_nodes[node->First].Max, _nodes[node->First + 1].Max);
+        }
+    }
+    _refitted = true;
+}
+
+float Bvh::GetCost() const
+{
+    if (_nodes.empty()) {
+        return 0.0f;
+    }
+    float rootArea = halfArea(_nodes[0].Min, _nodes[0].Max);
+    if (rootArea <= 0.0f) {
+        return static_cast<float>(_bounds.size());
+    }
+    float cost = 0.0f;
+    for (const auto& node : _nodes) {
+        cost += halfArea(node.Min, node.Max) * (node.IsLeaf() ? static_cast<float>(node.Count) : TraversalCost);
+    }
+    return cost / rootArea;
+}
+
+bool Bvh::NeedsRebuild() const
+{
+    return _refitted && GetCost() > _buildCost * RebuildRatio;
+}
+
+uint32_t Bvh::Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const
+{
+    visible.assign(_bounds.size(), 0);
+    if (_nodes.empty()) {
+        return 0;
+    }
+
+    struct Entry {
+        uint32_t Node;
+        uint32_t Planes;  // Bit per plane the node still has to be tested against
+    };
+    constexpr uint32_t AllPlanes = (1u << Frustum::PlaneCount) - 1;
+    const auto& planes = frustum.GetPlanes();
+    std::array<Entry, StackSize> stack;
+    uint32_t size = 0;
+    stack[size++] = { 0, AllPlanes };
+
+    uint32_t visibleCount = 0;
+    while (size > 0) {
+        Entry entry = stack[--size];
+        const BvhNode& node = _nodes[entry.Node];
+        uint32_t mask = entry.Planes;
+        bool outside = false;
+        for (uint32_t p = 0; p < Frustum::PlaneCount && !outside; p++) {
+            if (mask & (1u << p)) {
+                int side = classify(planes[p], node.Min, node.Max);
+                outside = side < 0;
+                mask &= side > 0 ? ~(1u << p) : ~0u;
+            }
+        }
+        if (outside) {
+            continue;
+        }
+        if (mask == 0) {
+            // Entirely inside: the subtree's objects are one contiguous run, from its leftmost to its rightmost leaf
+            uint32_t leftmost = entry.Node, rightmost = entry.Node;
+            while (!_nodes[leftmost].IsLeaf()) {
+                leftmost = _nodes[leftmost].First;
+            }
+            while (!_nodes[rightmost].IsLeaf()) {
+                rightmost = _nodes[rightmost].First + 1;
+            }
+            for (uint32_t i = _nodes[leftmost].First; i < _nodes[rightmost].First + _nodes[rightmost].Count; i++) {
+                visible[_objects[i]] = !_bounds[_objects[i]].IsEmpty();
+                visibleCount += visible[_objects[i]];
+            }
+            continue;
+        }
+
+        if (!node.IsLeaf()) {
+            stack[size++] = { node.First + 1, mask };
+            stack[size++] = { node.First, mask };
+            continue;
+        }
+        for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+            uint32_t object = _objects[i];
+            const BoundingBox& box = _bounds[object];
+            bool inside = !box.IsEmpty();
+            for (uint32_t p = 0; p < Frustum::PlaneCount && inside; p++) {
+                inside = !(mask & (1u << p)) || classify(planes[p], box.Min, box.Max) >= 0;
+            }
+            visible[object] = inside;
+            visibleCount += inside;
+        }
+    }
+    return visibleCount;
+}
+
+uint32_t Bvh::QueryOverlap(const BoundingBox& box, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    if (_nodes.empty() || box.IsEmpty()) {
+        return 0;
+    }
+    std::array<uint32_t, StackSize> stack;
+    uint32_t size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+        const BvhNode& node = _nodes[stack[--size]];
+        if (!overlaps(box, node.Min, node.Max)) {
+            continue;
+        }
+        if (!node.IsLeaf()) {
+            stack[size++] = node.First + 1;
+            stack[size++] = node.First;
+            continue;
+        }
+        for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+            const BoundingBox& objectBox = _bounds[_objects[i]];
+            if (overlaps(box, objectBox.Min, objectBox.Max)) {
+                results.push_back(_objects[i]);
+            }
+        }
+    }
+    return static_cast<uint32_t>(results.size());
+}
+
+uint32_t Bvh::QueryOverlap(const BoundingSphere& sphere, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    if (_nodes.empty()) {
+        return 0;
+    }
+    float radiusSquared = sphere.Radius * sphere.Radius;
+    std::array<uint32_t, StackSize> stack;
+    uint32_t size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+        const BvhNode& node = _nodes[stack[--size]];
+        if (squaredDistance(sphere.Center, node.Min, node.Max) > radiusSquared) {
+            continue;
+        }
+        if (!node.IsLeaf()) {
+            stack[size++] = node.First + 1;
+            stack[size++] = node.First;
+            continue;
+        }
+        for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+            const BoundingBox& objectBox = _bounds[_objects[i]];
+            if (squaredDistance(sphere.Center, objectBox.Min, objectBox.Max) <= radiusSquared) {
+                results.push_back(_objects[i]);
+            }
+        }
+    }
+    return static_cast<uint32_t>(results.size());
+}
+
+Bvh::Nearest Bvh::FindNearest(glm::vec3 point, float maxDistance) const
+{
+    Nearest nearest;
+    if (_nodes.empty()) {
+        return nearest;
+    }
+
+    struct Entry {
+        uint32_t Node;
+        float Distance;  // Squared distance from the point to the node, so entries made stale by a closer hit are skipped
+    };
+    float best = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+    std::array<Entry, StackSize> stack;
+    uint32_t size = 0;
+    stack[size++] = { 0, squaredDistance(point, _nodes[0].Min, _nodes[0].Max) };
+    while (size > 0) {
+        Entry entry = stack[--size];
+        if (entry.Distance >= best) {
+            continue;
+        }
+        const BvhNode& node = _nodes[entry.Node];
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+                const BoundingBox& box = _bounds[_objects[i]];
+                float distance = squaredDistance(point, box.Min, box.Max);
+                if (distance < best) {
+                    best = distance;
+                    nearest.Object = _objects[i];
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is searched first and tightens the bound sooner
+        Entry left{ node.First, squaredDistance(point, _nodes[node.First].Min, _nodes[node.First].Max) };
+        Entry right{ node.First + 1, squaredDistance(point, _nodes[node.First + 1].Min, _nodes[node.First + 1].Max) };
+        if (left.Distance < right.Distance) {
+            std::swap(left, right);
+        }
+        if (left.Distance < best) {
+            stack[size++] = left;
+        }
+        if (right.Distance < best) {
+            stack[size++] = right;
+        }
+    }
+    if (nearest.Object != None) {
+        nearest.Distance = std::sqrt(best);
+    }
+    return nearest;
+}
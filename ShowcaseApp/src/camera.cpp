@@ -24,6 +24,17 @@ glm::mat4 Camera::GetProjectionMatrix() const {
     return glm::ortho(-aspectRatio, aspectRatio, -1.f, 1.f, _nearClip, _farClip);
 }
 
+Ray Camera::GetRay(glm::vec2 cursor) {
+    // Unproject the cursor at both ends of the depth range; this covers the orthographic projection too
+    glm::mat4 inverse = glm::inverse(GetProjectionMatrix() * GetViewMatrix());
+    glm::vec2 ndc { 2.f * cursor.x / (float)_width - 1.f, 1.f - 2.f * cursor.y / (float)_height };
+    glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.f, 1.f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 span = glm::vec3(farPoint) / farPoint.w - origin;
+    return Ray { origin, glm::normalize(span), glm::length(span) };
+}
+
 void Camera::MoveCamera(MoveDirection direction, float moveAmount) {
     glm::vec3 moveDirection {};
 
@@ -1,10 +1,24 @@
 #include "conicalfrustum.h"
-#include <cmath>
-#include <random>
+#include "lodchain.h"
+#include "parallel.h"
+#include "ring.h"
+#include <algorithm>
+
+namespace {
+    // One generator instantiation baked at compile time, so a change that breaks constant evaluation or the table
+    // sizes fails the build rather than the first prop that uses it
+    constexpr int BakedSectors = 32;
+    constexpr auto BakedFrustum = ConicalFrustum::Generate<BakedSectors>(0.1f, 0.225f, 0.5f);
+
+    constexpr bool indicesInRange(std::span<const uint32_t> indices, size_t vertexCount)
+    {
+        return std::all_of(indices.begin(), indices.end(), [vertexCount](uint32_t index) { return index < vertexCount; });
+    }
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+    static_assert(BakedFrustum.Vertices.size() == 2 + 2 * (BakedSectors + 1), "Centres plus a duplicated seam ring");
+    static_assert(BakedFrustum.Indices.size() == 12 * BakedSectors, "Four triangles per sector");
+    static_assert(indicesInRange(BakedFrustum.Indices, BakedFrustum.Vertices.size()), "Every index names a baked vertex");
+}
 
 ConicalFrustum::ConicalFrustum(float topRadius, float bottomRadius, float height, int sectors)
         : topRadius(topRadius), bottomRadius(bottomRadius), height(height), sectors(sectors)
@@ -13,98 +27,67 @@ ConicalFrustum::ConicalFrustum(float topRadius, float bottomRadius, float height
     generateIndices();
 }
 
-Mesh ConicalFrustum::GetMesh()
+std::vector<ConicalFrustum> ConicalFrustum::GenerateBatch(std::span<const Desc> descs, uint32_t threadCount)
 {
-    return Mesh(vertices, indices);
+    std::vector<ConicalFrustum> batch(descs.size());
+    Parallel::For(descs.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& desc = descs[i];
+            batch[i] = ConicalFrustum(desc.TopRadius, desc.BottomRadius, desc.Height, desc.Sectors);
+        }
+    }, threadCount);
+    return batch;
 }
 
-std::vector<Vertex> ConicalFrustum::GetVertices()
+Mesh ConicalFrustum::CreateLodMesh(float topRadius, float bottomRadius, float height, float chordTolerance, GeometryArena* arena,
+                                   MeshOptimizer::Report* report)
 {
-    return vertices;
+    auto levels = LodChain::FromChordTolerance(std::max(topRadius, bottomRadius), chordTolerance);
+
+    ConicalFrustum finest(topRadius, bottomRadius, height, levels.front().Sectors);
+    auto finestReport = finest.Optimize();
+    if (report) {
+        *report = finestReport;
+    }
+    auto mesh = std::move(finest).GetMesh(arena);
+    mesh.SetGeometricError(levels.front().ChordError);
+
+    for (size_t i = 1; i < levels.size(); i++) {
+        ConicalFrustum level(topRadius, bottomRadius, height, levels[i].Sectors);
+        level.Optimize();
+        mesh.AddLod(std::move(level).GetMesh(arena), levels[i].ChordError);
+    }
+    return mesh;
 }
 
-std::vector<unsigned int> ConicalFrustum::GetIndices()
+MeshOptimizer::Report ConicalFrustum::Optimize()
 {
-    return indices;
+    return MeshOptimizer::Optimize(vertices, indices);
 }
 
-void ConicalFrustum::generateVertices()
+Mesh ConicalFrustum::GetMesh(GeometryArena* arena) const&
 {
-    const float sectorStep = 2.0f * M_PI / sectors;
-
-    // Generate top vertex
-    Vertex topVertex;
-    topVertex.Position = glm::vec3(0.0f, height / 2.0f, 0.0f);
-    topVertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
-    topVertex.Uv = glm::vec2(0.5f, 0.5f);
-    vertices.push_back(topVertex);
-
-    // Generate bottom vertex
-    Vertex bottomVertex;
-    bottomVertex.Position = glm::vec3(0.0f, -height / 2.0f, 0.0f);
-    bottomVertex.Normal = glm::vec3(0.0f, -1.0f, 0.0f);
-    bottomVertex.Uv = glm::vec2(6.f, 6.f);
-    vertices.push_back(bottomVertex);
-
-    // Generate side vertices
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> colorDistribution(0.0f, 1.0f);
+    return Mesh(vertices, indices, arena);
+}
 
-    for (int i = 0; i <= sectors; ++i)
-    {
-        const float sectorAngle = i * sectorStep;
-        const float xTop = topRadius * cosf(sectorAngle);
-        const float zTop = topRadius * sinf(sectorAngle);
-        const float xBottom = bottomRadius * cosf(sectorAngle);
-        const float zBottom = bottomRadius * sinf(sectorAngle);
+Mesh ConicalFrustum::GetMesh(GeometryArena* arena) &&
+{
+    return Mesh(std::move(vertices), std::move(indices), arena);
+}
 
-        Vertex sideVertexTop;
-        sideVertexTop.Position = glm::vec3(xTop, height / 2.0f, zTop);
-        sideVertexTop.Normal = glm::normalize(glm::vec3(xTop, (topRadius - bottomRadius) / height, zTop));
-        sideVertexTop.Uv = glm::vec2(static_cast<float>(i) / sectors, 1.0f);
-        //sideVertexTop.Color = glm::vec3(colorDistribution(gen), colorDistribution(gen), colorDistribution(gen));
-        vertices.push_back(sideVertexTop);
+void ConicalFrustum::generateVertices()
+{
+    // Trigonometry for the whole ring first, four sectors at a time, then one interleaving pass into preallocated vertices
+    std::vector<float> cosines(static_cast<size_t>(sectors) + 1);
+    std::vector<float> sines(static_cast<size_t>(sectors) + 1);
+    Ring::SinCos(sectors, cosines.data(), sines.data());
 
-        Vertex sideVertexBottom;
-        sideVertexBottom.Position = glm::vec3(xBottom, -height / 2.0f, zBottom);
-        sideVertexBottom.Normal = glm::normalize(glm::vec3(xBottom, (topRadius - bottomRadius) / height, zBottom));
-        sideVertexBottom.Uv = glm::vec2(static_cast<float>(i) / sectors, 0.0f);
-        //sideVertexBottom.Color = glm::vec3(colorDistribution(gen), colorDistribution(gen), colorDistribution(gen));
-        vertices.push_back(sideVertexBottom);
-    }
+    vertices.resize(VertexCount(sectors));
+    writeVertices(topRadius, bottomRadius, height, sectors, cosines.data(), sines.data(), vertices.data());
 }
 
 void ConicalFrustum::generateIndices()
 {
-    const int topVertexIndex = 0;
-    const int bottomVertexIndex = 1;
-
-    // Generate top indices
-    for (int i = 0; i < sectors; ++i)
-    {
-        const int currentTop = 2 * (i + 2);
-        const int nextTop = 2 * ((i + 1) % sectors + 2);
-        const int currentBottom = currentTop + 1;
-        const int nextBottom = nextTop + 1;
-
-        // Generate top triangle
-        indices.push_back(topVertexIndex);
-        indices.push_back(currentTop);
-        indices.push_back(nextTop);
-
-        // Generate bottom triangle
-        indices.push_back(bottomVertexIndex);
-        indices.push_back(currentBottom);
-        indices.push_back(nextBottom);
-
-        // Generate side triangles
-        indices.push_back(currentTop);
-        indices.push_back(currentBottom);
-        indices.push_back(nextTop);
-
-        indices.push_back(currentBottom);
-        indices.push_back(nextBottom);
-        indices.push_back(nextTop);
-    }
+    indices.resize(IndexCount(sectors));
+    writeIndices(sectors, indices.data());
 }
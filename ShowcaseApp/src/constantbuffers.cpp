@@ -0,0 +1,52 @@
+#include "constantbuffers.h"
+#include "glstate.h"
+
+ConstantBuffers::ConstantBuffers(StreamBuffer* stream)
+        : _stream(stream)
+{
+    glGenBuffers(1, &_frameBuffer);
+    glGenBuffers(1, &_objectBuffer);
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, _frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+}
+
+ConstantBuffers::~ConstantBuffers()
+{
+    GLState::DeleteBuffer(_frameBuffer);
+    GLState::DeleteBuffer(_objectBuffer);
+}
+
+ObjectConstants ConstantBuffers::MakeObject(const glm::mat4& transform, const Mesh& level)
+{
+    const auto& quantization = level.GetQuantization();
+    return ObjectConstants{ transform, glm::vec4(quantization.PositionOffset, level.HasPackedVertices() ? 1.f : 0.f),
+                            glm::vec4(quantization.PositionScale, 0.f), glm::vec4(quantization.UvOffset, quantization.UvScale) };
+}
+
+void ConstantBuffers::SetFrame(const FrameConstants& frame)
+{
+    if (_stream) {
+        auto allocation = _stream->Write(std::span<const FrameConstants>(&frame, 1), _stream->GetUniformAlignment());
+        if (allocation.IsValid()) {
+            GLState::BindBufferRange(GL_UNIFORM_BUFFER, FrameBinding, _stream->GetBuffer(), allocation.Offset, allocation.Size);
+            return;
+        }
+    }
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, _frameBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &frame);
+    GLState::BindBufferBase(GL_UNIFORM_BUFFER, FrameBinding, _frameBuffer);
+}
+
+void ConstantBuffers::SetObjects(std::span<const ObjectConstants> objects)
+{
+    if (_stream && !objects.empty()) {
+        auto allocation = _stream->Write(objects, _stream->GetStorageAlignment());
+        if (allocation.IsValid()) {
+            GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, ObjectBinding, _stream->GetBuffer(), allocation.Offset, allocation.Size);
+            return;
+        }
+    }
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size_bytes(), objects.data(), GL_STREAM_DRAW);
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, _objectBuffer);
+}
@@ -0,0 +1,176 @@
+#include "frustum.h"
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX__)
+#define FRUSTUM_USE_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t LaneGroup = 8;  // Arrays are padded to this many boxes so every vector load is whole
+    constexpr float EmptyExtent = -1e30f;  // Padding boxes with a huge negative extent fail every plane
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // Each plane is the fourth row of the matrix plus or minus one of the others (glm is column-major)
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    _planes[Left] = row3 + row0;
+    _planes[Right] = row3 - row0;
+    _planes[Bottom] = row3 + row1;
+    _planes[Top] = row3 - row1;
+    _planes[Near] = row3 + row2;  // OpenGL clip space spans -w..w in z
+    _planes[Far] = row3 - row2;
+    for (auto& plane : _planes) {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 0.0f ? plane / length : plane;
+    }
+}
+
+bool Frustum::Intersects(const BoundingBox& box) const
+{
+    if (box.IsEmpty()) {
+        return false;
+    }
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
+    for (const auto& plane : _planes) {
+        // Distance of the centre plus the box's projected radius onto the plane normal
+        float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const
+{
+    for (const auto& plane : _planes) {
+        if (glm::dot(glm::vec3(plane), sphere.Center) + plane.w < -sphere.Radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrustumCuller::Resize(uint32_t count)
+{
+    _count = count;
+    size_t padded = (count + LaneGroup - 1) / LaneGroup * LaneGroup;
+    for (auto* values : { &_centerX, &_centerY, &_centerZ }) {
+        values->assign(padded, 0.0f);
+    }
+    for (auto* values : { &_extentX, &_extentY, &_extentZ }) {
+        values->assign(padded, EmptyExtent);
+    }
+}
+
+void FrustumCuller::SetBounds(uint32_t index, const BoundingBox& box)
+{
+    if (box.IsEmpty()) {
+        _extentX[index] = _extentY[index] = _extentZ[index] = EmptyExtent;
+        return;
+    }
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
+    _centerX[index] = center.x;
+    _centerY[index] = center.y;
+    _centerZ[index] = center.z;
+    _extentX[index] = extents.x;
+    _extentY[index] = extents.y;
+    _extentZ[index] = extents.z;
+}
+
+uint32_t FrustumCuller::CullScalar(const Frustum& frustum, std::vector<uint8_t>& visible) const
+{
+    visible.resize(_count);
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < _count; i++) {
+        bool inside = true;
+        for (const auto& plane : frustum.GetPlanes()) {
+            float distance = plane.x * _centerX[i] + plane.y * _centerY[i] + plane.z * _centerZ[i] + plane.w;
+            float radius = std::abs(plane.x) * _extentX[i] + std::abs(plane.y) * _extentY[i] + std::abs(plane.z) * _extentZ[i];
+            inside = inside && distance + radius >= 0.0f;
+        }
+        visible[i] = inside;
+        visibleCount += inside;
+    }
+    return visibleCount;
+}
+
+uint32_t FrustumCuller::Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const
+{
+#if defined(FRUSTUM_USE_AVX)
+    visible.resize(_centerX.size());
+    const auto& planes = frustum.GetPlanes();
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t visibleCount = 0;
+    for (size_t i = 0; i < _centerX.size(); i += 8) {
+        __m256 cx = _mm256_loadu_ps(&_centerX[i]), cy = _mm256_loadu_ps(&_centerY[i]), cz = _mm256_loadu_ps(&_centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&_extentX[i]), ey = _mm256_loadu_ps(&_extentY[i]), ez = _mm256_loadu_ps(&_extentZ[i]);
+        __m256 outside = zero;
+        for (const auto& plane : planes) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                                            _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex),
+                                                        _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey)),
+                                          _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+        int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+        for (int lane = 0; lane < 8; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+        visibleCount += std::popcount(static_cast<unsigned>(mask));
+    }
+#elif defined(FRUSTUM_USE_SSE2)
+    visible.resize(_centerX.size());
+    const auto& planes = frustum.GetPlanes();
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t visibleCount = 0;
+    for (size_t i = 0; i < _centerX.size(); i += 4) {
+        __m128 cx = _mm_loadu_ps(&_centerX[i]), cy = _mm_loadu_ps(&_centerY[i]), cz = _mm_loadu_ps(&_centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&_extentX[i]), ey = _mm_loadu_ps(&_extentY[i]), ez = _mm_loadu_ps(&_extentZ[i]);
+        __m128 outside = zero;
+        for (const auto& plane : planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+                                       _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+        int mask = ~_mm_movemask_ps(outside) & 0xF;
+        for (int lane = 0; lane < 4; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+        visibleCount += std::popcount(static_cast<unsigned>(mask));
+    }
+#else
+    return CullScalar(frustum, visible);
+#endif
+#if defined(FRUSTUM_USE_AVX) || defined(FRUSTUM_USE_SSE2)
+    visible.resize(_count);  // Padding boxes are always culled, so the count is unaffected
+    return visibleCount;
+#endif
+}
+
+const char* FrustumCuller::GetInstructionSet()
+{
+#if defined(FRUSTUM_USE_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_USE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,314 @@
+#include "geometryarena.h"
+#include <algorithm>
+#include <iostream>
+#include "glstate.h"
+
+namespace {
+    constexpr uint32_t indexSlotSize = sizeof(uint16_t);  // The index free list counts 16 bit slots
+
+    uint32_t slotsPerIndex(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? 1 : 2;
+    }
+}
+
+GeometryArena::GeometryArena(uint32_t vertexCapacity, uint32_t indexCapacity, VertexFormat format)
+        : _format(format), _vertexStride(VertexEncoder::GetStride(format)),
+          _vertexFreeList(vertexCapacity), _indexFreeList(indexCapacity * slotsPerIndex(GL_UNSIGNED_INT))
+{
+    glGenVertexArrays(1, &_vertexArrayObject);
+    createBuffers(vertexCapacity, _indexFreeList.GetCapacity(), _vertexBufferObject, _elementBufferObject);
+    setupVertexArray();
+}
+
+GeometryArena::~GeometryArena()
+{
+    GLState::DeleteVertexArray(_vertexArrayObject);
+    GLState::DeleteBuffer(_vertexBufferObject);
+    GLState::DeleteBuffer(_elementBufferObject);
+}
+
+GeometryArena::Handle GeometryArena::Allocate(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                                              const VertexQuantization& quantization)
+{
+    if (_format == VertexFormat::Packed) {
+        auto packed = VertexEncoder::Pack(vertices, quantization);
+        return Allocate(packed.data(), static_cast<uint32_t>(packed.size()), indices);
+    }
+    return Allocate(vertices.data(), static_cast<uint32_t>(vertices.size()), indices);
+}
+
+GeometryArena::Handle GeometryArena::Allocate(const void* vertexData, uint32_t vertexCount, std::span<const uint32_t> indices)
+{
+    const auto indexCount = static_cast<uint32_t>(indices.size());
+
+    // Indices are relative to the base vertex, so any allocation of up to 65536 vertices can use 16 bit indices
+    std::vector<uint16_t> shortIndices;
+    GLenum indexType = GL_UNSIGNED_INT;
+    if (vertexCount <= UINT16_MAX + 1u) {
+        indexType = GL_UNSIGNED_SHORT;
+        shortIndices.assign(indices.begin(), indices.end());
+    }
+    const auto indexSlots = indexCount * slotsPerIndex(indexType);
+
+    uint32_t vertexOffset = 0;
+    uint32_t indexOffset = 0;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        bool vertexFits = _vertexFreeList.Allocate(vertexCount, 1, vertexOffset);
+        bool indexFits = vertexFits && _indexFreeList.Allocate(indexSlots, slotsPerIndex(indexType), indexOffset);
+        if (vertexFits && indexFits) {
+            break;
+        }
+        if (vertexFits) {
+            _vertexFreeList.Free(vertexOffset, vertexCount);
+        }
+
+        if (attempt == 0) {
+            // Holes may add up to enough space even if no single one does
+            Compact();
+        } else if (attempt == 1) {
+            // Storage is immutable, so growing means moving everything into larger buffers
+            auto vertexCapacity = std::max(_vertexFreeList.GetCapacity() * 2, _vertexFreeList.GetCapacity() + vertexCount);
+            auto indexCapacity = std::max(_indexFreeList.GetCapacity() * 2, _indexFreeList.GetCapacity() + indexSlots + 1);
+            relocate(vertexCapacity, indexCapacity);
+        } else {
+            std::cerr << "GeometryArena: failed to allocate " << vertexCount << " vertices and "
+                      << indexCount << " indices" << std::endl;
+            return InvalidHandle;
+        }
+    }
+
+    // Upload through the copy target so the element binding of whichever VAO is bound stays untouched
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, _vertexBufferObject);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(vertexOffset) * _vertexStride,
+                    static_cast<GLsizeiptr>(vertexCount) * _vertexStride, vertexData);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, _elementBufferObject);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(indexOffset) * indexSlotSize,
+                    static_cast<GLsizeiptr>(indexSlots) * indexSlotSize,
+                    indexType == GL_UNSIGNED_SHORT ? static_cast<const void*>(shortIndices.data()) : indices.data());
+
+    Handle handle;
+    if (!_freeHandles.empty()) {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(_ranges.size());
+        _ranges.emplace_back();
+        _live.push_back(false);
+    }
+
+    _ranges[handle] = Range{ static_cast<int32_t>(vertexOffset), vertexCount, indexOffset / slotsPerIndex(indexType), indexCount, indexType };
+    _live[handle] = true;
+    return handle;
+}
+
+void GeometryArena::Free(Handle handle)
+{
+    if (handle >= _ranges.size() || !_live[handle]) {
+        return;
+    }
+
+    const Range& range = _ranges[handle];
+    _vertexFreeList.Free(static_cast<uint32_t>(range.BaseVertex), range.VertexCount);
+    _indexFreeList.Free(range.FirstIndex * slotsPerIndex(range.IndexType), range.IndexCount * slotsPerIndex(range.IndexType));
+
+    _ranges[handle] = Range{};
+    _live[handle] = false;
+    _freeHandles.push_back(handle);
+}
+
+void GeometryArena::Compact()
+{
+    relocate(_vertexFreeList.GetCapacity(), _indexFreeList.GetCapacity());
+}
+
+GeometryArena::Stats GeometryArena::GetStats() const
+{
+    auto fragmentation = [](const FreeList& freeList) {
+        auto freeSpace = freeList.GetFreeSpace();
+        if (freeSpace == 0) {
+            return 0.f;
+        }
+        return 1.f - static_cast<float>(freeList.GetLargestFreeBlock()) / static_cast<float>(freeSpace);
+    };
+
+    Stats stats;
+    stats.VertexBytesCapacity = static_cast<size_t>(_vertexFreeList.GetCapacity()) * _vertexStride;
+    stats.VertexBytesUsed = stats.VertexBytesCapacity - static_cast<size_t>(_vertexFreeList.GetFreeSpace()) * _vertexStride;
+    stats.IndexBytesCapacity = static_cast<size_t>(_indexFreeList.GetCapacity()) * indexSlotSize;
+    stats.IndexBytesUsed = stats.IndexBytesCapacity - static_cast<size_t>(_indexFreeList.GetFreeSpace()) * indexSlotSize;
+    stats.VertexFragmentation = fragmentation(_vertexFreeList);
+    stats.IndexFragmentation = fragmentation(_indexFreeList);
+    stats.AllocationCount = static_cast<uint32_t>(std::count(_live.begin(), _live.end(), true));
+    return stats;
+}
+
+void GeometryArena::createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, GLuint& vertexBuffer, GLuint& elementBuffer)
+{
+    // Immutable storage; GL_DYNAMIC_STORAGE_BIT keeps glBufferSubData uploads legal
+    glGenBuffers(1, &vertexBuffer);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexCapacity) * _vertexStride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glGenBuffers(1, &elementBuffer);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexCapacity) * indexSlotSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+void GeometryArena::setupVertexArray()
+{
+    GLState::BindVertexArray(_vertexArrayObject);
+
+    GLState::BindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferObject);
+    VertexEncoder::SetupAttributes(_format);
+
+    GLState::BindVertexArray(0);
+}
+
+void GeometryArena::relocate(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    GLuint vertexBuffer;
+    GLuint elementBuffer;
+    createBuffers(vertexCapacity, indexCapacity, vertexBuffer, elementBuffer);
+
+    // Keep allocations in their current order so neighbouring meshes stay neighbours
+    std::vector<Handle> live;
+    for (Handle handle = 0; handle < _ranges.size(); ++handle) {
+        if (_live[handle]) {
+            live.push_back(handle);
+        }
+    }
+    std::sort(live.begin(), live.end(), [this](Handle a, Handle b) {
+        return _ranges[a].BaseVertex < _ranges[b].BaseVertex;
+    });
+
+    uint32_t vertexCursor = 0;
+    uint32_t indexCursor = 0;
+
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, _vertexBufferObject);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    for (auto handle : live) {
+        Range& range = _ranges[handle];
+        if (range.VertexCount > 0) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                static_cast<GLintptr>(range.BaseVertex) * _vertexStride,
+                                static_cast<GLintptr>(vertexCursor) * _vertexStride,
+                                static_cast<GLsizeiptr>(range.VertexCount) * _vertexStride);
+        }
+        range.BaseVertex = static_cast<int32_t>(vertexCursor);
+        vertexCursor += range.VertexCount;
+    }
+
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, _elementBufferObject);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer);
+    for (auto handle : live) {
+        Range& range = _ranges[handle];
+        auto slots = slotsPerIndex(range.IndexType);
+        indexCursor = (indexCursor + slots - 1) / slots * slots;  // 32 bit indices must stay 4 byte aligned
+        if (range.IndexCount > 0) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                static_cast<GLintptr>(range.GetIndexOffset()),
+                                static_cast<GLintptr>(indexCursor) * indexSlotSize,
+                                static_cast<GLsizeiptr>(range.IndexCount) * range.GetIndexSize());
+        }
+        range.FirstIndex = indexCursor / slots;
+        indexCursor += range.IndexCount * slots;
+    }
+
+    GLState::DeleteBuffer(_vertexBufferObject);
+    GLState::DeleteBuffer(_elementBufferObject);
+    _vertexBufferObject = vertexBuffer;
+    _elementBufferObject = elementBuffer;
+
+    _vertexFreeList.Reset(vertexCapacity, vertexCursor);
+    _indexFreeList.Reset(indexCapacity, indexCursor);
+
+    setupVertexArray();
+}
+
+void GeometryArena::FreeList::Reset(uint32_t capacity, uint32_t used)
+{
+    _capacity = capacity;
+    _blocks.clear();
+    if (used < capacity) {
+        _blocks.push_back({ used, capacity - used });
+    }
+}
+
+bool GeometryArena::FreeList::Allocate(uint32_t size, uint32_t alignment, uint32_t& offset)
+{
+    if (size == 0) {
+        offset = 0;
+        return true;
+    }
+
+    for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+        auto aligned = (it->Offset + alignment - 1) / alignment * alignment;
+        auto padding = aligned - it->Offset;
+        if (it->Size < size + padding) {
+            continue;
+        }
+        offset = aligned;
+
+        // Whatever the alignment skipped stays free in front of the allocation
+        auto remaining = Block{ aligned + size, it->Size - size - padding };
+        if (padding > 0) {
+            it->Size = padding;
+            if (remaining.Size > 0) {
+                _blocks.insert(it + 1, remaining);
+            }
+        } else if (remaining.Size > 0) {
+            *it = remaining;
+        } else {
+            _blocks.erase(it);
+        }
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::FreeList::Free(uint32_t offset, uint32_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    auto next = std::lower_bound(_blocks.begin(), _blocks.end(), offset,
+                                 [](const Block& block, uint32_t value) { return block.Offset < value; });
+    auto it = _blocks.insert(next, { offset, size });
+
+    // Merge with the following block
+    auto following = it + 1;
+    if (following != _blocks.end() && it->Offset + it->Size == following->Offset) {
+        it->Size += following->Size;
+        it = _blocks.erase(following) - 1;
+    }
+
+    // Merge with the preceding block
+    if (it != _blocks.begin()) {
+        auto preceding = it - 1;
+        if (preceding->Offset + preceding->Size == it->Offset) {
+            preceding->Size += it->Size;
+            _blocks.erase(it);
+        }
+    }
+}
+
+uint32_t GeometryArena::FreeList::GetFreeSpace() const
+{
+    uint32_t total = 0;
+    for (const auto& block : _blocks) {
+        total += block.Size;
+    }
+    return total;
+}
+
+uint32_t GeometryArena::FreeList::GetLargestFreeBlock() const
+{
+    uint32_t largest = 0;
+    for (const auto& block : _blocks) {
+        largest = std::max(largest, block.Size);
+    }
+    return largest;
+}
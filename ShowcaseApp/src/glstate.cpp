@@ -0,0 +1,251 @@
+#include "glstate.h"
+#include <array>
+#include <iterator>
+
+namespace {
+    constexpr GLuint Unknown = UINT32_MAX;  // Shadow value that matches no name, so the next call is always issued
+
+    // Buffer targets with a shadowed generic binding; others are passed through
+    constexpr GLenum BufferTargets[] = {
+        GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER, GL_PARAMETER_BUFFER,
+        GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER,
+    };
+
+    // Capabilities with a shadowed flag; others are passed through
+    constexpr GLenum Capabilities[] = {
+        GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_POLYGON_OFFSET_FILL, GL_MULTISAMPLE,
+        GL_FRAMEBUFFER_SRGB, GL_PRIMITIVE_RESTART,
+    };
+
+    template <size_t N>
+    constexpr std::array<GLuint, N> unknownArray()
+    {
+        std::array<GLuint, N> values{};
+        values.fill(Unknown);
+        return values;
+    }
+
+    // Default constructed, every binding is Unknown
+    struct Shadow {
+        GLuint Program{ Unknown };
+        GLuint VertexArray{ Unknown };
+        GLuint ActiveUnit{ Unknown };
+        std::array<GLuint, GLState::MaxTextureUnits> Textures{ unknownArray<GLState::MaxTextureUnits>() };
+        std::array<GLuint, std::size(BufferTargets)> Buffers{ unknownArray<std::size(BufferTargets)>() };
+        std::array<GLuint, GLState::MaxIndexedBindings> StorageBindings{ unknownArray<GLState::MaxIndexedBindings>() };  // GL_SHADER_STORAGE_BUFFER binding points
+        std::array<GLuint, GLState::MaxIndexedBindings> UniformBindings{ unknownArray<GLState::MaxIndexedBindings>() };  // GL_UNIFORM_BUFFER binding points
+        std::array<GLuint, std::size(Capabilities)> Enabled{ unknownArray<std::size(Capabilities)>() };  // 0 or 1, or Unknown
+        GLState::Counters Counters{};
+    };
+
+    Shadow& shadow()
+    {
+        static Shadow state;
+        return state;
+    }
+
+    template <size_t N>
+    int indexOf(const GLenum (&table)[N], GLenum value)
+    {
+        for (size_t i = 0; i < N; i++) {
+            if (table[i] == value) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Record value in slot and return true if the call has to be issued, counting it either way
+    bool update(GLuint& slot, GLuint value)
+    {
+        if (slot == value) {
+            shadow().Counters.Elided++;
+            return false;
+        }
+        slot = value;
+        shadow().Counters.Issued++;
+        return true;
+    }
+
+    GLuint* indexedSlot(GLenum target, GLuint index)
+    {
+        if (index >= GLState::MaxIndexedBindings) {
+            return nullptr;
+        }
+        if (target == GL_SHADER_STORAGE_BUFFER) {
+            return &shadow().StorageBindings[index];
+        }
+        if (target == GL_UNIFORM_BUFFER) {
+            return &shadow().UniformBindings[index];
+        }
+        return nullptr;
+    }
+
+    void forget(GLuint* begin, GLuint* end, GLuint name)
+    {
+        for (auto* slot = begin; slot != end; slot++) {
+            if (*slot == name) {
+                *slot = Unknown;
+            }
+        }
+    }
+}
+
+void GLState::UseProgram(GLuint program)
+{
+    if (update(shadow().Program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+    if (update(shadow().VertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+        shadow().Buffers[indexOf(BufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+    }
+}
+
+void GLState::ActiveTexture(uint32_t unit)
+{
+    if (update(shadow().ActiveUnit, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void GLState::BindTexture(uint32_t unit, GLuint texture)
+{
+    if (unit < MaxTextureUnits && shadow().Textures[unit] == texture) {
+        shadow().Counters.Elided++;
+        return;
+    }
+    ActiveTexture(unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    shadow().Counters.Issued++;
+    if (unit < MaxTextureUnits) {
+        shadow().Textures[unit] = texture;
+    }
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = indexOf(BufferTargets, target);
+    if (slot < 0) {
+        glBindBuffer(target, buffer);
+        shadow().Counters.Issued++;
+        return;
+    }
+    if (update(shadow().Buffers[slot], buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    int generic = indexOf(BufferTargets, target);
+    GLuint* indexed = indexedSlot(target, index);
+    if (indexed && *indexed == buffer && generic >= 0 && shadow().Buffers[generic] == buffer) {
+        shadow().Counters.Elided++;
+        return;
+    }
+    glBindBufferBase(target, index, buffer);
+    shadow().Counters.Issued++;
+    if (indexed) {
+        *indexed = buffer;
+    }
+    if (generic >= 0) {
+        shadow().Buffers[generic] = buffer;
+    }
+}
+
+void GLState::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    // Only names are shadowed, so a ranged binding point matches nothing until it is bound whole again
+    glBindBufferRange(target, index, buffer, offset, size);
+    shadow().Counters.Issued++;
+    if (GLuint* indexed = indexedSlot(target, index)) {
+        *indexed = Unknown;
+    }
+    if (int generic = indexOf(BufferTargets, target); generic >= 0) {
+        shadow().Buffers[generic] = buffer;
+    }
+}
+
+void GLState::SetEnabled(GLenum capability, bool enabled)
+{
+    int slot = indexOf(Capabilities, capability);
+    if (slot >= 0 && !update(shadow().Enabled[slot], enabled ? 1 : 0)) {
+        return;
+    }
+    if (slot < 0) {
+        shadow().Counters.Issued++;
+    }
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void GLState::DeleteProgram(GLuint program)
+{
+    if (program == 0) {
+        return;
+    }
+    // A deleted program stays in use until another is made current, but its name may come back after that
+    if (shadow().Program == program) {
+        shadow().Program = Unknown;
+    }
+    glDeleteProgram(program);
+}
+
+void GLState::DeleteVertexArray(GLuint vertexArray)
+{
+    if (vertexArray == 0) {
+        return;
+    }
+    if (shadow().VertexArray == vertexArray) {
+        shadow().VertexArray = Unknown;
+        shadow().Buffers[indexOf(BufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+    }
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+void GLState::DeleteTexture(GLuint texture)
+{
+    if (texture == 0) {
+        return;
+    }
+    forget(shadow().Textures.data(), shadow().Textures.data() + shadow().Textures.size(), texture);
+    glDeleteTextures(1, &texture);
+}
+
+void GLState::DeleteBuffer(GLuint buffer)
+{
+    if (buffer == 0) {
+        return;
+    }
+    auto& state = shadow();
+    forget(state.Buffers.data(), state.Buffers.data() + state.Buffers.size(), buffer);
+    forget(state.StorageBindings.data(), state.StorageBindings.data() + state.StorageBindings.size(), buffer);
+    forget(state.UniformBindings.data(), state.UniformBindings.data() + state.UniformBindings.size(), buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+void GLState::Invalidate()
+{
+    auto counters = shadow().Counters;
+    shadow() = Shadow();
+    shadow().Counters = counters;
+}
+
+const GLState::Counters& GLState::GetCounters()
+{
+    return shadow().Counters;
+}
+
+void GLState::ResetCounters()
+{
+    shadow().Counters = {};
+}
@@ -0,0 +1,652 @@
+#include "gltfloader.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "parallel.h"
+
+namespace {
+    constexpr uint32_t GlbMagic = 0x46546C67;  // "glTF"
+    constexpr uint32_t GlbJsonChunk = 0x4E4F534A;  // "JSON"
+    constexpr uint32_t GlbBinaryChunk = 0x004E4942;  // "BIN\0"
+    constexpr int64_t TrianglesMode = 4;
+
+    enum ComponentType : int64_t {
+        Byte = 5120,
+        UnsignedByte = 5121,
+        Short = 5122,
+        UnsignedShort = 5123,
+        UnsignedInt = 5125,
+        Float = 5126,
+    };
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint32_t readUint32(const std::byte* bytes)
+    {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    bool decodeBase64(std::string_view text, std::vector<std::byte>& out)
+    {
+        auto sextet = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+
+        out.clear();
+        out.reserve(text.size() / 4 * 3);
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (char c : text) {
+            if (c == '=') {
+                break;
+            }
+            int value = sextet(c);
+            if (value < 0) {
+                return false;
+            }
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            bitCount += 6;
+            if (bitCount >= 8) {
+                bitCount -= 8;
+                out.push_back(static_cast<std::byte>((bits >> bitCount) & 0xFF));
+            }
+        }
+        return true;
+    }
+
+    // Relative URIs are percent-encoded; spaces in file names are the common case. A '%' not followed by two hex
+    // digits is kept as it is, so a malformed URI fails later as a missing file.
+    std::string decodePercent(std::string_view uri)
+    {
+        std::string path;
+        for (size_t i = 0; i < uri.size(); i++) {
+            if (uri[i] == '%' && i + 2 < uri.size()) {
+                const char* first = uri.data() + i + 1;
+                unsigned int value = 0;
+                auto [end, error] = std::from_chars(first, first + 2, value, 16);
+                if (error == std::errc() && end == first + 2) {
+                    path += static_cast<char>(value);
+                    i += 2;
+                    continue;
+                }
+            }
+            path += uri[i];
+        }
+        return path;
+    }
+
+    // Strided view of an accessor's elements inside a buffer view
+    struct AccessorView {
+        const std::byte* Data{ nullptr };  // First element, or null for an accessor without a buffer view (all zeros)
+        size_t Count{ 0 };  // Number of elements
+        size_t Stride{ 0 };  // Bytes between elements
+        int64_t ComponentType{ Float };
+        int Components{ 0 };  // Components per element
+        bool Normalized{ false };  // Integer components map to [0, 1] or [-1, 1]
+
+        void Read(size_t element, float* out) const
+        {
+            if (!Data) {
+                std::fill(out, out + Components, 0.0f);
+                return;
+            }
+            const std::byte* source = Data + element * Stride;
+            for (int c = 0; c < Components; c++) {
+                switch (ComponentType) {
+                case Float: std::memcpy(&out[c], source + c * 4, 4); break;
+                case UnsignedByte: out[c] = std::to_integer<uint8_t>(source[c]) / (Normalized ? 255.0f : 1.0f); break;
+                case Byte: out[c] = static_cast<int8_t>(source[c]) / (Normalized ? 127.0f : 1.0f); break;
+                case UnsignedShort: {
+                    uint16_t value;
+                    std::memcpy(&value, source + c * 2, 2);
+                    out[c] = value / (Normalized ? 65535.0f : 1.0f);
+                    break;
+                }
+                case Short: {
+                    int16_t value;
+                    std::memcpy(&value, source + c * 2, 2);
+                    out[c] = value / (Normalized ? 32767.0f : 1.0f);
+                    break;
+                }
+                default: {
+                    uint32_t value;
+                    std::memcpy(&value, source + c * 4, 4);
+                    out[c] = static_cast<float>(value);
+                    break;
+                }
+                }
+                if (Normalized && (ComponentType == Byte || ComponentType == Short)) {
+                    out[c] = std::max(out[c], -1.0f);
+                }
+            }
+        }
+
+        uint32_t ReadIndex(size_t element) const
+        {
+            if (!Data) {
+                return 0;
+            }
+            const std::byte* source = Data + element * Stride;
+            switch (ComponentType) {
+            case UnsignedByte: return std::to_integer<uint32_t>(source[0]);
+            case UnsignedShort: {
+                uint16_t value;
+                std::memcpy(&value, source, 2);
+                return value;
+            }
+            default: return readUint32(source);
+            }
+        }
+    };
+
+    size_t componentSize(int64_t componentType)
+    {
+        switch (componentType) {
+        case Byte:
+        case UnsignedByte: return 1;
+        case Short:
+        case UnsignedShort: return 2;
+        case UnsignedInt:
+        case Float: return 4;
+        default: return 0;
+        }
+    }
+
+    int componentCount(std::string_view type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    // Write one attribute of every vertex in place; float data of the right width is copied element by element
+    // with no conversion, anything else goes through AccessorView::Read
+    template <int N>
+    void readAttribute(const AccessorView& accessor, std::span<Vertex> vertices, glm::vec<N, float> Vertex::*member)
+    {
+        if (accessor.Data && accessor.ComponentType == Float && accessor.Components == N) {
+            for (size_t i = 0; i < vertices.size(); i++) {
+                std::memcpy(&(vertices[i].*member), accessor.Data + i * accessor.Stride, sizeof(float) * N);
+            }
+            return;
+        }
+        float values[4];
+        for (size_t i = 0; i < vertices.size(); i++) {
+            accessor.Read(i, values);
+            for (int c = 0; c < N; c++) {
+                (vertices[i].*member)[c] = c < accessor.Components ? values[c] : 0.0f;
+            }
+        }
+    }
+}
+
+bool GltfLoader::Load(const std::filesystem::path& path, bool decodeImages)
+{
+    *this = GltfLoader();
+    _path = path;
+    _stats.Threads = Parallel::GetThreadCount();
+
+    auto readStart = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cerr << "glTF " << path.string() << ": cannot open" << std::endl;
+        return false;
+    }
+    auto bytes = file.GetData();
+
+    // A .glb is a 12 byte header, a JSON chunk and an optional binary chunk holding buffer 0
+    std::string_view json;
+    std::span<const std::byte> binaryChunk;
+    if (bytes.size() >= 12 && readUint32(bytes.data()) == GlbMagic) {
+        if (readUint32(bytes.data() + 4) != 2 || readUint32(bytes.data() + 8) > bytes.size()) {
+            std::cerr << "glTF " << path.string() << ": unsupported or truncated binary container" << std::endl;
+            return false;
+        }
+        size_t offset = 12;
+        while (offset + 8 <= bytes.size()) {
+            uint32_t length = readUint32(bytes.data() + offset);
+            uint32_t type = readUint32(bytes.data() + offset + 4);
+            if (offset + 8 + length > bytes.size()) {
+                std::cerr << "glTF " << path.string() << ": chunk runs past the end" << std::endl;
+                return false;
+            }
+            auto chunk = bytes.subspan(offset + 8, length);
+            if (type == GlbJsonChunk && json.empty()) {
+                json = { reinterpret_cast<const char*>(chunk.data()), chunk.size() };
+            } else if (type == GlbBinaryChunk && binaryChunk.empty()) {
+                binaryChunk = chunk;
+            }
+            offset += 8 + ((length + 3) & ~3u);
+        }
+    } else {
+        json = { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+    }
+    _files.push_back(std::move(file));  // The mapping does not move, so json and binaryChunk stay valid
+    _stats.ReadMilliseconds = millisecondsSince(readStart);
+
+    auto parseStart = std::chrono::steady_clock::now();
+    if (!JsonValue::Parse(json, _document)) {
+        std::cerr << "glTF " << path.string() << ": malformed JSON" << std::endl;
+        return false;
+    }
+    if (!_document["asset"]["version"].AsString().starts_with("2")) {
+        std::cerr << "glTF " << path.string() << ": only glTF 2.0 is supported" << std::endl;
+        return false;
+    }
+    for (const auto& extension : _document["extensionsRequired"].GetElements()) {
+        std::cerr << "glTF " << path.string() << ": required extension " << extension.AsString() << " is not supported" << std::endl;
+        return false;
+    }
+
+    for (const auto& material : _document["materials"].GetElements()) {
+        const auto& pbr = material["pbrMetallicRoughness"];
+        Material entry;
+        int64_t texture = pbr["baseColorTexture"]["index"].AsInt();
+        entry.Image = static_cast<int32_t>(_document["textures"][texture >= 0 ? size_t(texture) : SIZE_MAX]["source"].AsInt());
+        for (int c = 0; c < 4; c++) {
+            entry.BaseColor[c] = static_cast<float>(pbr["baseColorFactor"][c].AsNumber(1.0));
+        }
+        _materials.push_back(entry);
+    }
+
+    // Nodes of the default scene, or every root node when the file has no scenes
+    const auto& nodes = _document["nodes"];
+    const auto& scenes = _document["scenes"];
+    if (scenes.Size() > 0) {
+        for (const auto& node : scenes[static_cast<size_t>(std::max<int64_t>(_document["scene"].AsInt(0), 0))]["nodes"].GetElements()) {
+            addNode(node.AsInt(), glm::mat4(1.0f), 0);
+        }
+    } else {
+        std::vector<bool> child(nodes.Size(), false);
+        for (const auto& node : nodes.GetElements()) {
+            for (const auto& index : node["children"].GetElements()) {
+                if (index.AsInt() >= 0 && static_cast<size_t>(index.AsInt()) < child.size()) {
+                    child[index.AsInt()] = true;
+                }
+            }
+        }
+        for (size_t node = 0; node < nodes.Size(); node++) {
+            if (!child[node]) {
+                addNode(static_cast<int64_t>(node), glm::mat4(1.0f), 0);
+            }
+        }
+    }
+    _stats.ParseMilliseconds = millisecondsSince(parseStart);
+
+    readStart = std::chrono::steady_clock::now();
+    if (!binaryChunk.empty()) {
+        _buffers.push_back(binaryChunk);  // Buffer 0 of a .glb has no URI
+    }
+    if (!loadBuffers(path.parent_path())) {
+        return false;
+    }
+    _stats.ReadMilliseconds += millisecondsSince(readStart);
+
+    // Meshes decode independently, each into its own arrays
+    auto geometryStart = std::chrono::steady_clock::now();
+    const auto& meshes = _document["meshes"].GetElements();
+    _meshes.resize(meshes.size());
+    std::vector<std::string> errors(meshes.size());
+    Parallel::For(meshes.size(), [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; m++) {
+            if (!decodeMesh(meshes[m], _meshes[m], errors[m])) {
+                _meshes[m] = MeshData();  // Nothing is drawn from a mesh that failed part way
+                errors[m] = errors[m].empty() ? "invalid primitive attributes" : errors[m];
+            }
+        }
+    });
+    for (size_t m = 0; m < errors.size(); m++) {
+        if (!errors[m].empty()) {
+            std::cerr << "glTF " << path.string() << ": mesh " << m << ": " << errors[m] << std::endl;
+        }
+    }
+    _stats.GeometryMilliseconds = millisecondsSince(geometryStart);
+
+    // Images are the slowest part of most files; each worker decodes its own share through stb_image
+    auto imageStart = std::chrono::steady_clock::now();
+    const auto& images = _document["images"].GetElements();
+    _images.resize(decodeImages ? images.size() : 0);
+    Parallel::For(_images.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& image = images[i];
+            if (image.Has("bufferView")) {
+                _images[i] = Image::Decode(getBufferView(image["bufferView"].AsInt()));
+            } else if (image["uri"].AsString().starts_with("data:")) {
+                auto uri = image["uri"].AsString();
+                auto comma = uri.find(',');
+                std::vector<std::byte> encoded;
+                if (comma != std::string_view::npos && decodeBase64(uri.substr(comma + 1), encoded)) {
+                    _images[i] = Image::Decode(encoded);
+                }
+            } else {
+                MappedFile imageFile;
+                if (imageFile.Open(path.parent_path() / decodePercent(image["uri"].AsString()))) {
+                    _images[i] = Image::Decode(imageFile.GetData());
+                }
+            }
+        }
+    });
+    for (size_t i = 0; i < _images.size(); i++) {
+        if (!_images[i].IsValid()) {
+            std::cerr << "glTF " << path.string() << ": image " << i << " could not be decoded" << std::endl;
+        }
+    }
+    _stats.ImageMilliseconds = millisecondsSince(imageStart);
+    return true;
+}
+
+bool GltfLoader::loadBuffers(const std::filesystem::path& directory)
+{
+    const auto& buffers = _document["buffers"].GetElements();
+    for (size_t b = _buffers.size(); b < buffers.size(); b++) {
+        std::span<const std::byte> data;
+        if (!loadUri(buffers[b]["uri"].AsString(), directory, data)) {
+            std::cerr << "glTF " << _path.string() << ": buffer " << b << " could not be loaded" << std::endl;
+            return false;
+        }
+        _buffers.push_back(data);
+    }
+    for (size_t b = 0; b < buffers.size(); b++) {
+        auto length = static_cast<size_t>(std::max<int64_t>(buffers[b]["byteLength"].AsInt(0), 0));
+        if (b >= _buffers.size() || length > _buffers[b].size()) {
+            std::cerr << "glTF " << _path.string() << ": buffer " << b << " is shorter than its byteLength" << std::endl;
+            return false;
+        }
+        _buffers[b] = _buffers[b].first(length);
+    }
+    return true;
+}
+
+bool GltfLoader::loadUri(std::string_view uri, const std::filesystem::path& directory, std::span<const std::byte>& data)
+{
+    if (uri.empty()) {
+        return false;
+    }
+    if (uri.starts_with("data:")) {
+        auto comma = uri.find(',');
+        if (comma == std::string_view::npos || uri.substr(0, comma).find(";base64") == std::string_view::npos) {
+            return false;
+        }
+        auto& decoded = _decodedBuffers.emplace_back();
+        if (!decodeBase64(uri.substr(comma + 1), decoded)) {
+            return false;
+        }
+        data = decoded;
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.Open(directory / decodePercent(uri))) {
+        return false;
+    }
+    data = file.GetData();
+    _files.push_back(std::move(file));
+    return true;
+}
+
+std::span<const std::byte> GltfLoader::getBufferView(int64_t view) const
+{
+    const auto& bufferView = _document["bufferViews"][view >= 0 ? size_t(view) : SIZE_MAX];
+    int64_t buffer = bufferView["buffer"].AsInt();
+    auto offset = static_cast<size_t>(bufferView["byteOffset"].AsInt(0));
+    auto length = static_cast<size_t>(bufferView["byteLength"].AsInt(0));
+    if (buffer < 0 || static_cast<size_t>(buffer) >= _buffers.size() || offset > _buffers[buffer].size() ||
+        length > _buffers[buffer].size() - offset) {
+        return {};
+    }
+    return _buffers[buffer].subspan(offset, length);
+}
+
+bool GltfLoader::decodeMesh(const JsonValue& mesh, MeshData& data, std::string& error) const
+{
+    data.Name = mesh["name"].AsString();
+
+    // Resolve an accessor to a bounds-checked strided view
+    auto accessorView = [&](int64_t index, AccessorView& view) {
+        const auto& accessor = _document["accessors"][index >= 0 ? size_t(index) : SIZE_MAX];
+        view = AccessorView();
+        view.Count = static_cast<size_t>(std::max<int64_t>(accessor["count"].AsInt(0), 0));
+        view.ComponentType = accessor["componentType"].AsInt();
+        view.Components = componentCount(accessor["type"].AsString());
+        view.Normalized = accessor["normalized"].AsBool();
+        size_t elementSize = componentSize(view.ComponentType) * view.Components;
+        if (accessor.IsNull() || elementSize == 0) {
+            error = "invalid accessor " + std::to_string(index);
+            return false;
+        }
+        if (accessor.Has("sparse")) {
+            error = "sparse accessors are not supported";
+            return false;
+        }
+        if (!accessor.Has("bufferView")) {
+            return true;  // Every element is zero
+        }
+
+        auto bytes = getBufferView(accessor["bufferView"].AsInt());
+        view.Stride = static_cast<size_t>(_document["bufferViews"][size_t(accessor["bufferView"].AsInt())]["byteStride"].AsInt(0));
+        view.Stride = view.Stride ? view.Stride : elementSize;
+        auto offset = static_cast<size_t>(accessor["byteOffset"].AsInt(0));
+        if (view.Count > 0 && (offset > bytes.size() || (view.Count - 1) * view.Stride + elementSize > bytes.size() - offset)) {
+            error = "accessor " + std::to_string(index) + " runs past its buffer view";
+            return false;
+        }
+        view.Data = bytes.data() + offset;
+        return true;
+    };
+
+    uint32_t skipped = 0;
+    for (const auto& primitive : mesh["primitives"].GetElements()) {
+        if (primitive["mode"].AsInt(TrianglesMode) != TrianglesMode) {
+            skipped++;
+            continue;
+        }
+        const auto& attributes = primitive["attributes"];
+        AccessorView positions;
+        if (!accessorView(attributes["POSITION"].AsInt(), positions) || positions.Components != 3) {
+            return false;
+        }
+
+        // The primitive's vertices are appended and every attribute is written straight into them
+        auto baseVertex = static_cast<uint32_t>(data.Vertices.size());
+        data.Vertices.resize(baseVertex + positions.Count);
+        std::span<Vertex> vertices(data.Vertices.data() + baseVertex, positions.Count);
+        readAttribute<3>(positions, vertices, &Vertex::Position);
+
+        AccessorView view;
+        bool hasNormals = attributes.Has("NORMAL");
+        if (hasNormals) {
+            if (!accessorView(attributes["NORMAL"].AsInt(), view) || view.Count != positions.Count) {
+                return false;
+            }
+            readAttribute<3>(view, vertices, &Vertex::Normal);
+        }
+        if (attributes.Has("TEXCOORD_0")) {
+            if (!accessorView(attributes["TEXCOORD_0"].AsInt(), view) || view.Count != positions.Count) {
+                return false;
+            }
+            readAttribute<2>(view, vertices, &Vertex::Uv);
+            for (auto& vertex : vertices) {
+                vertex.Uv.y = 1.0f - vertex.Uv.y;  // glTF puts v = 0 at the top of the image; the shaders flip it
+            }
+        }
+        if (attributes.Has("TEXCOORD_1")) {
+            if (!accessorView(attributes["TEXCOORD_1"].AsInt(), view) || view.Count != positions.Count) {
+                return false;
+            }
+            readAttribute<2>(view, vertices, &Vertex::Uv2);
+            for (auto& vertex : vertices) {
+                vertex.Uv2.y = 1.0f - vertex.Uv2.y;
+            }
+        }
+
+        // The base color factor is folded into the vertex colors, which the shaders multiply in
+        int64_t material = primitive["material"].AsInt();
+        glm::vec4 baseColor = material >= 0 && static_cast<size_t>(material) < _materials.size() ? _materials[material].BaseColor : glm::vec4(1.0f);
+        if (attributes.Has("COLOR_0")) {
+            if (!accessorView(attributes["COLOR_0"].AsInt(), view) || view.Count != positions.Count) {
+                return false;
+            }
+            float color[4];
+            for (size_t i = 0; i < vertices.size(); i++) {
+                view.Read(i, color);
+                vertices[i].Color = glm::vec3(color[0], color[1], color[2]) * glm::vec3(baseColor);
+            }
+        } else {
+            for (auto& vertex : vertices) {
+                vertex.Color = glm::vec3(baseColor);
+            }
+        }
+
+        // Unsigned 32 bit indices of the first primitive are copied in one block; the rest are rebased
+        auto firstIndex = static_cast<uint32_t>(data.Indices.size());
+        if (primitive.Has("indices")) {
+            if (!accessorView(primitive["indices"].AsInt(), view) || view.Components != 1 ||
+                (view.ComponentType != UnsignedByte && view.ComponentType != UnsignedShort && view.ComponentType != UnsignedInt)) {
+                return false;
+            }
+            data.Indices.resize(firstIndex + view.Count);
+            uint32_t* indices = data.Indices.data() + firstIndex;
+            if (baseVertex == 0 && view.Data && view.ComponentType == UnsignedInt && view.Stride == sizeof(uint32_t)) {
+                std::memcpy(indices, view.Data, view.Count * sizeof(uint32_t));
+            } else {
+                for (size_t i = 0; i < view.Count; i++) {
+                    indices[i] = baseVertex + view.ReadIndex(i);
+                }
+            }
+        } else {
+            data.Indices.resize(firstIndex + positions.Count);
+            for (uint32_t i = 0; i < positions.Count; i++) {
+                data.Indices[firstIndex + i] = baseVertex + i;
+            }
+        }
+        data.Indices.resize(firstIndex + (data.Indices.size() - firstIndex) / 3 * 3);
+        auto indexCount = static_cast<uint32_t>(data.Indices.size() - firstIndex);
+        for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++) {
+            if (data.Indices[i] >= data.Vertices.size()) {
+                error = "index out of range";
+                return false;
+            }
+        }
+
+        // Missing normals are rebuilt smooth from the triangles' area-weighted face normals
+        if (!hasNormals) {
+            for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3) {
+                Vertex& a = data.Vertices[data.Indices[i]];
+                Vertex& b = data.Vertices[data.Indices[i + 1]];
+                Vertex& c = data.Vertices[data.Indices[i + 2]];
+                glm::vec3 normal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+                a.Normal += normal;
+                b.Normal += normal;
+                c.Normal += normal;
+            }
+            for (auto& vertex : vertices) {
+                if (glm::dot(vertex.Normal, vertex.Normal) > 0.0f) {
+                    vertex.Normal = glm::normalize(vertex.Normal);
+                }
+            }
+        }
+
+        // Primitives without a material use the default one after the file's materials
+        auto subMeshMaterial = static_cast<uint32_t>(material >= 0 && static_cast<size_t>(material) < _materials.size() ? material : _materials.size());
+        if (indexCount > 0) {
+            data.SubMeshes.push_back({ firstIndex, indexCount, subMeshMaterial });
+        }
+    }
+
+    if (skipped > 0) {
+        error = std::to_string(skipped) + " primitives that are not triangle lists were skipped";
+    }
+    return true;
+}
+
+void GltfLoader::addNode(int64_t node, const glm::mat4& parent, size_t depth)
+{
+    const auto& nodes = _document["nodes"];
+    if (node < 0 || static_cast<size_t>(node) >= nodes.Size() || depth > nodes.Size()) {
+        return;  // Invalid index, or a cycle
+    }
+
+    const auto& entry = nodes[static_cast<size_t>(node)];
+    glm::mat4 local(1.0f);
+    if (entry.Has("matrix")) {
+        for (int i = 0; i < 16; i++) {
+            glm::value_ptr(local)[i] = static_cast<float>(entry["matrix"][i].AsNumber(i % 5 == 0 ? 1.0 : 0.0));
+        }
+    } else {
+        const auto& t = entry["translation"];
+        const auto& r = entry["rotation"];
+        const auto& s = entry["scale"];
+        glm::vec3 translation(t[0].AsNumber(), t[1].AsNumber(), t[2].AsNumber());
+        glm::quat rotation(static_cast<float>(r[3].AsNumber(1.0)), static_cast<float>(r[0].AsNumber()),
+                           static_cast<float>(r[1].AsNumber()), static_cast<float>(r[2].AsNumber()));
+        glm::vec3 scale(s[0].AsNumber(1.0), s[1].AsNumber(1.0), s[2].AsNumber(1.0));
+        local = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+
+    glm::mat4 world = parent * local;
+    int64_t mesh = entry["mesh"].AsInt();
+    if (mesh >= 0 && static_cast<size_t>(mesh) < _document["meshes"].Size()) {
+        _instances.push_back({ static_cast<uint32_t>(mesh), world });
+    }
+    for (const auto& child : entry["children"].GetElements()) {
+        addNode(child.AsInt(), world, depth + 1);
+    }
+}
+
+std::vector<Mesh> GltfLoader::CreateMeshes(GeometryArena* arena)
+{
+    auto uploadStart = std::chrono::steady_clock::now();
+
+    std::vector<std::shared_ptr<Texture>> textures(_images.size());
+    for (size_t i = 0; i < _images.size(); i++) {
+        if (_images[i].IsValid()) {
+            textures[i] = std::make_shared<Texture>(_images[i].GetWidth(), _images[i].GetHeight(), _images[i].GetPixels());
+        }
+    }
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    auto whiteTexture = std::make_shared<Texture>(1, 1, white);
+
+    // The shaders blend two texture units, so a single base color texture fills both
+    std::vector<TextureSet> materials;
+    for (const auto& material : _materials) {
+        auto texture = material.Image >= 0 && static_cast<size_t>(material.Image) < textures.size() && textures[material.Image]
+                       ? textures[material.Image] : whiteTexture;
+        materials.push_back({ texture, texture });
+    }
+    materials.push_back({ whiteTexture, whiteTexture });
+
+    std::vector<Mesh> meshes;
+    meshes.reserve(_instances.size());
+    for (const auto& instance : _instances) {
+        const MeshData& data = _meshes[instance.MeshIndex];
+        if (data.SubMeshes.empty()) {
+            continue;
+        }
+        Mesh mesh(std::span<const Vertex>(data.Vertices), std::span<const uint32_t>(data.Indices), arena);
+        mesh.SetSubMeshes(data.SubMeshes);
+        mesh.SetMaterials(materials);
+        mesh.Transform = instance.Transform;
+        meshes.push_back(std::move(mesh));
+    }
+
+    _images.clear();  // The pixels live on the GPU now
+    _stats.UploadMilliseconds = millisecondsSince(uploadStart);
+    return meshes;
+}
@@ -0,0 +1,280 @@
+#include "gpuculler.h"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include "frustum.h"
+#include "glstate.h"
+
+namespace {
+    constexpr GLuint PyramidUnit = 0;  // Texture and image unit the compute shaders read and write through
+}
+
+GpuCuller::GpuCuller(const Path& shaderDirectory)
+        : _cullShader(shaderDirectory / "cull.comp"),
+          _pyramidShader(shaderDirectory / "depth_pyramid.comp")
+{
+    glGenBuffers(1, &_drawDataBuffer);
+    glGenBuffers(1, &_boundsBuffer);
+    glGenBuffers(1, &_candidateBuffer);
+    glGenBuffers(1, &_commandBuffer);
+    glGenBuffers(1, &_countBuffer);
+}
+
+GpuCuller::~GpuCuller()
+{
+    GLState::DeleteBuffer(_drawDataBuffer);
+    GLState::DeleteBuffer(_boundsBuffer);
+    GLState::DeleteBuffer(_candidateBuffer);
+    GLState::DeleteBuffer(_commandBuffer);
+    GLState::DeleteBuffer(_countBuffer);
+    GLState::DeleteTexture(_depthTexture);
+    GLState::DeleteTexture(_pyramidTexture);
+}
+
+void GpuCuller::Build(const std::vector<Mesh>& meshes)
+{
+    _objects.assign(meshes.size(), {});
+    _candidates.clear();
+    _batches.clear();
+    _standalone.clear();
+
+    std::vector<ObjectConstants> drawData;
+    std::vector<GpuObjectBounds> bounds;
+    std::vector<GLuint> handles;
+    for (uint32_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = meshes[i];
+        Object& object = _objects[i];
+        object.FirstDraw = static_cast<uint32_t>(drawData.size());
+        object.LevelCount = mesh.GetLodCount();
+        object.Transform = mesh.Transform;
+        bounds.push_back({ glm::vec4(mesh.GetBounds().Min, 0.f), glm::vec4(mesh.GetBounds().Max, 0.f),
+                           glm::vec4(mesh.GetBoundingSphere().Center, 1.f) });
+        for (uint32_t level = 0; level < mesh.GetLodCount(); level++) {
+            drawData.push_back(ConstantBuffers::MakeObject(mesh.Transform, mesh.GetLod(level)));
+        }
+        if (!mesh.GetLod(0).GetArena()) {
+            _standalone.push_back(i);
+            continue;
+        }
+
+        for (uint32_t level = 0; level < mesh.GetLodCount(); level++) {
+            const Mesh& lod = mesh.GetLod(level);
+            const auto& range = lod.GetArena()->GetRange(lod.GetArenaHandle());
+            float error = level == 0 ? 0.0f : mesh.GetGeometricError(level);
+            float nextError = level + 1 < mesh.GetLodCount() ? mesh.GetGeometricError(level + 1) : FLT_MAX;
+            for (const auto& subMesh : lod.GetSubMeshes()) {
+                const TextureSet& textures = mesh.GetMaterial(subMesh.Material);
+                handles.clear();
+                for (const auto& texture : textures) {
+                    handles.push_back(texture->GetHandle());
+                }
+                auto batch = std::find_if(_batches.begin(), _batches.end(), [&](const Batch& candidate) {
+                    return candidate.Arena == lod.GetArena() && candidate.IndexType == range.IndexType && candidate.TextureHandles == handles;
+                });
+                if (batch == _batches.end()) {
+                    batch = _batches.insert(_batches.end(), Batch{ lod.GetArena(), range.IndexType, textures, handles });
+                }
+                batch->Capacity++;
+
+                DrawElementsIndirectCommand command{ subMesh.IndexCount, 1, range.FirstIndex + subMesh.FirstIndex, range.BaseVertex,
+                                                     object.FirstDraw + level };
+                _candidates.push_back({ command, i, static_cast<uint32_t>(batch - _batches.begin()), 0, error, nextError });
+            }
+        }
+    }
+    _drawCount = static_cast<uint32_t>(drawData.size());
+
+    // Every candidate may survive, so each batch gets a range as long as its candidate count
+    uint32_t first = 0;
+    for (auto& batch : _batches) {
+        batch.First = first;
+        first += batch.Capacity;
+    }
+    for (auto& candidate : _candidates) {
+        candidate.OutputFirst = _batches[candidate.Batch].First;
+    }
+
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(ObjectConstants), drawData.data(), GL_DYNAMIC_DRAW);
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _boundsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(GpuObjectBounds), bounds.data(), GL_STATIC_DRAW);
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _candidateBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, _candidates.size() * sizeof(GpuDrawCandidate), _candidates.data(), GL_STATIC_DRAW);
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(first, 1) * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _countBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(_batches.size(), 1) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+}
+
+void GpuCuller::UpdateTransforms(const std::vector<Mesh>& meshes)
+{
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _drawDataBuffer);
+    std::vector<ObjectConstants> levels;
+    for (uint32_t i = 0; i < _objects.size() && i < meshes.size(); i++) {
+        Object& object = _objects[i];
+        if (meshes[i].Transform == object.Transform) {
+            continue;
+        }
+        object.Transform = meshes[i].Transform;
+        levels.clear();
+        for (uint32_t level = 0; level < object.LevelCount; level++) {
+            levels.push_back(ConstantBuffers::MakeObject(object.Transform, meshes[i].GetLod(level)));
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, object.FirstDraw * sizeof(ObjectConstants), levels.size() * sizeof(ObjectConstants), levels.data());
+    }
+}
+
+void GpuCuller::Cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelTolerance)
+{
+    _viewProjection = projection * view;
+    if (_candidates.empty()) {
+        return;
+    }
+
+    // Empty counters, and commands with no instances so unused slots draw nothing when the count cannot be sourced from the GPU
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _countBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _commandBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, IndirectRenderer::TransformBinding, _drawDataBuffer);
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, BoundsBinding, _boundsBuffer);
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, CandidateBinding, _candidateBuffer);
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, CommandBinding, _commandBuffer);
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, CountBinding, _countBuffer);
+
+    _cullShader.Bind();
+    _cullShader.SetInt("candidateCount", static_cast<int>(_candidates.size()));
+    _cullShader.SetMat4("viewProjection", _viewProjection);
+    _cullShader.SetVec4Array("frustumPlanes", Frustum(_viewProjection).GetPlanes());
+    _cullShader.SetFloat("lodScale", projection[1][1] * viewportHeight * 0.5f);
+    _cullShader.SetFloat("pixelTolerance", pixelTolerance);
+
+    bool occlusion = _occlusionEnabled && _pyramidValid;
+    _cullShader.SetInt("occlusionEnabled", occlusion);
+    if (occlusion) {
+        _cullShader.SetMat4("previousViewProjection", _previousViewProjection);
+        _cullShader.SetIVec2("depthSize", _depthSize);
+        _cullShader.SetInt("depthLevels", _pyramidLevels);
+        GLState::BindTexture(PyramidUnit, _pyramidTexture);
+    }
+
+    glDispatchCompute((static_cast<GLuint>(_candidates.size()) + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+uint32_t GpuCuller::Draw(std::vector<Mesh>& meshes, Shader& shader, IndirectRenderer& renderer)
+{
+    GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, IndirectRenderer::TransformBinding, _drawDataBuffer);
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    // GL 4.6 reads each batch's draw count from the counters; 4.5 walks the whole range, whose unused slots draw nothing
+    bool countFromBuffer = GLAD_GL_VERSION_4_6;
+    if (countFromBuffer) {
+        GLState::BindBuffer(GL_PARAMETER_BUFFER, _countBuffer);
+    }
+
+    shader.Bind();
+    auto bindTextures = [&shader](const TextureSet& textures) {
+        for (size_t j = 0; j < textures.size(); j++) {
+            textures[j]->Bind(j);
+            shader.SetInt(Shader::GetSamplerName(j), j);
+        }
+    };
+
+    uint32_t drawCalls = 0;
+    for (uint32_t b = 0; b < _batches.size(); b++) {
+        Batch& batch = _batches[b];
+        renderer.BindDrawIds(batch.Arena, _drawCount);
+        bindTextures(batch.Textures);
+
+        GLState::BindVertexArray(batch.Arena->GetVertexArray());
+        auto* offset = (void*)(static_cast<uintptr_t>(batch.First) * sizeof(DrawElementsIndirectCommand));
+        if (countFromBuffer) {
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, batch.IndexType, offset, static_cast<GLintptr>(b) * sizeof(uint32_t),
+                                             static_cast<GLsizei>(batch.Capacity), sizeof(DrawElementsIndirectCommand));
+        } else {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, batch.IndexType, offset, static_cast<GLsizei>(batch.Capacity),
+                                        sizeof(DrawElementsIndirectCommand));
+        }
+        drawCalls++;
+    }
+
+    // Meshes with private buffers have no draw ID stream, so feed their ID through the attribute's current value
+    for (auto meshIndex : _standalone) {
+        Mesh& mesh = meshes[meshIndex];
+        glVertexAttribI1ui(IndirectRenderer::DrawIdAttribute, _objects[meshIndex].FirstDraw + mesh.GetActiveLod());
+        auto subMeshes = mesh.GetSubMeshes();
+        for (uint32_t s = 0; s < subMeshes.size(); s++) {
+            bindTextures(mesh.GetMaterial(subMeshes[s].Material));
+            mesh.DrawSubMesh(s);
+            drawCalls++;
+        }
+    }
+    return drawCalls;
+}
+
+void GpuCuller::CaptureDepth(int width, int height)
+{
+    if (width <= 0 || height <= 0) {
+        _pyramidValid = false;
+        return;
+    }
+    if (glm::ivec2(width, height) != _depthSize) {
+        resizePyramid(width, height);
+    }
+
+    GLState::BindTexture(PyramidUnit, _depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    // Level 0 from the depth copy, then each level from the one below it
+    _pyramidShader.Bind();
+    glm::ivec2 size = _pyramidSize;
+    glm::ivec2 sourceSize = _depthSize;
+    for (int level = 0; level < _pyramidLevels; level++) {
+        GLState::BindTexture(PyramidUnit, level == 0 ? _depthTexture : _pyramidTexture);
+        glBindImageTexture(PyramidUnit, _pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        _pyramidShader.SetInt("sourceLevel", level - 1);
+        _pyramidShader.SetIVec2("sourceSize", sourceSize);
+        glDispatchCompute((size.x + 7) / 8, (size.y + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        sourceSize = size;
+        size = glm::max(size / 2, glm::ivec2(1));
+    }
+
+    _previousViewProjection = _viewProjection;
+    _pyramidValid = true;
+}
+
+void GpuCuller::resizePyramid(int width, int height)
+{
+    GLState::DeleteTexture(_depthTexture);
+    GLState::DeleteTexture(_pyramidTexture);
+    _depthSize = { width, height };
+    // A power-of-two base halves exactly at every level, so each texel covers a whole block of the level below
+    _pyramidSize = { static_cast<int>(std::bit_ceil(static_cast<uint32_t>(width))), static_cast<int>(std::bit_ceil(static_cast<uint32_t>(height))) };
+    _pyramidLevels = std::bit_width(static_cast<uint32_t>(std::max(_pyramidSize.x, _pyramidSize.y)));
+
+    glGenTextures(1, &_depthTexture);
+    GLState::BindTexture(PyramidUnit, _depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &_pyramidTexture);
+    GLState::BindTexture(PyramidUnit, _pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, _pyramidLevels, GL_R32F, _pyramidSize.x, _pyramidSize.y);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    _pyramidValid = false;
+}
+
+std::vector<uint32_t> GpuCuller::ReadDrawCounts() const
+{
+    std::vector<uint32_t> counts(_batches.size());
+    if (!counts.empty()) {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _countBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counts.size() * sizeof(uint32_t), counts.data());
+    }
+    return counts;
+}
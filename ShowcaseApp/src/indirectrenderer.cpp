@@ -0,0 +1,182 @@
+#include "indirectrenderer.h"
+#include <algorithm>
+#include <numeric>
+#include "glstate.h"
+
+IndirectRenderer::IndirectRenderer(StreamBuffer* stream)
+        : _stream(stream)
+{
+    glGenBuffers(1, &_commandBuffer);
+    glGenBuffers(1, &_transformBuffer);
+    glGenBuffers(1, &_drawIdBuffer);
+    reserveDraws(256);
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+    GLState::DeleteBuffer(_commandBuffer);
+    GLState::DeleteBuffer(_transformBuffer);
+    GLState::DeleteBuffer(_drawIdBuffer);
+}
+
+uint32_t IndirectRenderer::Draw(std::vector<Mesh>& meshes, Shader& shader, std::span<const uint8_t> visible)
+{
+    // Group the arena sub-meshes by arena, index type and material; meshes with private buffers are drawn on their own
+    size_t batchCount = 0;
+    std::vector<uint32_t> standalone;
+    std::vector<GLuint> handles;
+    for (uint32_t i = 0; i < meshes.size(); i++) {
+        Mesh& mesh = meshes[i];
+        if (!visible.empty() && !visible[i]) {
+            continue;
+        }
+        if (!mesh.GetArena()) {
+            standalone.push_back(i);
+            continue;
+        }
+
+        auto indexType = mesh.GetArena()->GetRange(mesh.GetArenaHandle()).IndexType;
+        auto subMeshes = mesh.GetSubMeshes();
+        for (uint32_t s = 0; s < subMeshes.size(); s++) {
+            const TextureSet& textures = mesh.GetMaterial(subMeshes[s].Material);
+            handles.clear();
+            for (const auto& texture : textures) {
+                handles.push_back(texture->GetHandle());
+            }
+
+            auto batch = std::find_if(_batches.begin(), _batches.begin() + batchCount, [&](const Batch& candidate) {
+                return candidate.Arena == mesh.GetArena() && candidate.IndexType == indexType && candidate.TextureHandles == handles;
+            });
+            if (batch == _batches.begin() + batchCount) {
+                if (batchCount == _batches.size()) {
+                    _batches.emplace_back();
+                }
+                batch = _batches.begin() + batchCount++;
+                batch->Arena = mesh.GetArena();
+                batch->IndexType = indexType;
+                batch->Textures = &textures;
+                batch->TextureHandles = handles;
+                batch->Items.clear();
+            }
+            batch->Items.push_back({ i, s });
+        }
+    }
+
+    // One command per sub-mesh; the command's position doubles as its draw ID
+
+    _commands.clear();
+    _drawData.clear();
+    for (size_t b = 0; b < batchCount; b++) {
+        for (const auto& item : _batches[b].Items) {
+            Mesh& mesh = meshes[item.Mesh];
+            const auto& range = mesh.GetArena()->GetRange(mesh.GetArenaHandle());
+            const auto& subMesh = mesh.GetSubMeshes()[item.SubMesh];
+            auto drawId = static_cast<uint32_t>(_commands.size());
+            _commands.push_back({ subMesh.IndexCount, 1, range.FirstIndex + subMesh.FirstIndex, range.BaseVertex, drawId });
+            _drawData.push_back(ConstantBuffers::MakeObject(mesh.Transform, mesh));
+        }
+    }
+    for (auto meshIndex : standalone) {
+        _drawData.push_back(ConstantBuffers::MakeObject(meshes[meshIndex].Transform, meshes[meshIndex]));
+    }
+
+    reserveDraws(static_cast<uint32_t>(_drawData.size()));
+
+    // Through the stream buffer when it has room; otherwise re-specify the renderer's own buffers
+    uintptr_t commandStart = 0;
+    StreamBuffer::Allocation commands;
+    StreamBuffer::Allocation drawData;
+    if (_stream && !_drawData.empty()) {
+        commands = _stream->Write(std::span<const DrawElementsIndirectCommand>(_commands), sizeof(uint32_t));
+        drawData = _stream->Write(std::span<const ObjectConstants>(_drawData), _stream->GetStorageAlignment());
+    }
+    if (commands.IsValid()) {
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, _stream->GetBuffer());
+        commandStart = static_cast<uintptr_t>(commands.Offset);
+    } else {
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsIndirectCommand), _commands.data(), GL_STREAM_DRAW);
+    }
+    if (drawData.IsValid()) {
+        GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, TransformBinding, _stream->GetBuffer(), drawData.Offset, drawData.Size);
+    } else {
+        GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _transformBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, _drawData.size() * sizeof(ObjectConstants), _drawData.data(), GL_STREAM_DRAW);
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, TransformBinding, _transformBuffer);
+    }
+
+    shader.Bind();
+
+    auto bindTextures = [&shader](const TextureSet& textures) {
+        for (size_t j = 0; j < textures.size(); j++) {
+            textures[j]->Bind(j);
+            shader.SetInt(Shader::GetSamplerName(j), j);
+        }
+    };
+
+    uint32_t drawCalls = 0;
+    uint32_t firstCommand = 0;
+    for (size_t b = 0; b < batchCount; b++) {
+        Batch& batch = _batches[b];
+        attachDrawIds(batch.Arena);
+        bindTextures(*batch.Textures);
+
+        GLState::BindVertexArray(batch.Arena->GetVertexArray());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch.IndexType,
+                                    (void*)(commandStart + static_cast<uintptr_t>(firstCommand) * sizeof(DrawElementsIndirectCommand)),
+                                    static_cast<GLsizei>(batch.Items.size()), sizeof(DrawElementsIndirectCommand));
+        firstCommand += static_cast<uint32_t>(batch.Items.size());
+        drawCalls++;
+    }
+
+    // Meshes with private buffers have no draw ID stream, so feed their ID through the attribute's current value
+    auto drawId = firstCommand;
+    for (auto meshIndex : standalone) {
+        Mesh& mesh = meshes[meshIndex];
+        glVertexAttribI1ui(DrawIdAttribute, drawId++);
+        auto subMeshes = mesh.GetSubMeshes();
+        for (uint32_t s = 0; s < subMeshes.size(); s++) {
+            bindTextures(mesh.GetMaterial(subMeshes[s].Material));
+            mesh.DrawSubMesh(s);
+            drawCalls++;
+        }
+    }
+
+    return drawCalls;
+}
+
+void IndirectRenderer::BindDrawIds(GeometryArena* arena, uint32_t drawCount)
+{
+    reserveDraws(drawCount);
+    attachDrawIds(arena);
+}
+
+void IndirectRenderer::reserveDraws(uint32_t drawCount)
+{
+    if (drawCount <= _drawIdCapacity) {
+        return;
+    }
+
+    _drawIdCapacity = std::max(drawCount, _drawIdCapacity * 2);
+    std::vector<uint32_t> drawIds(_drawIdCapacity);
+    std::iota(drawIds.begin(), drawIds.end(), 0u);
+
+    // VAOs keep referring to the same buffer name, so re-specifying the storage needs no re-attach
+    GLState::BindBuffer(GL_ARRAY_BUFFER, _drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(uint32_t), drawIds.data(), GL_STATIC_DRAW);
+}
+
+void IndirectRenderer::attachDrawIds(GeometryArena* arena)
+{
+    auto vertexArray = arena->GetVertexArray();
+    if (std::find(_attachedArrays.begin(), _attachedArrays.end(), vertexArray) != _attachedArrays.end()) {
+        return;
+    }
+
+    GLState::BindVertexArray(vertexArray);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, _drawIdBuffer);
+    glVertexAttribIPointer(DrawIdAttribute, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+    glVertexAttribDivisor(DrawIdAttribute, 1);
+    glEnableVertexAttribArray(DrawIdAttribute);
+    _attachedArrays.push_back(vertexArray);
+}
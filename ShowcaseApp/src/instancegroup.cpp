@@ -0,0 +1,158 @@
+#include "instancegroup.h"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include "glstate.h"
+
+InstanceGroup::InstanceGroup(Mesh mesh)
+        : _mesh(std::move(mesh))
+{
+    glGenBuffers(1, &_instanceBuffer);
+
+    // A storage range must start at a multiple of the binding alignment, so each bin starts on a
+    // whole number of entries that is also a multiple of it
+    GLint offsetAlignment = 1;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    _binGranularity = std::lcm(sizeof(InstanceData), static_cast<size_t>(std::max(offsetAlignment, 1))) / sizeof(InstanceData);
+}
+
+InstanceGroup::~InstanceGroup()
+{
+    if (_instanceBuffer) {
+        GLState::DeleteBuffer(_instanceBuffer);
+    }
+}
+
+InstanceGroup::InstanceGroup(InstanceGroup&& other) noexcept
+        : _mesh(std::move(other._mesh)),
+          _instances(std::move(other._instances)),
+          _binned(std::move(other._binned)),
+          _levels(std::move(other._levels)),
+          _culler(std::move(other._culler)),
+          _visible(std::move(other._visible)),
+          _visibleCount(other._visibleCount),
+          _occludedCount(other._occludedCount),
+          _instanceBuffer(std::exchange(other._instanceBuffer, 0)),
+          _binGranularity(other._binGranularity),
+          _triangleCount(other._triangleCount)
+{
+}
+
+InstanceGroup& InstanceGroup::operator=(InstanceGroup&& other) noexcept
+{
+    if (this != &other) {
+        if (_instanceBuffer) {
+            GLState::DeleteBuffer(_instanceBuffer);
+        }
+        _mesh = std::move(other._mesh);
+        _instances = std::move(other._instances);
+        _binned = std::move(other._binned);
+        _levels = std::move(other._levels);
+        _culler = std::move(other._culler);
+        _visible = std::move(other._visible);
+        _visibleCount = other._visibleCount;
+        _occludedCount = other._occludedCount;
+        _instanceBuffer = std::exchange(other._instanceBuffer, 0);
+        _binGranularity = other._binGranularity;
+        _triangleCount = other._triangleCount;
+    }
+    return *this;
+}
+
+uint32_t InstanceGroup::Add(const glm::mat4& transform, glm::vec4 color)
+{
+    _instances.push_back({ transform, color });
+    return static_cast<uint32_t>(_instances.size() - 1);
+}
+
+uint32_t InstanceGroup::Draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                             const OcclusionBuffer* occlusion)
+{
+    _triangleCount = 0;
+    _visibleCount = 0;
+    _occludedCount = 0;
+    if (_instances.empty()) {
+        return 0;
+    }
+
+    // Drop the copies outside the view in one batched pass over their world-space boxes
+    _culler.Resize(static_cast<uint32_t>(_instances.size()));
+    for (uint32_t i = 0; i < _instances.size(); i++) {
+        _culler.SetBounds(i, _mesh.GetBounds().Transformed(_instances[i].Model));
+    }
+    _visibleCount = _culler.Cull(Frustum(projection * view), _visible);
+    if (occlusion) {
+        for (uint32_t i = 0; i < _instances.size(); i++) {
+            if (_visible[i] && !occlusion->IsVisible(_mesh.GetBounds().Transformed(_instances[i].Model))) {
+                _visible[i] = 0;
+                _occludedCount++;
+            }
+        }
+        _visibleCount -= _occludedCount;
+    }
+    if (_visibleCount == 0) {
+        return 0;
+    }
+
+    // Bin every visible copy by the level its size on screen calls for
+    const uint32_t levelCount = _mesh.GetLodCount();
+    std::vector<uint32_t> binCounts(levelCount, 0);
+    _levels.resize(_instances.size());
+    for (size_t i = 0; i < _instances.size(); i++) {
+        if (_visible[i]) {
+            _levels[i] = _mesh.GetLodFor(_instances[i].Model, view, projection, viewportHeight);
+            binCounts[_levels[i]]++;
+        }
+    }
+
+    std::vector<size_t> binFirst(levelCount, 0);
+    size_t cursor = 0;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        cursor = (cursor + _binGranularity - 1) / _binGranularity * _binGranularity;
+        binFirst[level] = cursor;
+        cursor += binCounts[level];
+    }
+
+    _binned.resize(cursor);
+    std::vector<size_t> binCursor = binFirst;
+    for (size_t i = 0; i < _instances.size(); i++) {
+        if (_visible[i]) {
+            _binned[binCursor[_levels[i]]++] = _instances[i];
+        }
+    }
+
+    GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, _instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, _binned.size() * sizeof(InstanceData), _binned.data(), GL_STREAM_DRAW);
+
+    shader.Bind();
+    uint32_t drawCalls = 0;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        if (binCounts[level] == 0) {
+            continue;
+        }
+
+        GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, InstanceBinding, _instanceBuffer,
+                                 static_cast<GLintptr>(binFirst[level] * sizeof(InstanceData)),
+                                 static_cast<GLsizeiptr>(binCounts[level] * sizeof(InstanceData)));
+
+        Mesh& lod = _mesh.GetLod(level);
+        const auto& quantization = lod.GetQuantization();
+        shader.SetVec3("positionOffset", quantization.PositionOffset);
+        shader.SetVec3("positionScale", quantization.PositionScale);
+        shader.SetVec4("uvTransform", glm::vec4(quantization.UvOffset, quantization.UvScale));
+        shader.SetInt("packedNormals", lod.HasPackedVertices());
+
+        auto subMeshes = lod.GetSubMeshes();
+        for (uint32_t s = 0; s < subMeshes.size(); s++) {
+            const TextureSet& textures = _mesh.GetMaterial(subMeshes[s].Material);
+            for (size_t j = 0; j < textures.size(); j++) {
+                textures[j]->Bind(j);
+                shader.SetInt(Shader::GetSamplerName(j), j);
+            }
+            lod.DrawSubMesh(s, binCounts[level]);
+            _triangleCount += static_cast<uint64_t>(subMeshes[s].IndexCount / 3) * binCounts[level];
+            drawCalls++;
+        }
+    }
+    return drawCalls;
+}
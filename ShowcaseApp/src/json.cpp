@@ -0,0 +1,262 @@
+#include "json.h"
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+
+// Recursive descent over the text; reports the first error and stops
+class JsonParser {
+public:
+    static constexpr int MaxDepth = 256;  // Nesting beyond this is refused rather than overflowing the stack
+
+    explicit JsonParser(std::string_view text) : _text(text) {}
+
+    bool ParseDocument(JsonValue& value)
+    {
+        skipWhitespace();
+        if (!parseValue(value, 0)) {
+            return false;
+        }
+        skipWhitespace();
+        return _position == _text.size() || fail("trailing characters");
+    }
+
+private:
+    bool fail(const char* reason)
+    {
+        std::cerr << "JSON: " << reason << " at offset " << _position << std::endl;
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (_position < _text.size() &&
+               (_text[_position] == ' ' || _text[_position] == '\t' || _text[_position] == '\n' || _text[_position] == '\r')) {
+            _position++;
+        }
+    }
+
+    bool consume(std::string_view literal)
+    {
+        if (_text.substr(_position, literal.size()) != literal) {
+            return false;
+        }
+        _position += literal.size();
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth)
+    {
+        if (depth > MaxDepth) {
+            return fail("nesting too deep");
+        }
+        if (_position >= _text.size()) {
+            return fail("unexpected end");
+        }
+
+        switch (_text[_position]) {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value._type = JsonValue::Type::String;
+            return parseString(value._string);
+        case 't':
+            value._type = JsonValue::Type::Bool;
+            value._bool = true;
+            return consume("true") || fail("invalid literal");
+        case 'f':
+            value._type = JsonValue::Type::Bool;
+            return consume("false") || fail("invalid literal");
+        case 'n':
+            return consume("null") || fail("invalid literal");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseNumber(JsonValue& value)
+    {
+        // from_chars is locale independent; it rejects the leading '+' JSON rejects too
+        const char* first = _text.data() + _position;
+        auto [end, error] = std::from_chars(first, _text.data() + _text.size(), value._number);
+        if (error != std::errc() || end == first) {
+            return fail("invalid value");
+        }
+        value._type = JsonValue::Type::Number;
+        _position += end - first;
+        return true;
+    }
+
+    bool parseHex(uint32_t& codeUnit)
+    {
+        if (_position + 4 > _text.size()) {
+            return fail("truncated escape");
+        }
+        auto [end, error] = std::from_chars(_text.data() + _position, _text.data() + _position + 4, codeUnit, 16);
+        if (error != std::errc() || end != _text.data() + _position + 4) {
+            return fail("invalid escape");
+        }
+        _position += 4;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool parseString(std::string& out)
+    {
+        _position++;  // Opening quote
+        while (_position < _text.size()) {
+            // Copy the run up to the next quote or escape in one go
+            size_t run = _text.find_first_of("\"\\", _position);
+            if (run == std::string_view::npos) {
+                break;
+            }
+            out.append(_text.substr(_position, run - _position));
+            _position = run + 1;
+            if (_text[run] == '"') {
+                return true;
+            }
+
+            if (_position >= _text.size()) {
+                break;
+            }
+            char escape = _text[_position++];
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t codePoint;
+                if (!parseHex(codePoint)) {
+                    return false;
+                }
+                // A high surrogate must be followed by its low half
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    uint32_t low;
+                    if (!consume("\\u") || !parseHex(low) || low < 0xDC00 || low >= 0xE000) {
+                        return fail("unpaired surrogate");
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseArray(JsonValue& value, int depth)
+    {
+        value._type = JsonValue::Type::Array;
+        _position++;
+        skipWhitespace();
+        if (consume("]")) {
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            if (!parseValue(value._elements.emplace_back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (consume("]")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseObject(JsonValue& value, int depth)
+    {
+        value._type = JsonValue::Type::Object;
+        _position++;
+        skipWhitespace();
+        if (consume("}")) {
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            if (_position >= _text.size() || _text[_position] != '"') {
+                return fail("expected member name");
+            }
+            if (!parseString(value._keys.emplace_back())) {
+                return false;
+            }
+            skipWhitespace();
+            if (!consume(":")) {
+                return fail("expected ':'");
+            }
+            skipWhitespace();
+            if (!parseValue(value._elements.emplace_back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (consume("}")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+private:
+    std::string_view _text;  // Whole document
+    size_t _position{ 0 };  // Next character to read
+};
+
+namespace {
+    const JsonValue nullValue;
+}
+
+bool JsonValue::Parse(std::string_view text, JsonValue& value)
+{
+    value = JsonValue();
+    JsonParser parser(text);
+    return parser.ParseDocument(value);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    return _type == Type::Array && index < _elements.size() ? _elements[index] : nullValue;
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const
+{
+    if (_type == Type::Object) {
+        for (size_t i = 0; i < _keys.size(); i++) {
+            if (_keys[i] == key) {
+                return _elements[i];
+            }
+        }
+    }
+    return nullValue;
+}
@@ -0,0 +1,258 @@
+#include "lathe.h"
+#include "lodchain.h"
+#include "ring.h"
+#include <algorithm>
+#include <iostream>
+
+Lathe::Lathe(std::vector<ProfilePoint> profile, int sectors, bool capBottom, bool capTop)
+        : profile(std::move(profile)), sectors(sectors), capBottom(capBottom), capTop(capTop)
+{
+    generate();
+}
+
+std::vector<Lathe::ProfilePoint> Lathe::SmoothProfile(std::span<const ProfilePoint> controlPoints, int subdivisions)
+{
+    if (controlPoints.size() < 2 || subdivisions <= 1) {
+        return { controlPoints.begin(), controlPoints.end() };
+    }
+
+    // Uniform Catmull-Rom through every control point, with the end points repeated as their own neighbours
+    auto at = [&](ptrdiff_t i) {
+        const auto& point = controlPoints[std::clamp<ptrdiff_t>(i, 0, static_cast<ptrdiff_t>(controlPoints.size()) - 1)];
+        return glm::vec2(point.Radius, point.Height);
+    };
+
+    std::vector<ProfilePoint> smooth;
+    smooth.reserve((controlPoints.size() - 1) * subdivisions + 1);
+    for (ptrdiff_t k = 0; k + 1 < static_cast<ptrdiff_t>(controlPoints.size()); k++) {
+        glm::vec2 p0 = at(k - 1), p1 = at(k), p2 = at(k + 1), p3 = at(k + 2);
+        for (int i = 0; i < subdivisions; i++) {
+            float t = static_cast<float>(i) / subdivisions;
+            glm::vec2 point = 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t +
+                                      (3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+            smooth.push_back({ std::max(point.x, 0.0f), point.y, controlPoints[k].Material });
+        }
+    }
+    smooth.push_back(controlPoints.back());
+    return smooth;
+}
+
+std::vector<Lathe::LodLevel> Lathe::CreateLodLevels(const std::vector<ProfilePoint>& profile, float chordTolerance,
+                                                    MeshOptimizer::Report* report)
+{
+    float radius = 0.0f;
+    for (const auto& point : profile) {
+        radius = std::max(radius, point.Radius);
+    }
+    auto levels = LodChain::FromChordTolerance(radius, chordTolerance);
+
+    std::vector<LodLevel> lods;
+    lods.reserve(levels.size());
+    for (size_t i = 0; i < levels.size(); i++) {
+        LodLevel lod{ Lathe(profile, levels[i].Sectors), levels[i].ChordError };
+        auto levelReport = lod.Geometry.Optimize();
+        if (i == 0 && report) {
+            *report = levelReport;
+        }
+        lods.push_back(std::move(lod));
+    }
+    return lods;
+}
+
+Mesh Lathe::CreateLodMesh(const std::vector<ProfilePoint>& profile, float chordTolerance, GeometryArena* arena,
+                          MeshOptimizer::Report* report)
+{
+    auto levels = CreateLodLevels(profile, chordTolerance, report);
+    auto mesh = std::move(levels.front().Geometry).GetMesh(arena);
+    mesh.SetGeometricError(levels.front().GeometricError);
+    for (size_t i = 1; i < levels.size(); i++) {
+        mesh.AddLod(std::move(levels[i].Geometry).GetMesh(arena), levels[i].GeometricError);
+    }
+    return mesh;
+}
+
+Mesh Lathe::GetMesh(GeometryArena* arena) const&
+{
+    Mesh mesh(vertices, indices, arena);
+    mesh.SetSubMeshes(subMeshes);
+    return mesh;
+}
+
+Mesh Lathe::GetMesh(GeometryArena* arena) &&
+{
+    Mesh mesh(std::move(vertices), std::move(indices), arena);
+    mesh.SetSubMeshes(std::move(subMeshes));
+    return mesh;
+}
+
+MeshOptimizer::Report Lathe::Optimize()
+{
+    // The generator emits no duplicate vertices, so there is nothing to weld; the triangle passes run per
+    // material range so every range stays contiguous
+    MeshOptimizer::Report report;
+    report.VerticesBefore = static_cast<uint32_t>(vertices.size());
+    report.Before = MeshOptimizer::AnalyzeVertexCache(indices, report.VerticesBefore);
+
+    for (const auto& subMesh : subMeshes) {
+        auto first = indices.begin() + subMesh.FirstIndex;
+        std::vector<uint32_t> range(first, first + subMesh.IndexCount);
+        auto clusters = MeshOptimizer::OptimizeVertexCache(range, report.VerticesBefore);
+        MeshOptimizer::OptimizeOverdraw(range, vertices, clusters);
+        std::copy(range.begin(), range.end(), first);
+        report.Clusters += static_cast<uint32_t>(clusters.size());
+    }
+    MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+
+    report.VerticesAfter = static_cast<uint32_t>(vertices.size());
+    report.After = MeshOptimizer::AnalyzeVertexCache(indices, report.VerticesAfter);
+    return report;
+}
+
+void Lathe::generate()
+{
+    if (profile.size() < 2 || sectors < 3) {
+        std::cerr << "Lathe: a profile needs at least two points and three sectors" << std::endl;
+        return;
+    }
+
+    const size_t pointCount = profile.size();
+    const size_t segmentCount = pointCount - 1;
+    const auto ringSize = static_cast<uint32_t>(sectors) + 1;
+
+    std::vector<float> cosines(ringSize);
+    std::vector<float> sines(ringSize);
+    Ring::SinCos(sectors, cosines.data(), sines.data());
+    cosines[sectors] = cosines[0];  // The seam column must match the first one bitwise to stay watertight
+    sines[sectors] = sines[0];
+
+    // Outward normal of every segment in the profile plane, as (radial, axial)
+    std::vector<glm::vec2> segmentNormals(segmentCount);
+    std::vector<float> segmentLengths(segmentCount);
+    for (size_t s = 0; s < segmentCount; s++) {
+        glm::vec2 direction(profile[s + 1].Radius - profile[s].Radius, profile[s + 1].Height - profile[s].Height);
+        segmentLengths[s] = glm::length(direction);
+        segmentNormals[s] = segmentLengths[s] > 0.0f ? glm::vec2(direction.y, -direction.x) / segmentLengths[s]
+                                                     : glm::vec2(1.0f, 0.0f);
+    }
+
+    // V follows the arc length and restarts where the material changes, so each material's texture spans its run once
+    std::vector<float> vBelow(pointCount, 0.0f);  // V of a point as the top of the segment under it
+    std::vector<float> vAbove(pointCount, 0.0f);  // V of a point as the bottom of the segment over it
+    for (size_t begin = 0; begin < segmentCount;) {
+        size_t end = begin + 1;
+        while (end < segmentCount && profile[end].Material == profile[begin].Material) {
+            end++;
+        }
+
+        float runLength = 0.0f;
+        for (size_t s = begin; s < end; s++) {
+            runLength += segmentLengths[s];
+        }
+        float distance = 0.0f;
+        for (size_t s = begin; s < end; s++) {
+            vAbove[s] = runLength > 0.0f ? distance / runLength : 0.0f;
+            distance += segmentLengths[s];
+            vBelow[s + 1] = runLength > 0.0f ? distance / runLength : 1.0f;
+        }
+        begin = end;
+    }
+
+    vertices.clear();
+    vertices.reserve(2 * pointCount * ringSize + 2 * ringSize);
+    auto emitRing = [&](const ProfilePoint& point, glm::vec2 normal, float v) {
+        auto base = static_cast<uint32_t>(vertices.size());
+        for (uint32_t j = 0; j < ringSize; j++) {
+            Vertex vertex;
+            vertex.Position = glm::vec3(point.Radius * cosines[j], point.Height, point.Radius * sines[j]);
+            vertex.Normal = glm::vec3(normal.x * cosines[j], normal.y, normal.x * sines[j]);
+            vertex.Uv = glm::vec2(1.0f - static_cast<float>(j) / sectors, v);
+            vertices.push_back(vertex);
+        }
+        return base;
+    };
+
+    // One ring per profile point, shared by the segments on either side; a second ring only where the
+    // normal has a crease or V restarts for a new material
+    std::vector<uint32_t> ringBelow(pointCount);
+    std::vector<uint32_t> ringAbove(pointCount);
+    for (size_t i = 0; i < pointCount; i++) {
+        glm::vec2 normalBelow = segmentNormals[i > 0 ? i - 1 : 0];
+        glm::vec2 normalAbove = segmentNormals[i < segmentCount ? i : segmentCount - 1];
+        bool crease = glm::dot(normalBelow, normalAbove) < CreaseCosine;
+        if (!crease) {
+            normalBelow = normalAbove = glm::normalize(normalBelow + normalAbove);
+        }
+
+        if (i > 0) {
+            ringBelow[i] = emitRing(profile[i], normalBelow, vBelow[i]);
+        }
+        if (i < segmentCount) {
+            bool shared = i > 0 && !crease && vBelow[i] == vAbove[i];
+            ringAbove[i] = shared ? ringBelow[i] : emitRing(profile[i], normalAbove, vAbove[i]);
+        }
+    }
+
+    // Triangles are bucketed by material and concatenated into one range each
+    uint32_t materialCount = 0;
+    for (const auto& point : profile) {
+        materialCount = std::max(materialCount, point.Material + 1);
+    }
+    std::vector<std::vector<uint32_t>> buckets(materialCount);
+
+    for (size_t s = 0; s < segmentCount; s++) {
+        auto& bucket = buckets[profile[s].Material];
+        const uint32_t bottom = ringAbove[s];
+        const uint32_t top = ringBelow[s + 1];
+        for (uint32_t j = 0; j < static_cast<uint32_t>(sectors); j++) {
+            // A point on the axis collapses its ring, so only one triangle of the quad has area there
+            if (profile[s + 1].Radius > 0.0f) {
+                bucket.insert(bucket.end(), { top + j, top + j + 1, bottom + j });
+            }
+            if (profile[s].Radius > 0.0f) {
+                bucket.insert(bucket.end(), { bottom + j, top + j + 1, bottom + j + 1 });
+            }
+        }
+    }
+
+    // Caps with planar UVs, only at the ends of the profile
+    auto emitCap = [&](const ProfilePoint& point, float normalY, uint32_t material) {
+        auto centre = static_cast<uint32_t>(vertices.size());
+        Vertex vertex;
+        vertex.Position = glm::vec3(0.0f, point.Height, 0.0f);
+        vertex.Normal = glm::vec3(0.0f, normalY, 0.0f);
+        vertex.Uv = glm::vec2(0.5f, 0.5f);
+        vertices.push_back(vertex);
+        for (uint32_t j = 0; j < static_cast<uint32_t>(sectors); j++) {
+            vertex.Position = glm::vec3(point.Radius * cosines[j], point.Height, point.Radius * sines[j]);
+            vertex.Uv = glm::vec2(0.5f + 0.5f * cosines[j], 0.5f + 0.5f * sines[j]);
+            vertices.push_back(vertex);
+        }
+
+        auto& bucket = buckets[material];
+        for (uint32_t j = 0; j < static_cast<uint32_t>(sectors); j++) {
+            uint32_t current = centre + 1 + j;
+            uint32_t next = centre + 1 + (j + 1) % sectors;
+            if (normalY < 0.0f) {
+                bucket.insert(bucket.end(), { centre, current, next });
+            } else {
+                bucket.insert(bucket.end(), { centre, next, current });
+            }
+        }
+    };
+    if (capBottom && profile.front().Radius > 0.0f) {
+        emitCap(profile.front(), -1.0f, profile.front().Material);
+    }
+    if (capTop && profile.back().Radius > 0.0f) {
+        emitCap(profile.back(), 1.0f, profile[segmentCount - 1].Material);
+    }
+
+    indices.clear();
+    subMeshes.clear();
+    for (uint32_t material = 0; material < materialCount; material++) {
+        if (buckets[material].empty()) {
+            continue;
+        }
+        subMeshes.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(buckets[material].size()), material });
+        indices.insert(indices.end(), buckets[material].begin(), buckets[material].end());
+    }
+}
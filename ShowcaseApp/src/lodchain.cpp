@@ -0,0 +1,41 @@
+#include "lodchain.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+float LodChain::ChordError(float radius, int sectors)
+{
+    return radius * (1.0f - std::cos(static_cast<float>(M_PI) / static_cast<float>(sectors)));
+}
+
+int LodChain::SectorsForChordError(float radius, float tolerance)
+{
+    if (tolerance >= radius) {
+        return MinSectors;
+    }
+    if (tolerance <= 0.0f) {
+        return MaxSectors;
+    }
+
+    // Solve r * (1 - cos(pi / n)) <= tolerance for n
+    auto sectors = std::ceil(static_cast<float>(M_PI) / std::acos(1.0f - tolerance / radius));
+    return std::clamp(static_cast<int>(sectors), MinSectors, MaxSectors);
+}
+
+std::vector<LodChain::Level> LodChain::FromChordTolerance(float radius, float tolerance, int maxLevels)
+{
+    std::vector<Level> levels;
+    auto sectors = SectorsForChordError(radius, tolerance);
+    while (static_cast<int>(levels.size()) < maxLevels) {
+        levels.push_back({ sectors, ChordError(radius, sectors) });
+        if (sectors == MinSectors) {
+            break;
+        }
+        // Halving the sectors roughly quadruples the error, so each level covers a wider distance band
+        sectors = std::max(sectors / 2, MinSectors);
+    }
+    return levels;
+}
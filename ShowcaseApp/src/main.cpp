@@ -1,9 +1,27 @@
 ﻿#include <application.h>
+#include <benchmarks.h>
+#include <string>
 
 int main(int argc, char** argv) {
+    // Run a benchmark instead of the application when asked to
+    if (argc > 2 && std::string(argv[1]) == "--benchmark") {
+        return Benchmarks::Run(argv[2]);
+    }
+
     // Create an instance of the Application with the specified window title, width, and height
     Application app{ "Andy Churchill", 800, 600 };
 
+    // Parse the remaining options
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--packed-vertices") {
+            app.SetVertexFormat(VertexFormat::Packed);
+        } else if (std::string(argv[i]) == "--instances" && i + 1 < argc) {
+            app.SetInstanceCount(static_cast<uint32_t>(std::stoul(argv[++i])));
+        } else if (std::string(argv[i]) == "--gltf" && i + 1 < argc) {
+            app.SetModelPath(argv[++i]);
+        }
+    }
+
     // Run the application
     app.Run();
 
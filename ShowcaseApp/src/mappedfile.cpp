@@ -0,0 +1,113 @@
+#include "mappedfile.h"
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+        : _data(std::exchange(other._data, nullptr)),
+          _size(std::exchange(other._size, 0))
+#ifdef _WIN32
+          , _file(std::exchange(other._file, nullptr)),
+          _mapping(std::exchange(other._mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#ifdef _WIN32
+        _file = std::exchange(other._file, nullptr);
+        _mapping = std::exchange(other._mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        std::cerr << "MappedFile: failed to map " << path.string() << std::endl;
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _mapping = mapping;
+    _size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status {};
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);  // The mapping keeps its own reference to the file
+    if (data == MAP_FAILED) {
+        std::cerr << "MappedFile: failed to map " << path.string() << std::endl;
+        return false;
+    }
+    _size = static_cast<size_t>(status.st_size);
+#endif
+
+    _data = static_cast<const std::byte*>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (!_data) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    munmap(const_cast<std::byte*>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
@@ -1,55 +1,309 @@
 #include "mesh.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <utility>
+#include "glstate.h"
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, GeometryArena* arena)
+        : _ownedVertices(std::move(vertices)), _ownedIndices(std::move(indices)),
+          _vertices(_ownedVertices), _indices(_ownedIndices)
+{
+    initialize(arena);
+}
+
+Mesh::Mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryArena* arena)
         : _vertices(vertices), _indices(indices)
 {
+    initialize(arena);
+}
+
+void Mesh::initialize(GeometryArena* arena)
+{
+    // Bounds of the mesh; the height is their vertical size
+    _bounds = BoundingBox();
+    for (const auto& vertex : _vertices) {
+        _bounds.Expand(vertex.Position);
+    }
+    _height = _bounds.IsEmpty() ? 0.0f : _bounds.Max.y - _bounds.Min.y;
+
+    // Centred on the box, the sphere is at most sqrt(3) times the tightest one and costs one more pass
+    _sphere.Center = _bounds.GetCenter();
+    float radiusSquared = 0.0f;
+    for (const auto& vertex : _vertices) {
+        glm::vec3 offset = vertex.Position - _sphere.Center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    _sphere.Radius = std::sqrt(radiusSquared);
+
+    // Set the element count, drawn as a single range until the owner splits it by material
+    _elementCount = static_cast<uint32_t>(_indices.size());
+    _subMeshes = { SubMesh{ 0, _elementCount, 0 } };
+
+    // Suballocate from the shared arena when one is given; its VAO already describes the vertex layout
+    if (arena) {
+        if (arena->GetVertexFormat() == VertexFormat::Packed) {
+            _quantization = VertexEncoder::ComputeQuantization(_vertices);
+        }
+        _arenaHandle = arena->Allocate(_vertices, _indices, _quantization);
+        if (_arenaHandle != GeometryArena::InvalidHandle) {
+            _arena = arena;
+            return;
+        }
+        std::cerr << "Mesh: arena allocation failed, falling back to private buffers" << std::endl;
+        _quantization = {};
+    }
+
     // Create vertex array object, vertex buffer object, and element buffer object
     glGenVertexArrays(1, &_vertexArrayObject);
     glGenBuffers(1, &_vertexBufferObject);
     glGenBuffers(1, &_elementBufferObject);
 
     // Bind the vertex array object
-    glBindVertexArray(_vertexArrayObject);
+    GLState::BindVertexArray(_vertexArrayObject);
 
     // Bind and fill the vertex buffer object with vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
     glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), _vertices.data(), GL_STATIC_DRAW);
 
-    // Bind and fill the element buffer object with index data
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(uint32_t), _indices.data(), GL_STATIC_DRAW);
+    // Bind and fill the element buffer object with index data, halving it when every index fits in 16 bits
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferObject);
+    if (_vertices.size() <= UINT16_MAX + 1u) {
+        std::vector<uint16_t> shortIndices(_indices.begin(), _indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        _indexType = GL_UNSIGNED_SHORT;
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(uint32_t), _indices.data(), GL_STATIC_DRAW);
+    }
 
-    // Calculate the height of the mesh
-    float minY = FLT_MAX;
-    float maxY = FLT_MIN;
-    for (const auto& vertex : _vertices) {
-        minY = std::min(minY, vertex.Position.y);
-        maxY = std::max(maxY, vertex.Position.y);
+    VertexEncoder::SetupAttributes(VertexFormat::Full);
+}
+
+Mesh::~Mesh()
+{
+    release();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+        : Transform(other.Transform),
+          Static(other.Static),
+          Occluder(other.Occluder),
+          _elementCount(other._elementCount),
+          _indexType(other._indexType),
+          _vertexBufferObject(std::exchange(other._vertexBufferObject, 0)),
+          _vertexArrayObject(std::exchange(other._vertexArrayObject, 0)),
+          _elementBufferObject(std::exchange(other._elementBufferObject, 0)),
+          _arena(std::exchange(other._arena, nullptr)),
+          _arenaHandle(std::exchange(other._arenaHandle, GeometryArena::InvalidHandle)),
+          _height(other._height),
+          _bounds(other._bounds),
+          _sphere(other._sphere),
+          _worldBounds(other._worldBounds),
+          _worldBoundsTransform(other._worldBoundsTransform),
+          _quantization(other._quantization),
+          _ownedVertices(std::move(other._ownedVertices)),
+          _ownedIndices(std::move(other._ownedIndices)),
+          _vertices(std::exchange(other._vertices, {})),
+          _indices(std::exchange(other._indices, {})),
+          _materials(std::move(other._materials)),
+          _subMeshes(std::move(other._subMeshes)),
+          _geometricError(other._geometricError),
+          _lods(std::move(other._lods)),
+          _activeLod(std::exchange(other._activeLod, 0))
+{
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        Transform = other.Transform;
+        Static = other.Static;
+        Occluder = other.Occluder;
+        _elementCount = other._elementCount;
+        _indexType = other._indexType;
+        _vertexBufferObject = std::exchange(other._vertexBufferObject, 0);
+        _vertexArrayObject = std::exchange(other._vertexArrayObject, 0);
+        _elementBufferObject = std::exchange(other._elementBufferObject, 0);
+        _arena = std::exchange(other._arena, nullptr);
+        _arenaHandle = std::exchange(other._arenaHandle, GeometryArena::InvalidHandle);
+        _height = other._height;
+        _bounds = other._bounds;
+        _sphere = other._sphere;
+        _worldBounds = other._worldBounds;
+        _worldBoundsTransform = other._worldBoundsTransform;
+        _quantization = other._quantization;
+        // Moving a vector keeps its buffer, so views into the owned storage stay valid
+        _ownedVertices = std::move(other._ownedVertices);
+        _ownedIndices = std::move(other._ownedIndices);
+        _vertices = std::exchange(other._vertices, {});
+        _indices = std::exchange(other._indices, {});
+        _materials = std::move(other._materials);
+        _subMeshes = std::move(other._subMeshes);
+        _geometricError = other._geometricError;
+        _lods = std::move(other._lods);
+        _activeLod = std::exchange(other._activeLod, 0);
     }
-    _height = maxY - minY;
+    return *this;
+}
 
-    // Define vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Color));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Uv));
+void Mesh::SetColor(glm::vec3 color)
+{
+    if (_ownedVertices.data() != _vertices.data()) {
+        _ownedVertices.assign(_vertices.begin(), _vertices.end());
+        _vertices = _ownedVertices;
+    }
+    for (auto& vertex : _ownedVertices) {
+        vertex.Color = color;
+    }
+}
 
-    // Enable vertex attributes
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
+const TextureSet& Mesh::GetMaterial(uint32_t material) const
+{
+    static const TextureSet empty;
+    return material < _materials.size() ? _materials[material] : empty;
+}
 
-    // Set the element count
-    _elementCount = static_cast<uint32_t>(_indices.size());
+void Mesh::release()
+{
+    _lods.clear();
+    _activeLod = 0;
+    if (_arena) {
+        _arena->Free(_arenaHandle);
+        _arena = nullptr;
+        _arenaHandle = GeometryArena::InvalidHandle;
+    }
+    if (_vertexArrayObject) {
+        GLState::DeleteVertexArray(_vertexArrayObject);
+        GLState::DeleteBuffer(_vertexBufferObject);
+        GLState::DeleteBuffer(_elementBufferObject);
+        _vertexArrayObject = 0;
+        _vertexBufferObject = 0;
+        _elementBufferObject = 0;
+    }
+}
+
+void Mesh::AddLod(Mesh lod, float geometricError)
+{
+    lod._geometricError = geometricError;
+
+    // A simplified level may stray outside the finer one, so the bounds grow to hold it
+    if (!lod._bounds.IsEmpty()) {
+        _bounds.Expand(lod._bounds);
+        glm::vec3 center = _bounds.GetCenter();
+        _sphere.Radius = std::max(glm::length(_sphere.Center - center) + _sphere.Radius,
+                                  glm::length(lod._sphere.Center - center) + lod._sphere.Radius);
+        _sphere.Center = center;
+        _worldBoundsTransform = glm::mat4(0.0f);
+    }
+    _lods.push_back(std::move(lod));
+}
+
+uint32_t Mesh::SelectLod(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelTolerance)
+{
+    if (_lods.empty()) {
+        return 0;
+    }
+
+    float pixels = pixelsPerUnit(Transform, view, projection, viewportHeight);
+    auto levelError = [this](uint32_t level) { return level == 0 ? _geometricError : _lods[level - 1]._geometricError; };
+
+    // Refine as soon as the level is visibly wrong, but only coarsen once the next level is comfortably
+    // inside the tolerance, so a mesh sitting on a threshold does not flicker between levels
+    while (_activeLod > 0 && levelError(_activeLod) * pixels > pixelTolerance) {
+        _activeLod--;
+    }
+    while (_activeLod + 1 < GetLodCount() && levelError(_activeLod + 1) * pixels <= pixelTolerance * LodHysteresis) {
+        _activeLod++;
+    }
+    return _activeLod;
+}
+
+uint32_t Mesh::GetTriangleCount() const
+{
+    uint32_t indexCount = 0;
+    for (const auto& subMesh : GetSubMeshes()) {
+        indexCount += subMesh.IndexCount;
+    }
+    return indexCount / 3;
+}
+
+uint32_t Mesh::GetLodFor(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                         float pixelTolerance) const
+{
+    float pixels = pixelsPerUnit(transform, view, projection, viewportHeight);
+    uint32_t level = 0;
+    while (level + 1 < GetLodCount() && GetGeometricError(level + 1) * pixels <= pixelTolerance) {
+        level++;
+    }
+    return level;
+}
+
+const BoundingBox& Mesh::GetWorldBounds() const
+{
+    if (Transform != _worldBoundsTransform) {
+        _worldBounds = _bounds.Transformed(Transform);
+        _worldBoundsTransform = Transform;
+    }
+    return _worldBounds;
+}
+
+float Mesh::pixelsPerUnit(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, float viewportHeight) const
+{
+    // Measured at the centre of the bounds, which need not be the mesh's origin
+    glm::vec4 clip = projection * view * transform * glm::vec4(_sphere.Center, 1.0f);
+    float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                             glm::length(glm::vec3(transform[2])) });
+
+    // w is 1 for an orthographic projection
+    return scale * projection[1][1] * viewportHeight * 0.5f / std::max(clip.w, 1e-4f);
+}
+
+void Mesh::DrawInstanced(uint32_t instanceCount)
+{
+    for (uint32_t i = 0; i < GetSubMeshes().size(); i++) {
+        DrawSubMesh(i, instanceCount);
+    }
 }
 
 void Mesh::Draw()
 {
-    // Bind the vertex array object
-    glBindVertexArray(_vertexArrayObject);
+    for (uint32_t i = 0; i < GetSubMeshes().size(); i++) {
+        DrawSubMesh(i);
+    }
+}
+
+void Mesh::DrawSubMesh(uint32_t subMesh, uint32_t instanceCount)
+{
+    GLState::BindVertexArray(GetVertexArray());
+    SubmitSubMesh(subMesh, instanceCount);
+}
+
+GLuint Mesh::GetVertexArray() const
+{
+    const Mesh& level = active();
+    return level._arena ? level._arena->GetVertexArray() : level._vertexArrayObject;
+}
+
+void Mesh::SubmitSubMesh(uint32_t subMesh, uint32_t instanceCount) const
+{
+    if (_activeLod > 0) {
+        _lods[_activeLod - 1].SubmitSubMesh(subMesh, instanceCount);
+        return;
+    }
+
+    const SubMesh& range = _subMeshes[subMesh];
+    if (_arena) {
+        // Every arena mesh shares one VAO; the range picks out this mesh's indices and vertices
+        const auto& allocation = _arena->GetRange(_arenaHandle);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.IndexCount), allocation.IndexType,
+                                          (void*)(allocation.GetIndexOffset() + static_cast<uintptr_t>(range.FirstIndex) * allocation.GetIndexSize()),
+                                          static_cast<GLsizei>(instanceCount), allocation.BaseVertex);
+        return;
+    }
 
     // Perform the draw call
-    glDrawElements(GL_TRIANGLES, _elementCount, GL_UNSIGNED_INT, nullptr);
-}
\ No newline at end of file
+    const uintptr_t indexSize = _indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(range.IndexCount), _indexType, (void*)(range.FirstIndex * indexSize),
+                            static_cast<GLsizei>(instanceCount));
+}
@@ -0,0 +1,202 @@
+#include "meshfile.h"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static_assert(std::endian::native == std::endian::little, "Mesh files are stored little-endian and used in place");
+
+namespace {
+    uint64_t alignUp(uint64_t offset) { return (offset + MeshFile::Alignment - 1) / MeshFile::Alignment * MeshFile::Alignment; }
+
+    // Layout of Vertex as this build sees it; a file cooked with another layout is refused rather than misread
+    void describeVertex(MeshFileHeader& header)
+    {
+        header.VertexStride = sizeof(Vertex);
+        header.Attributes[0] = { static_cast<uint16_t>(offsetof(Vertex, Position)), 3 };
+        header.Attributes[1] = { static_cast<uint16_t>(offsetof(Vertex, Color)), 3 };
+        header.Attributes[2] = { static_cast<uint16_t>(offsetof(Vertex, Normal)), 3 };
+        header.Attributes[3] = { static_cast<uint16_t>(offsetof(Vertex, Uv)), 2 };
+        header.Attributes[4] = { static_cast<uint16_t>(offsetof(Vertex, Uv2)), 2 };
+    }
+
+    bool fail(const std::filesystem::path& path, const char* reason)
+    {
+        std::cerr << "Mesh file " << path.string() << ": " << reason << std::endl;
+        return false;
+    }
+}
+
+uint64_t MeshFile::Checksum(std::span<const std::byte> data)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    if (i < data.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, data.data() + i, data.size() - i);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool MeshFile::Write(const std::filesystem::path& path, std::span<const Level> levels)
+{
+    if (levels.empty() || levels.front().Vertices.empty()) {
+        return fail(path, "nothing to write");
+    }
+
+    MeshFileHeader header{};
+    header.Magic = Magic;
+    header.Version = Version;
+    header.LodCount = static_cast<uint32_t>(levels.size());
+    describeVertex(header);
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for (const auto& vertex : levels.front().Vertices) {
+        boundsMin = glm::min(boundsMin, vertex.Position);
+        boundsMax = glm::max(boundsMax, vertex.Position);
+    }
+    std::memcpy(header.BoundsMin, &boundsMin, sizeof(header.BoundsMin));
+    std::memcpy(header.BoundsMax, &boundsMax, sizeof(header.BoundsMax));
+
+    // Tables first, then each level's vertices and indices, every blob starting on an aligned offset
+    std::vector<MeshFileLod> lods(levels.size());
+    for (size_t level = 0; level < levels.size(); level++) {
+        lods[level].FirstSubMesh = header.SubMeshCount;
+        lods[level].SubMeshCount = static_cast<uint32_t>(levels[level].SubMeshes.size());
+        header.SubMeshCount += lods[level].SubMeshCount;
+    }
+    uint64_t offset = alignUp(sizeof(MeshFileHeader) + lods.size() * sizeof(MeshFileLod) + header.SubMeshCount * sizeof(SubMesh));
+    for (size_t level = 0; level < levels.size(); level++) {
+        lods[level].VertexCount = static_cast<uint32_t>(levels[level].Vertices.size());
+        lods[level].IndexCount = static_cast<uint32_t>(levels[level].Indices.size());
+        lods[level].GeometricError = levels[level].GeometricError;
+        lods[level].VertexOffset = offset;
+        offset = alignUp(offset + levels[level].Vertices.size_bytes());
+        lods[level].IndexOffset = offset;
+        offset = alignUp(offset + levels[level].Indices.size_bytes());
+    }
+    header.FileSize = offset;
+
+    std::vector<std::byte> file(header.FileSize);
+    std::byte* cursor = file.data() + sizeof(MeshFileHeader);
+    std::memcpy(cursor, lods.data(), lods.size() * sizeof(MeshFileLod));
+    cursor += lods.size() * sizeof(MeshFileLod);
+    for (const auto& level : levels) {
+        if (!level.SubMeshes.empty()) {
+            std::memcpy(cursor, level.SubMeshes.data(), level.SubMeshes.size_bytes());
+        }
+        cursor += level.SubMeshes.size_bytes();
+    }
+    for (size_t level = 0; level < levels.size(); level++) {
+        std::memcpy(file.data() + lods[level].VertexOffset, levels[level].Vertices.data(), levels[level].Vertices.size_bytes());
+        if (!levels[level].Indices.empty()) {
+            std::memcpy(file.data() + lods[level].IndexOffset, levels[level].Indices.data(), levels[level].Indices.size_bytes());
+        }
+    }
+    header.Checksum = Checksum(std::span<const std::byte>(file).subspan(sizeof(MeshFileHeader)));
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()))) {
+        return fail(path, "failed to write");
+    }
+    return true;
+}
+
+bool MeshFile::Open(const std::filesystem::path& path)
+{
+    _levels.clear();
+    if (!_file.Open(path)) {
+        return false;
+    }
+
+    auto data = _file.GetData();
+    if (data.size() < sizeof(MeshFileHeader)) {
+        return fail(path, "too small for a header");
+    }
+    MeshFileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.Magic != Magic) {
+        return fail(path, "not a mesh file");
+    }
+    if (header.Version != Version) {
+        return fail(path, "cooked for another version, recook it");
+    }
+    MeshFileHeader expected{};
+    describeVertex(expected);
+    if (header.VertexStride != expected.VertexStride ||
+        std::memcmp(header.Attributes, expected.Attributes, sizeof(header.Attributes)) != 0) {
+        return fail(path, "vertex layout does not match this build");
+    }
+    if (header.FileSize != data.size() || header.LodCount == 0) {
+        return fail(path, "truncated or empty");
+    }
+    const uint64_t tablesEnd = sizeof(MeshFileHeader) + uint64_t(header.LodCount) * sizeof(MeshFileLod) + uint64_t(header.SubMeshCount) * sizeof(SubMesh);
+    if (tablesEnd > data.size()) {
+        return fail(path, "tables run past the end");
+    }
+    if (Checksum(data.subspan(sizeof(MeshFileHeader))) != header.Checksum) {
+        return fail(path, "checksum mismatch");
+    }
+
+    // The tables and blobs are aligned by the writer, so they are viewed in place
+    const auto* lods = reinterpret_cast<const MeshFileLod*>(data.data() + sizeof(MeshFileHeader));
+    const auto* subMeshes = reinterpret_cast<const SubMesh*>(lods + header.LodCount);
+    for (uint32_t level = 0; level < header.LodCount; level++) {
+        const MeshFileLod& lod = lods[level];
+        const uint64_t vertexBytes = uint64_t(lod.VertexCount) * sizeof(Vertex);
+        const uint64_t indexBytes = uint64_t(lod.IndexCount) * sizeof(uint32_t);
+        if (lod.VertexOffset % Alignment != 0 || lod.IndexOffset % Alignment != 0 || lod.VertexOffset < tablesEnd ||
+            lod.IndexOffset < tablesEnd || lod.VertexOffset + vertexBytes > data.size() || lod.IndexOffset + indexBytes > data.size() ||
+            uint64_t(lod.FirstSubMesh) + lod.SubMeshCount > header.SubMeshCount) {
+            _levels.clear();
+            return fail(path, "level out of bounds");
+        }
+
+        Level entry;
+        entry.Vertices = { reinterpret_cast<const Vertex*>(data.data() + lod.VertexOffset), lod.VertexCount };
+        entry.Indices = { reinterpret_cast<const uint32_t*>(data.data() + lod.IndexOffset), lod.IndexCount };
+        entry.SubMeshes = { subMeshes + lod.FirstSubMesh, lod.SubMeshCount };
+        entry.GeometricError = lod.GeometricError;
+        bool valid = std::all_of(entry.Indices.begin(), entry.Indices.end(), [&](uint32_t index) { return index < lod.VertexCount; }) &&
+                     std::all_of(entry.SubMeshes.begin(), entry.SubMeshes.end(), [&](const SubMesh& subMesh) {
+                         return uint64_t(subMesh.FirstIndex) + subMesh.IndexCount <= lod.IndexCount;
+                     });
+        if (!valid) {
+            _levels.clear();
+            return fail(path, "index out of range");
+        }
+        _levels.push_back(entry);
+    }
+
+    std::memcpy(&_boundsMin, header.BoundsMin, sizeof(header.BoundsMin));
+    std::memcpy(&_boundsMax, header.BoundsMax, sizeof(header.BoundsMax));
+    return true;
+}
+
+Mesh MeshFile::CreateMesh(GeometryArena* arena) const
+{
+    auto createLevel = [&](const Level& level) {
+        Mesh mesh(level.Vertices, level.Indices, arena);
+        if (!level.SubMeshes.empty()) {
+            mesh.SetSubMeshes({ level.SubMeshes.begin(), level.SubMeshes.end() });
+        }
+        return mesh;
+    };
+
+    Mesh mesh = createLevel(_levels.front());
+    mesh.SetGeometricError(_levels.front().GeometricError);
+    for (size_t level = 1; level < _levels.size(); level++) {
+        mesh.AddLod(createLevel(_levels[level]), _levels[level].GeometricError);
+    }
+    return mesh;
+}
@@ -0,0 +1,301 @@
+#include "meshoptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t cacheSize)
+{
+    Report report;
+    report.VerticesBefore = static_cast<uint32_t>(vertices.size());
+    report.Before = AnalyzeVertexCache(indices, report.VerticesBefore, cacheSize);
+
+    WeldVertices(vertices, indices);
+    auto clusters = OptimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()), cacheSize);
+    OptimizeOverdraw(indices, vertices, clusters);
+    OptimizeVertexFetch(vertices, indices);
+
+    report.VerticesAfter = static_cast<uint32_t>(vertices.size());
+    report.After = AnalyzeVertexCache(indices, report.VerticesAfter, cacheSize);
+    report.Clusters = static_cast<uint32_t>(clusters.size());
+    return report;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    CacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    // A vertex is in the FIFO if it entered within the last cacheSize misses
+    std::vector<uint32_t> entered(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t misses = 0;
+    uint32_t uniqueVertices = 0;
+    for (auto index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+        if (entered[index] == 0 || misses - entered[index] + 1 > cacheSize) {
+            misses++;
+            entered[index] = misses;
+        }
+    }
+
+    stats.Acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.Atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+void MeshOptimizer::WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    static_assert(sizeof(Vertex) == 13 * sizeof(float), "Vertex must have no padding to be compared bytewise");
+
+    std::unordered_map<std::string_view, uint32_t> unique;
+    unique.reserve(vertices.size());
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        std::string_view key(reinterpret_cast<const char*>(&vertices[i]), sizeof(Vertex));
+        auto [it, inserted] = unique.try_emplace(key, static_cast<uint32_t>(welded.size()));
+        if (inserted) {
+            welded.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for (auto& index : indices) {
+        index = remap[index];
+    }
+    vertices = std::move(welded);
+}
+
+namespace {
+    // Forsyth's scoring: recently used vertices score high, and so do vertices with few triangles left
+    float vertexScore(int32_t cachePosition, uint32_t liveTriangles, uint32_t cacheSize)
+    {
+        if (liveTriangles == 0) {
+            return -1.f;
+        }
+
+        float score = 0.f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // The last triangle's vertices get a fixed score so the next triangle does not simply reuse them
+                score = 0.75f;
+            } else {
+                float scaler = 1.f / static_cast<float>(cacheSize - 3);
+                score = std::pow(1.f - static_cast<float>(cachePosition - 3) * scaler, 1.5f);
+            }
+        }
+        return score + 2.f / std::sqrt(static_cast<float>(liveTriangles));
+    }
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    // Forsyth's linear-speed vertex cache optimisation over a simulated LRU cache; the result is kept only if it
+    // beats the input order on the FIFO model, since generated strips are often already close to optimal
+    const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<uint32_t> clusters;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    // Vertex to triangle adjacency in compressed rows
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (auto index : indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            auto index = indices[triangle * 3 + corner];
+            adjacency[fill[index]++] = triangle;
+        }
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+        score[vertex] = vertexScore(-1, liveTriangles[vertex], cacheSize);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    uint32_t cursor = 0;
+
+    int64_t best = 0;
+    while (best >= 0) {
+        auto triangle = static_cast<uint32_t>(best);
+        emitted[triangle] = true;
+
+        // Emit the triangle and move its vertices to the front of the cache
+        nextCache.clear();
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            auto index = indices[triangle * 3 + corner];
+            output.push_back(index);
+            nextCache.push_back(index);
+            liveTriangles[index]--;
+
+            // Drop the triangle from the vertex's live adjacency
+            auto begin = adjacency.begin() + adjacencyOffsets[index];
+            auto end = begin + liveTriangles[index] + 1;
+            std::iter_swap(std::find(begin, end, triangle), end - 1);
+        }
+        for (auto index : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), index) == nextCache.end()) {
+                nextCache.push_back(index);
+            }
+        }
+
+        // Rescore everything that was or is in the cache, and the triangles around those vertices
+        for (size_t position = 0; position < nextCache.size(); position++) {
+            auto index = nextCache[position];
+            cachePosition[index] = position < cacheSize ? static_cast<int32_t>(position) : -1;
+            score[index] = vertexScore(cachePosition[index], liveTriangles[index], cacheSize);
+        }
+        if (nextCache.size() > cacheSize) {
+            nextCache.resize(cacheSize);
+        }
+
+        best = -1;
+        float bestScore = -1.f;
+        for (auto index : nextCache) {
+            auto offset = adjacencyOffsets[index];
+            for (uint32_t live = 0; live < liveTriangles[index]; live++) {
+                auto candidate = adjacency[offset + live];
+                auto candidateScore = score[indices[candidate * 3]] + score[indices[candidate * 3 + 1]] + score[indices[candidate * 3 + 2]];
+                if (candidateScore > bestScore) {
+                    bestScore = candidateScore;
+                    best = candidate;
+                }
+            }
+        }
+        std::swap(cache, nextCache);
+
+        if (best < 0) {
+            // Nothing adjacent to the cache is left: restart at the next unemitted triangle
+            while (cursor < triangleCount && emitted[cursor]) {
+                cursor++;
+            }
+            if (cursor < triangleCount) {
+                best = cursor;
+            }
+        }
+    }
+
+    if (AnalyzeVertexCache(output, vertexCount, cacheSize).Acmr < AnalyzeVertexCache(indices, vertexCount, cacheSize).Acmr) {
+        indices = std::move(output);
+    }
+
+    // Split where the FIFO has nothing left to reuse: a triangle whose three vertices all miss starts a cluster,
+    // so the overdraw pass can reorder clusters without costing extra transforms
+    std::vector<uint32_t> entered(vertexCount, 0);
+    uint32_t misses = 0;
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+        uint32_t triangleMisses = 0;
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            auto index = indices[triangle * 3 + corner];
+            if (entered[index] == 0 || misses - entered[index] + 1 > cacheSize) {
+                entered[index] = ++misses;
+                triangleMisses++;
+            }
+        }
+        if (triangleMisses == 3) {
+            clusters.push_back(triangle);
+        }
+    }
+    return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusters)
+{
+    // Clusters facing away from the mesh center are likely to occlude the rest, so draw them first
+    const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    glm::vec3 meshCentroid{ 0.f };
+    float meshArea = 0.f;
+    struct Cluster {
+        uint32_t First;
+        uint32_t Count;
+        float SortKey;
+    };
+    std::vector<Cluster> sorted;
+    std::vector<glm::vec3> centroids;
+    std::vector<glm::vec3> normals;
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        auto first = clusters[c];
+        auto last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid{ 0.f };
+        glm::vec3 normal{ 0.f };
+        float area = 0.f;
+        for (auto triangle = first; triangle < last; triangle++) {
+            const auto& a = vertices[indices[triangle * 3 + 0]].Position;
+            const auto& b = vertices[indices[triangle * 3 + 1]].Position;
+            const auto& c2 = vertices[indices[triangle * 3 + 2]].Position;
+            auto cross = glm::cross(b - a, c2 - a);
+            auto triangleArea = glm::length(cross) * 0.5f;
+            centroid += (a + b + c2) / 3.f * triangleArea;
+            normal += cross;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0.f ? centroid / area : centroid);
+        normals.push_back(glm::length(normal) > 0.f ? glm::normalize(normal) : normal);
+        sorted.push_back({ first, last - first, 0.f });
+    }
+
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+    for (size_t c = 0; c < sorted.size(); c++) {
+        sorted[c].SortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const auto& cluster : sorted) {
+        output.insert(output.end(), indices.begin() + cluster.First * 3, indices.begin() + (cluster.First + cluster.Count) * 3);
+    }
+    indices = std::move(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    // Lay vertices out in the order the indices first touch them; unreferenced vertices are dropped
+    constexpr uint32_t unassigned = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), unassigned);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == unassigned) {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(ordered);
+}
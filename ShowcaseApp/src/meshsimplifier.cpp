@@ -0,0 +1,359 @@
+#include "meshsimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "meshoptimizer.h"
+
+namespace {
+    // Weighted sum of squared distances to a set of planes, as the symmetric matrix A, the vector B and the
+    // constant C of p.A.p + 2 B.p + C, plus the total weight; doubles keep the sum stable across thousands of
+    // accumulated planes
+    struct Quadric {
+        double A00{ 0 }, A01{ 0 }, A02{ 0 }, A11{ 0 }, A12{ 0 }, A22{ 0 };
+        double B0{ 0 }, B1{ 0 }, B2{ 0 };
+        double C{ 0 };
+        double Weight{ 0 };
+
+        static Quadric FromPlane(const glm::dvec3& normal, double distance, double weight)
+        {
+            Quadric q;
+            q.A00 = weight * normal.x * normal.x;
+            q.A01 = weight * normal.x * normal.y;
+            q.A02 = weight * normal.x * normal.z;
+            q.A11 = weight * normal.y * normal.y;
+            q.A12 = weight * normal.y * normal.z;
+            q.A22 = weight * normal.z * normal.z;
+            q.B0 = weight * normal.x * distance;
+            q.B1 = weight * normal.y * distance;
+            q.B2 = weight * normal.z * distance;
+            q.C = weight * distance * distance;
+            q.Weight = weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            A00 += other.A00; A01 += other.A01; A02 += other.A02;
+            A11 += other.A11; A12 += other.A12; A22 += other.A22;
+            B0 += other.B0; B1 += other.B1; B2 += other.B2;
+            C += other.C;
+            Weight += other.Weight;
+            return *this;
+        }
+
+        // Weighted mean squared distance, so the error is a squared object-space length whatever the mesh's scale
+        double Evaluate(const glm::vec3& p) const
+        {
+            if (Weight <= 0.0) {
+                return 0.0;
+            }
+            double x = p.x, y = p.y, z = p.z;
+            double result = A00 * x * x + 2 * A01 * x * y + 2 * A02 * x * z + A11 * y * y + 2 * A12 * y * z + A22 * z * z
+                            + 2 * (B0 * x + B1 * y + B2 * z) + C;
+            return std::max(result, 0.0) / Weight;
+        }
+    };
+
+    struct Collapse {
+        uint32_t From;  // Vertex that disappears
+        uint32_t To;  // Neighbour it is moved onto
+        double Cost;  // Squared error of the move
+    };
+
+    struct PartResult {
+        std::vector<uint32_t> Indices;
+        double ErrorSquared{ 0 };
+    };
+
+    // Squared error of giving From's triangles To's attributes, scaled by the squared edge length so it is on the
+    // same squared-distance scale as Quadric::Evaluate
+    double attributeCost(const Vertex& from, const Vertex& to, float weight)
+    {
+        auto edge = glm::dot(from.Position - to.Position, from.Position - to.Position);
+        auto normal = from.Normal - to.Normal;
+        auto uv = from.Uv - to.Uv;
+        auto color = from.Color - to.Color;
+        auto change = 0.25f * glm::dot(normal, normal) + glm::dot(uv, uv) + glm::dot(color, color) / 3.0f;
+        return static_cast<double>(weight) * edge * change;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        return glm::cross(b - a, c - a);
+    }
+
+    // Greedy passes of independent collapses, cheapest first, until the target count or error is reached
+    PartResult simplifyPart(std::span<const Vertex> vertices, std::vector<uint32_t> indices, const std::vector<bool>& locked,
+                            uint32_t targetTriangles, double maxErrorSquared, float attributeWeight)
+    {
+        const auto vertexCount = static_cast<uint32_t>(vertices.size());
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            const auto& a = vertices[indices[t]].Position;
+            const auto& b = vertices[indices[t + 1]].Position;
+            const auto& c = vertices[indices[t + 2]].Position;
+            glm::dvec3 normal = triangleNormal(a, b, c);
+            auto length = glm::length(normal);
+            if (length == 0.0) {
+                continue;
+            }
+            normal /= length;
+            // Area weighting keeps slivers from dominating the error; Evaluate divides the total back out
+            auto plane = Quadric::FromPlane(normal, -glm::dot(normal, glm::dvec3(a)), length * 0.5);
+            quadrics[indices[t]] += plane;
+            quadrics[indices[t + 1]] += plane;
+            quadrics[indices[t + 2]] += plane;
+        }
+
+        PartResult result;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+
+        while (indices.size() / 3 > targetTriangles) {
+            // Vertex to triangle adjacency of the current triangles
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (auto index : indices) {
+                adjacencyOffsets[index + 1]++;
+            }
+            std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+            adjacency.resize(indices.size());
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t t = 0; t < indices.size() / 3; t++) {
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    adjacency[fill[indices[t * 3 + corner]]++] = t;
+                }
+            }
+
+            collapses.clear();
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    auto a = indices[t + corner];
+                    auto b = indices[t + (corner + 1) % 3];
+                    if (!locked[a]) {
+                        auto cost = quadrics[a].Evaluate(vertices[b].Position) + attributeCost(vertices[a], vertices[b], attributeWeight);
+                        collapses.push_back({ a, b, cost });
+                    }
+                    if (!locked[b]) {
+                        auto cost = quadrics[b].Evaluate(vertices[a].Position) + attributeCost(vertices[b], vertices[a], attributeWeight);
+                        collapses.push_back({ b, a, cost });
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+            std::iota(remap.begin(), remap.end(), 0u);
+            std::fill(touched.begin(), touched.end(), false);
+            auto budget = indices.size() / 3 - targetTriangles;
+            size_t removed = 0;
+            for (const auto& collapse : collapses) {
+                if (collapse.Cost > maxErrorSquared || removed >= budget) {
+                    break;
+                }
+                if (touched[collapse.From] || touched[collapse.To]) {
+                    continue;
+                }
+
+                // Reject the collapse if any surviving triangle around From would flip over
+                bool flips = false;
+                size_t collapsing = 0;
+                for (auto a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1] && !flips; a++) {
+                    const auto* triangle = &indices[adjacency[a] * 3];
+                    if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To) {
+                        collapsing++;
+                        continue;
+                    }
+                    glm::vec3 before[3];
+                    glm::vec3 after[3];
+                    for (uint32_t corner = 0; corner < 3; corner++) {
+                        before[corner] = vertices[triangle[corner]].Position;
+                        after[corner] = triangle[corner] == collapse.From ? vertices[collapse.To].Position : before[corner];
+                    }
+                    flips = glm::dot(triangleNormal(before[0], before[1], before[2]), triangleNormal(after[0], after[1], after[2])) <= 0.0f;
+                }
+                if (flips) {
+                    continue;
+                }
+
+                remap[collapse.From] = collapse.To;
+                quadrics[collapse.To] += quadrics[collapse.From];
+                result.ErrorSquared = std::max(result.ErrorSquared, collapse.Cost);
+                removed += collapsing;
+
+                // The one-ring's triangles change, so none of their vertices may collapse again this pass
+                for (auto a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; a++) {
+                    for (uint32_t corner = 0; corner < 3; corner++) {
+                        touched[indices[adjacency[a] * 3 + corner]] = true;
+                    }
+                }
+            }
+            if (removed == 0) {
+                break;
+            }
+
+            // Apply the pass and drop the triangles that collapsed to lines
+            size_t write = 0;
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                auto a = remap[indices[t]];
+                auto b = remap[indices[t + 1]];
+                auto c = remap[indices[t + 2]];
+                if (a != b && b != c && a != c) {
+                    indices[write++] = a;
+                    indices[write++] = b;
+                    indices[write++] = c;
+                }
+            }
+            indices.resize(write);
+        }
+
+        result.Indices = std::move(indices);
+        return result;
+    }
+}
+
+MeshSimplifier::Result MeshSimplifier::Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                                                const Options& options)
+{
+    const auto vertexCount = static_cast<uint32_t>(vertices.size());
+    const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Vertices that share a position with a differently attributed vertex sit on a seam; moving them would tear it
+    std::vector<bool> locked(vertexCount, false);
+    std::unordered_map<std::string_view, uint32_t> positions;
+    positions.reserve(vertexCount);
+    std::vector<uint32_t> positionId(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        std::string_view key(reinterpret_cast<const char*>(&vertices[v].Position), sizeof(glm::vec3));
+        auto [it, inserted] = positions.try_emplace(key, v);
+        positionId[v] = it->second;
+        if (!inserted) {
+            locked[v] = true;
+            locked[it->second] = true;
+        }
+    }
+
+    // Edges used by a single triangle are open borders; collapsing across them would shrink the outline
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    edgeUse.reserve(indices.size());
+    auto edgeKey = [&](uint32_t a, uint32_t b) {
+        auto pa = positionId[a];
+        auto pb = positionId[b];
+        return pa < pb ? (static_cast<uint64_t>(pa) << 32) | pb : (static_cast<uint64_t>(pb) << 32) | pa;
+    };
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            edgeUse[edgeKey(indices[t + corner], indices[t + (corner + 1) % 3])]++;
+        }
+    }
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            auto a = indices[t + corner];
+            auto b = indices[t + (corner + 1) % 3];
+            if (edgeUse[edgeKey(a, b)] == 1) {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+
+    const double maxErrorSquared = options.TargetError >= FLT_MAX
+                                   ? DBL_MAX : static_cast<double>(options.TargetError) * options.TargetError;
+
+    Result result;
+    double errorSquared = 0;
+    auto partCount = std::max(options.ThreadCount, 1u);
+    if (partCount == 1 || triangleCount < partCount * 1024) {
+        auto part = simplifyPart(vertices, { indices.begin(), indices.end() }, locked, options.TargetTriangleCount,
+                                 maxErrorSquared, options.AttributeWeight);
+        result.Indices = std::move(part.Indices);
+        errorSquared = part.ErrorSquared;
+    } else {
+        // Slice the triangles into slabs along the longest axis by centroid
+        glm::vec3 minimum(FLT_MAX);
+        glm::vec3 maximum(-FLT_MAX);
+        for (const auto& vertex : vertices) {
+            minimum = glm::min(minimum, vertex.Position);
+            maximum = glm::max(maximum, vertex.Position);
+        }
+        auto extent = maximum - minimum;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        std::vector<std::vector<uint32_t>> parts(partCount);
+        constexpr uint32_t unowned = UINT32_MAX;
+        std::vector<uint32_t> owner(vertexCount, unowned);
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            auto centroid = (vertices[indices[t]].Position[axis] + vertices[indices[t + 1]].Position[axis]
+                             + vertices[indices[t + 2]].Position[axis]) / 3.0f;
+            auto slab = extent[axis] > 0.0f ? static_cast<uint32_t>((centroid - minimum[axis]) / extent[axis] * partCount) : 0u;
+            slab = std::min(slab, partCount - 1);
+            parts[slab].insert(parts[slab].end(), indices.begin() + t, indices.begin() + t + 3);
+
+            // A vertex used by two slabs is shared between threads, so neither may move it
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                auto& vertexOwner = owner[indices[t + corner]];
+                if (vertexOwner == unowned) {
+                    vertexOwner = slab;
+                } else if (vertexOwner != slab) {
+                    locked[indices[t + corner]] = true;
+                }
+            }
+        }
+
+        std::vector<PartResult> partResults(partCount);
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < partCount; p++) {
+            auto partTarget = static_cast<uint32_t>(static_cast<uint64_t>(options.TargetTriangleCount) * (parts[p].size() / 3) / triangleCount);
+            threads.emplace_back([&, p, partTarget]() {
+                partResults[p] = simplifyPart(vertices, std::move(parts[p]), locked, partTarget, maxErrorSquared,
+                                              options.AttributeWeight);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto& part : partResults) {
+            result.Indices.insert(result.Indices.end(), part.Indices.begin(), part.Indices.end());
+            errorSquared = std::max(errorSquared, part.ErrorSquared);
+        }
+    }
+
+    result.Error = static_cast<float>(std::sqrt(errorSquared));
+    result.Vertices.assign(vertices.begin(), vertices.end());
+    MeshOptimizer::OptimizeVertexFetch(result.Vertices, result.Indices);
+    return result;
+}
+
+uint32_t MeshSimplifier::GenerateLods(Mesh& mesh, GeometryArena* arena, uint32_t levelCount, float reduction, Options options)
+{
+    // Every level is simplified from the full mesh so its error is measured against the real surface
+    auto vertices = mesh.GetVertices();
+    auto indices = mesh.GetIndices();
+    auto previousTriangles = static_cast<uint32_t>(indices.size() / 3);
+    auto target = static_cast<float>(previousTriangles);
+
+    uint32_t added = 0;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        target *= reduction;
+        options.TargetTriangleCount = static_cast<uint32_t>(target);
+        auto result = Simplify(vertices, indices, options);
+        auto triangles = static_cast<uint32_t>(result.Indices.size() / 3);
+        if (triangles == 0 || triangles >= previousTriangles) {
+            break;
+        }
+
+        MeshOptimizer::Optimize(result.Vertices, result.Indices);
+        mesh.AddLod(Mesh(std::move(result.Vertices), std::move(result.Indices), arena), result.Error);
+        previousTriangles = triangles;
+        added++;
+    }
+    return added;
+}
@@ -0,0 +1,291 @@
+#include "occlusionbuffer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "workerpool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t TilePixels = OcclusionBuffer::TileWidth * OcclusionBuffer::TileHeight;
+    constexpr float ClearDepth = 1.0f;  // Far plane in window depth
+    constexpr size_t ParallelTriangles = 512;  // Below this, waking the worker threads costs more than the rasterization
+
+    // Pixel coordinates and window depth of a clip-space point in front of the near plane
+    glm::vec3 toWindow(glm::vec4 clip, float width, float height)
+    {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return { (ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f };
+    }
+}
+
+void OcclusionBuffer::Resize(uint32_t width, uint32_t height)
+{
+    uint32_t tilesX = std::max((width + TileWidth - 1) / TileWidth, 1u);
+    uint32_t tilesY = std::max((height + TileHeight - 1) / TileHeight, 1u);
+    if (tilesX == _tilesX && tilesY == _tilesY) {
+        return;
+    }
+    _tilesX = tilesX;
+    _tilesY = tilesY;
+    _width = _tilesX * TileWidth;
+    _height = _tilesY * TileHeight;
+    _depth.assign(static_cast<size_t>(_tilesX) * _tilesY * TilePixels, ClearDepth);
+    _tileMaxDepth.assign(static_cast<size_t>(_tilesX) * _tilesY, ClearDepth);
+    _bins.resize(static_cast<size_t>(_tilesX) * _tilesY);
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& viewProjection)
+{
+    _viewProjection = viewProjection;
+    std::fill(_depth.begin(), _depth.end(), ClearDepth);
+    std::fill(_tileMaxDepth.begin(), _tileMaxDepth.end(), ClearDepth);
+    _triangles.clear();
+}
+
+void OcclusionBuffer::AddOccluder(const Mesh& mesh)
+{
+    // The coarsest level keeps the silhouette within its geometric error at a fraction of the triangles
+    const Mesh& level = mesh.GetLod(mesh.GetLodCount() - 1);
+    AddOccluder(level.GetVertices(), level.GetIndices(), mesh.Transform);
+}
+
+void OcclusionBuffer::AddOccluder(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const glm::mat4& transform)
+{
+    glm::mat4 modelViewProjection = _viewProjection * transform;
+    std::vector<glm::vec4> clip(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        clip[i] = modelViewProjection * glm::vec4(vertices[i].Position, 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec4& a = clip[indices[i]];
+        const glm::vec4& b = clip[indices[i + 1]];
+        const glm::vec4& c = clip[indices[i + 2]];
+        // Drop triangles wholly outside one side of the frustum before any setup
+        if ((a.x < -a.w && b.x < -b.w && c.x < -c.w) || (a.x > a.w && b.x > b.w && c.x > c.w)
+            || (a.y < -a.w && b.y < -b.w && c.y < -c.w) || (a.y > a.w && b.y > b.w && c.y > c.w)
+            || (a.z < -a.w && b.z < -b.w && c.z < -c.w) || (a.z > a.w && b.z > b.w && c.z > c.w)) {
+            continue;
+        }
+        addTriangle(a, b, c);
+    }
+}
+
+void OcclusionBuffer::addTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c)
+{
+    auto width = static_cast<float>(_width);
+    auto height = static_cast<float>(_height);
+    if (a.z >= -a.w && b.z >= -b.w && c.z >= -c.w) {
+        setupTriangle(toWindow(a, width, height), toWindow(b, width, height), toWindow(c, width, height));
+        return;
+    }
+
+    // Sutherland-Hodgman against the near plane (z = -w); a triangle becomes at most a quad
+    std::array<glm::vec4, 3> input{ a, b, c };
+    std::array<glm::vec4, 4> polygon;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        const glm::vec4& current = input[i];
+        const glm::vec4& next = input[(i + 1) % 3];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+        if (currentDistance >= 0.0f) {
+            polygon[count++] = current;
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+            polygon[count++] = glm::mix(current, next, currentDistance / (currentDistance - nextDistance));
+        }
+    }
+    for (uint32_t i = 2; i < count; i++) {
+        setupTriangle(toWindow(polygon[0], width, height), toWindow(polygon[i - 1], width, height), toWindow(polygon[i], width, height));
+    }
+}
+
+void OcclusionBuffer::setupTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if (std::abs(area) < 1e-8f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    // Pixel centres sit at half-integer coordinates; only those inside the bounds can be covered
+    Triangle triangle;
+    triangle.MinX = std::max(static_cast<int>(std::ceil(std::min({ a.x, b.x, c.x }) - 0.5f)), 0);
+    triangle.MinY = std::max(static_cast<int>(std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f)), 0);
+    triangle.MaxX = std::min(static_cast<int>(std::floor(std::max({ a.x, b.x, c.x }) - 0.5f)), static_cast<int>(_width) - 1);
+    triangle.MaxY = std::min(static_cast<int>(std::floor(std::max({ a.y, b.y, c.y }) - 0.5f)), static_cast<int>(_height) - 1);
+    if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY) {
+        return;
+    }
+
+    std::array<glm::vec3, 3> corners{ a, b, c };
+    for (int i = 0; i < 3; i++) {
+        const glm::vec3& from = corners[i];
+        const glm::vec3& to = corners[(i + 1) % 3];
+        triangle.EdgeX[i] = from.y - to.y;
+        triangle.EdgeY[i] = to.x - from.x;
+        triangle.EdgeOffset[i] = from.x * to.y - from.y * to.x;
+    }
+
+    // Window depth is linear in screen space, so it is a plane through the three corners
+    float depthX = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    float depthY = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    triangle.DepthPlane = { depthX, depthY, a.z - depthX * a.x - depthY * a.y };
+    _triangles.push_back(triangle);
+}
+
+void OcclusionBuffer::Rasterize(uint32_t threadCount)
+{
+    for (auto& bin : _bins) {
+        bin.clear();
+    }
+    for (uint32_t t = 0; t < _triangles.size(); t++) {
+        const Triangle& triangle = _triangles[t];
+        for (int ty = triangle.MinY / static_cast<int>(TileHeight); ty <= triangle.MaxY / static_cast<int>(TileHeight); ty++) {
+            for (int tx = triangle.MinX / static_cast<int>(TileWidth); tx <= triangle.MaxX / static_cast<int>(TileWidth); tx++) {
+                _bins[ty * _tilesX + tx].push_back(t);
+            }
+        }
+    }
+    _activeTiles.clear();
+    for (uint32_t tile = 0; tile < _bins.size(); tile++) {
+        if (!_bins[tile].empty()) {
+            _activeTiles.push_back(tile);
+        }
+    }
+
+    // Occluders usually cover a few rows of tiles, so tiles are handed out one at a time rather than in fixed
+    // chunks; every tile is written by exactly one thread, so no locking is needed
+    WorkerPool::Shared().ForEach(_activeTiles.size(), [this](size_t item) {
+        rasterizeTile(_activeTiles[item]);
+    }, _triangles.size() < ParallelTriangles ? 1 : threadCount);
+}
+
+void OcclusionBuffer::rasterizeTile(uint32_t tile)
+{
+    const auto& bin = _bins[tile];
+    if (bin.empty()) {
+        return;
+    }
+    const int tileX = static_cast<int>(tile % _tilesX * TileWidth);
+    const int tileY = static_cast<int>(tile / _tilesX * TileHeight);
+    float* depth = &_depth[static_cast<size_t>(tile) * TilePixels];
+
+    for (uint32_t index : bin) {
+        const Triangle& triangle = _triangles[index];
+        int rowBegin = std::max(triangle.MinY, tileY), rowEnd = std::min(triangle.MaxY, tileY + static_cast<int>(TileHeight) - 1);
+        int columnBegin = std::max(triangle.MinX, tileX), columnEnd = std::min(triangle.MaxX, tileX + static_cast<int>(TileWidth) - 1);
+#if defined(OCCLUSION_USE_SSE2)
+        // Four pixels of a row per step; the edge tests alone decide coverage, the bounds only skip whole quads
+        for (int quad = tileX; quad < tileX + static_cast<int>(TileWidth); quad += 4) {
+            if (quad + 3 < columnBegin || quad > columnEnd) {
+                continue;
+            }
+            __m128 x = _mm_add_ps(_mm_set1_ps(static_cast<float>(quad)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+            __m128 edge0 = _mm_mul_ps(_mm_set1_ps(triangle.EdgeX[0]), x);
+            __m128 edge1 = _mm_mul_ps(_mm_set1_ps(triangle.EdgeX[1]), x);
+            __m128 edge2 = _mm_mul_ps(_mm_set1_ps(triangle.EdgeX[2]), x);
+            __m128 plane = _mm_mul_ps(_mm_set1_ps(triangle.DepthPlane.x), x);
+            for (int row = rowBegin; row <= rowEnd; row++) {
+                float y = static_cast<float>(row) + 0.5f;
+                __m128 inside = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(edge0, _mm_set1_ps(triangle.EdgeY[0] * y + triangle.EdgeOffset[0])), _mm_setzero_ps()),
+                               _mm_cmpge_ps(_mm_add_ps(edge1, _mm_set1_ps(triangle.EdgeY[1] * y + triangle.EdgeOffset[1])), _mm_setzero_ps())),
+                    _mm_cmpge_ps(_mm_add_ps(edge2, _mm_set1_ps(triangle.EdgeY[2] * y + triangle.EdgeOffset[2])), _mm_setzero_ps()));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                float* pixels = depth + (row - tileY) * TileWidth + (quad - tileX);
+                __m128 stored = _mm_loadu_ps(pixels);
+                __m128 z = _mm_add_ps(plane, _mm_set1_ps(triangle.DepthPlane.y * y + triangle.DepthPlane.z));
+                __m128 nearer = _mm_min_ps(stored, z);
+                _mm_storeu_ps(pixels, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+            }
+        }
+#else
+        for (int row = rowBegin; row <= rowEnd; row++) {
+            float y = static_cast<float>(row) + 0.5f;
+            for (int column = columnBegin; column <= columnEnd; column++) {
+                float x = static_cast<float>(column) + 0.5f;
+                glm::vec3 edges = triangle.EdgeX * x + (triangle.EdgeY * y + triangle.EdgeOffset);  // Same order as the SSE2 path
+                if (edges.x >= 0.0f && edges.y >= 0.0f && edges.z >= 0.0f) {
+                    float& pixel = depth[(row - tileY) * TileWidth + (column - tileX)];
+                    pixel = std::min(pixel, triangle.DepthPlane.x * x + (triangle.DepthPlane.y * y + triangle.DepthPlane.z));
+                }
+            }
+        }
+#endif
+    }
+    _tileMaxDepth[tile] = *std::max_element(depth, depth + TilePixels);
+}
+
+bool OcclusionBuffer::IsVisible(const BoundingBox& worldBox) const
+{
+    if (worldBox.IsEmpty() || _depth.empty()) {
+        return true;
+    }
+
+    // Screen rectangle and nearest window depth of the eight corners
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearest = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point((corner & 1) ? worldBox.Max.x : worldBox.Min.x, (corner & 2) ? worldBox.Max.y : worldBox.Min.y,
+                        (corner & 4) ? worldBox.Max.z : worldBox.Min.z);
+        glm::vec4 clip = _viewProjection * glm::vec4(point, 1.0f);
+        if (clip.z < -clip.w || clip.w <= 0.0f) {
+            return true;  // Crosses the near plane, so its projection is unbounded
+        }
+        glm::vec3 window = toWindow(clip, static_cast<float>(_width), static_cast<float>(_height));
+        screenMin = glm::min(screenMin, glm::vec2(window));
+        screenMax = glm::max(screenMax, glm::vec2(window));
+        nearest = std::min(nearest, window.z);
+    }
+
+    // Every pixel the rectangle touches, not just those whose centres it covers
+    int minX = std::max(static_cast<int>(std::floor(screenMin.x)), 0);
+    int minY = std::max(static_cast<int>(std::floor(screenMin.y)), 0);
+    int maxX = std::min(static_cast<int>(std::floor(screenMax.x)), static_cast<int>(_width) - 1);
+    int maxY = std::min(static_cast<int>(std::floor(screenMax.y)), static_cast<int>(_height) - 1);
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+
+    for (int ty = minY / static_cast<int>(TileHeight); ty <= maxY / static_cast<int>(TileHeight); ty++) {
+        for (int tx = minX / static_cast<int>(TileWidth); tx <= maxX / static_cast<int>(TileWidth); tx++) {
+            uint32_t tile = ty * _tilesX + tx;
+            if (_tileMaxDepth[tile] < nearest) {
+                continue;  // Every pixel of the tile is nearer than the box
+            }
+            int tileX = tx * static_cast<int>(TileWidth), tileY = ty * static_cast<int>(TileHeight);
+            int rowBegin = std::max(minY, tileY), rowEnd = std::min(maxY, tileY + static_cast<int>(TileHeight) - 1);
+            int columnBegin = std::max(minX, tileX), columnEnd = std::min(maxX, tileX + static_cast<int>(TileWidth) - 1);
+            if (rowBegin == tileY && rowEnd == tileY + static_cast<int>(TileHeight) - 1 && columnBegin == tileX
+                && columnEnd == tileX + static_cast<int>(TileWidth) - 1) {
+                return true;  // The tile's farthest pixel is inside the rectangle
+            }
+            const float* depth = &_depth[static_cast<size_t>(tile) * TilePixels];
+            for (int row = rowBegin; row <= rowEnd; row++) {
+                for (int column = columnBegin; column <= columnEnd; column++) {
+                    if (depth[(row - tileY) * TileWidth + (column - tileX)] >= nearest) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+float OcclusionBuffer::GetDepth(uint32_t x, uint32_t y) const
+{
+    uint32_t tile = y / TileHeight * _tilesX + x / TileWidth;
+    return _depth[static_cast<size_t>(tile) * TilePixels + (y % TileHeight) * TileWidth + x % TileWidth];
+}
@@ -0,0 +1,423 @@
+#include "raycaster.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include "parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYCAST_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t StackSize = 96;  // Traversal stacks hold at most one entry per level plus one, as in Bvh
+    constexpr float TinyDirection = 1e-30f;  // Stands in for a zero direction component so its inverse stays finite
+    // Slab exits are stretched by this much to cover their rounding error (Ize, Robust BVH Ray Traversal), so rays
+    // grazing a silhouette still reach the triangles on it
+    constexpr float ExitScale = 1.0000004f;
+
+    // Node waiting on a traversal stack, with the distance at which each lane enters it
+    struct StackEntry {
+        alignas(16) float Entry[RayPacket::Width];
+        uint32_t Node;
+    };
+
+    float safeInverse(float direction)
+    {
+        return 1.0f / (std::fabs(direction) < TinyDirection ? std::copysign(TinyDirection, direction) : direction);
+    }
+
+    // Bit per lane whose ray reaches the box before its MaxDistance; entry receives where each ray enters it
+    uint32_t intersectBox(const RayPacket& packet, glm::vec3 min, glm::vec3 max, float* entry)
+    {
+#if defined(RAYCAST_USE_SSE2)
+        __m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min.x), _mm_load_ps(packet.OriginX)), _mm_load_ps(packet.InverseX));
+        __m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max.x), _mm_load_ps(packet.OriginX)), _mm_load_ps(packet.InverseX));
+        __m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min.y), _mm_load_ps(packet.OriginY)), _mm_load_ps(packet.InverseY));
+        __m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max.y), _mm_load_ps(packet.OriginY)), _mm_load_ps(packet.InverseY));
+        __m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min.z), _mm_load_ps(packet.OriginZ)), _mm_load_ps(packet.InverseZ));
+        __m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max.z), _mm_load_ps(packet.OriginZ)), _mm_load_ps(packet.InverseZ));
+        __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(nearX, farX), _mm_min_ps(nearY, farY)),
+                                  _mm_max_ps(_mm_min_ps(nearZ, farZ), _mm_setzero_ps()));
+        __m128 exit = _mm_mul_ps(_mm_min_ps(_mm_min_ps(_mm_max_ps(nearX, farX), _mm_max_ps(nearY, farY)), _mm_max_ps(nearZ, farZ)),
+                                 _mm_set1_ps(ExitScale));
+        exit = _mm_min_ps(exit, _mm_load_ps(packet.MaxDistance));
+        _mm_store_ps(entry, enter);
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+#else
+        uint32_t mask = 0;
+        for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+            float nearX = (min.x - packet.OriginX[lane]) * packet.InverseX[lane];
+            float farX = (max.x - packet.OriginX[lane]) * packet.InverseX[lane];
+            float nearY = (min.y - packet.OriginY[lane]) * packet.InverseY[lane];
+            float farY = (max.y - packet.OriginY[lane]) * packet.InverseY[lane];
+            float nearZ = (min.z - packet.OriginZ[lane]) * packet.InverseZ[lane];
+            float farZ = (max.z - packet.OriginZ[lane]) * packet.InverseZ[lane];
+            float enter = std::max({ std::min(nearX, farX), std::min(nearY, farY), std::min(nearZ, farZ), 0.0f });
+            float exit = std::min(std::min({ std::max(nearX, farX), std::max(nearY, farY), std::max(nearZ, farZ) }) * ExitScale,
+                                  packet.MaxDistance[lane]);
+            entry[lane] = enter;
+            mask |= enter <= exit ? 1u << lane : 0u;
+        }
+        return mask;
+#endif
+    }
+
+    // Bit per lane whose entry distance is still within its MaxDistance, for stack entries a closer hit has made stale
+    uint32_t stillReachable(const RayPacket& packet, const float* entry)
+    {
+#if defined(RAYCAST_USE_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(_mm_load_ps(entry), _mm_load_ps(packet.MaxDistance))));
+#else
+        uint32_t mask = 0;
+        for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+            mask |= entry[lane] <= packet.MaxDistance[lane] ? 1u << lane : 0u;
+        }
+        return mask;
+#endif
+    }
+
+    // Distance at which the first lane of mask enters, used to visit the nearer child first
+    float firstEntry(const float* entry, uint32_t mask)
+    {
+        return entry[std::countr_zero(mask)];
+    }
+}
+
+void RayPacket::Set(uint32_t lane, const Ray& ray)
+{
+    OriginX[lane] = ray.Origin.x;
+    OriginY[lane] = ray.Origin.y;
+    OriginZ[lane] = ray.Origin.z;
+    DirectionX[lane] = ray.Direction.x;
+    DirectionY[lane] = ray.Direction.y;
+    DirectionZ[lane] = ray.Direction.z;
+    InverseX[lane] = safeInverse(ray.Direction.x);
+    InverseY[lane] = safeInverse(ray.Direction.y);
+    InverseZ[lane] = safeInverse(ray.Direction.z);
+    MaxDistance[lane] = ray.MaxDistance;
+}
+
+void RayPacket::Clear(uint32_t lane)
+{
+    Set(lane, Ray{});
+    MaxDistance[lane] = -1.0f;
+}
+
+void TriangleBvh::Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+    auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<BoundingBox> bounds(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            bounds[t].Expand(vertices[indices[t * 3 + corner]].Position);
+        }
+    }
+
+    Bvh builder;
+    builder.Build(bounds);
+    auto nodes = builder.GetNodes();
+    _nodes.assign(nodes.begin(), nodes.end());
+
+    // Store the triangles in the builder's leaf order so leaf ranges index them directly
+    auto order = builder.GetObjectOrder();
+    _triangles.resize(triangleCount);
+    for (uint32_t slot = 0; slot < triangleCount; slot++) {
+        uint32_t t = order[slot];
+        glm::vec3 a = vertices[indices[t * 3]].Position;
+        glm::vec3 b = vertices[indices[t * 3 + 1]].Position;
+        glm::vec3 c = vertices[indices[t * 3 + 2]].Position;
+        _triangles[slot] = { a, t, b - a, c - a };
+    }
+}
+
+BoundingBox TriangleBvh::GetBounds() const
+{
+    if (_nodes.empty()) {
+        return {};
+    }
+    return { _nodes[0].Min, _nodes[0].Max };
+}
+
+void TriangleBvh::Intersect(RayPacket& packet, RayPacketHit& hits, uint32_t object, bool anyHit) const
+{
+    if (_nodes.empty() || _triangles.empty()) {
+        return;
+    }
+
+    std::array<StackEntry, StackSize> stack;
+    uint32_t size = 0;
+    stack[size].Node = 0;
+    if (intersectBox(packet, _nodes[0].Min, _nodes[0].Max, stack[size].Entry) == 0) {
+        return;
+    }
+    size++;
+
+    while (size > 0) {
+        StackEntry top = stack[--size];
+        if (stillReachable(packet, top.Entry) == 0) {
+            continue;
+        }
+        const BvhNode& node = _nodes[top.Node];
+
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+                const Triangle& triangle = _triangles[i];
+                // Moller-Trumbore for four rays against one triangle
+#if defined(RAYCAST_USE_SSE2)
+                __m128 dirX = _mm_load_ps(packet.DirectionX), dirY = _mm_load_ps(packet.DirectionY), dirZ = _mm_load_ps(packet.DirectionZ);
+                __m128 edge1X = _mm_set1_ps(triangle.Edge1.x), edge1Y = _mm_set1_ps(triangle.Edge1.y), edge1Z = _mm_set1_ps(triangle.Edge1.z);
+                __m128 edge2X = _mm_set1_ps(triangle.Edge2.x), edge2Y = _mm_set1_ps(triangle.Edge2.y), edge2Z = _mm_set1_ps(triangle.Edge2.z);
+
+                __m128 pX = _mm_sub_ps(_mm_mul_ps(dirY, edge2Z), _mm_mul_ps(dirZ, edge2Y));
+                __m128 pY = _mm_sub_ps(_mm_mul_ps(dirZ, edge2X), _mm_mul_ps(dirX, edge2Z));
+                __m128 pZ = _mm_sub_ps(_mm_mul_ps(dirX, edge2Y), _mm_mul_ps(dirY, edge2X));
+                __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+                __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+                __m128 toOriginX = _mm_sub_ps(_mm_load_ps(packet.OriginX), _mm_set1_ps(triangle.Corner.x));
+                __m128 toOriginY = _mm_sub_ps(_mm_load_ps(packet.OriginY), _mm_set1_ps(triangle.Corner.y));
+                __m128 toOriginZ = _mm_sub_ps(_mm_load_ps(packet.OriginZ), _mm_set1_ps(triangle.Corner.z));
+                __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(toOriginX, pX), _mm_mul_ps(toOriginY, pY)), _mm_mul_ps(toOriginZ, pZ)), inverse);
+
+                __m128 qX = _mm_sub_ps(_mm_mul_ps(toOriginY, edge1Z), _mm_mul_ps(toOriginZ, edge1Y));
+                __m128 qY = _mm_sub_ps(_mm_mul_ps(toOriginZ, edge1X), _mm_mul_ps(toOriginX, edge1Z));
+                __m128 qZ = _mm_sub_ps(_mm_mul_ps(toOriginX, edge1Y), _mm_mul_ps(toOriginY, edge1X));
+                __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, qX), _mm_mul_ps(dirY, qY)), _mm_mul_ps(dirZ, qZ)), inverse);
+                __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverse);
+
+                // Comparisons against NaN fail, so rays parallel to the triangle (infinite inverse) never hit
+                __m128 zero = _mm_setzero_ps();
+                __m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+                hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+                hit = _mm_and_ps(hit, _mm_cmpge_ps(distance, zero));
+                hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, _mm_load_ps(packet.MaxDistance)));
+                auto mask = static_cast<uint32_t>(_mm_movemask_ps(hit));
+                if (mask == 0) {
+                    continue;
+                }
+                _mm_store_ps(packet.MaxDistance, _mm_or_ps(_mm_and_ps(hit, distance), _mm_andnot_ps(hit, _mm_load_ps(packet.MaxDistance))));
+                _mm_store_ps(hits.U, _mm_or_ps(_mm_and_ps(hit, u), _mm_andnot_ps(hit, _mm_load_ps(hits.U))));
+                _mm_store_ps(hits.V, _mm_or_ps(_mm_and_ps(hit, v), _mm_andnot_ps(hit, _mm_load_ps(hits.V))));
+#else
+                uint32_t mask = 0;
+                for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                    glm::vec3 direction(packet.DirectionX[lane], packet.DirectionY[lane], packet.DirectionZ[lane]);
+                    glm::vec3 p = glm::cross(direction, triangle.Edge2);
+                    float inverse = 1.0f / glm::dot(triangle.Edge1, p);
+                    glm::vec3 toOrigin = glm::vec3(packet.OriginX[lane], packet.OriginY[lane], packet.OriginZ[lane]) - triangle.Corner;
+                    float u = glm::dot(toOrigin, p) * inverse;
+                    glm::vec3 q = glm::cross(toOrigin, triangle.Edge1);
+                    float v = glm::dot(direction, q) * inverse;
+                    float distance = glm::dot(triangle.Edge2, q) * inverse;
+                    if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < packet.MaxDistance[lane]) {
+                        packet.MaxDistance[lane] = distance;
+                        hits.U[lane] = u;
+                        hits.V[lane] = v;
+                        mask |= 1u << lane;
+                    }
+                }
+                if (mask == 0) {
+                    continue;
+                }
+#endif
+                for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                    if (mask & (1u << lane)) {
+                        hits.Triangle[lane] = triangle.Index;
+                        hits.Object[lane] = object;
+                        if (anyHit) {
+                            packet.MaxDistance[lane] = -1.0f;  // Settled; fail every later test
+                        }
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is searched first and shortens the rays sooner
+        StackEntry left{ {}, node.First };
+        StackEntry right{ {}, node.First + 1 };
+        uint32_t leftMask = intersectBox(packet, _nodes[left.Node].Min, _nodes[left.Node].Max, left.Entry);
+        uint32_t rightMask = intersectBox(packet, _nodes[right.Node].Min, _nodes[right.Node].Max, right.Entry);
+        if (leftMask && rightMask) {
+            bool leftFirst = firstEntry(left.Entry, leftMask | rightMask) <= firstEntry(right.Entry, leftMask | rightMask);
+            stack[size++] = leftFirst ? right : left;
+            stack[size++] = leftFirst ? left : right;
+        } else if (leftMask) {
+            stack[size++] = left;
+        } else if (rightMask) {
+            stack[size++] = right;
+        }
+    }
+}
+
+void Raycaster::Build(const std::vector<Mesh>& meshes, uint32_t threadCount)
+{
+    _objects.clear();
+    _objects.resize(meshes.size());
+    Parallel::For(meshes.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            // Level 0 is the full-detail surface; coarser levels only exist for drawing
+            _objects[i].Triangles.Build(meshes[i].GetVertices(), meshes[i].GetIndices());
+            _objects[i].LocalBounds = _objects[i].Triangles.GetBounds();
+        }
+    }, threadCount);
+
+    std::vector<BoundingBox> bounds(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        _objects[i].Transform = meshes[i].Transform;
+        _objects[i].InverseTransform = glm::inverse(meshes[i].Transform);
+        bounds[i] = _objects[i].LocalBounds.Transformed(meshes[i].Transform);
+    }
+    _topLevel.Build(bounds);
+}
+
+void Raycaster::UpdateTransforms(const std::vector<Mesh>& meshes)
+{
+    // Same policy as the scene hierarchy: refit the moved objects' paths, rebuild once the tree has loosened too far
+    bool moved = false;
+    for (uint32_t i = 0; i < _objects.size() && i < meshes.size(); i++) {
+        Object& object = _objects[i];
+        if (meshes[i].Transform == object.Transform) {
+            continue;
+        }
+        object.Transform = meshes[i].Transform;
+        object.InverseTransform = glm::inverse(object.Transform);
+        moved |= _topLevel.Update(i, object.LocalBounds.Transformed(object.Transform));
+    }
+    if (moved && _topLevel.NeedsRebuild()) {
+        _topLevel.Rebuild();
+    }
+}
+
+void Raycaster::trace(RayPacket& packet, RayPacketHit& hits, bool anyHit) const
+{
+    auto nodes = _topLevel.GetNodes();
+    if (nodes.empty()) {
+        return;
+    }
+    auto order = _topLevel.GetObjectOrder();
+
+    std::array<StackEntry, StackSize> stack;
+    uint32_t size = 0;
+    stack[size].Node = 0;
+    if (intersectBox(packet, nodes[0].Min, nodes[0].Max, stack[size].Entry) == 0) {
+        return;
+    }
+    size++;
+
+    alignas(16) float entry[RayPacket::Width];
+    while (size > 0) {
+        StackEntry top = stack[--size];
+        if (stillReachable(packet, top.Entry) == 0) {
+            continue;
+        }
+        const BvhNode& node = nodes[top.Node];
+
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+                uint32_t objectIndex = order[i];
+                const BoundingBox& box = _topLevel.GetBounds(objectIndex);
+                uint32_t mask = intersectBox(packet, box.Min, box.Max, entry);
+                if (mask == 0) {
+                    continue;
+                }
+
+                // Direction is transformed without normalizing, so distances along the ray are the same in both spaces
+                const Object& object = _objects[objectIndex];
+                RayPacket local;
+                for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                    if (!(mask & (1u << lane))) {
+                        local.Clear(lane);
+                        continue;
+                    }
+                    glm::vec3 origin(packet.OriginX[lane], packet.OriginY[lane], packet.OriginZ[lane]);
+                    glm::vec3 direction(packet.DirectionX[lane], packet.DirectionY[lane], packet.DirectionZ[lane]);
+                    local.Set(lane, Ray{ glm::vec3(object.InverseTransform * glm::vec4(origin, 1.0f)),
+                                         glm::vec3(object.InverseTransform * glm::vec4(direction, 0.0f)), packet.MaxDistance[lane] });
+                }
+                object.Triangles.Intersect(local, hits, objectIndex, anyHit);
+                for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                    if (mask & (1u << lane)) {
+                        packet.MaxDistance[lane] = local.MaxDistance[lane];
+                    }
+                }
+            }
+            continue;
+        }
+
+        StackEntry left{ {}, node.First };
+        StackEntry right{ {}, node.First + 1 };
+        uint32_t leftMask = intersectBox(packet, nodes[left.Node].Min, nodes[left.Node].Max, left.Entry);
+        uint32_t rightMask = intersectBox(packet, nodes[right.Node].Min, nodes[right.Node].Max, right.Entry);
+        if (leftMask && rightMask) {
+            bool leftFirst = firstEntry(left.Entry, leftMask | rightMask) <= firstEntry(right.Entry, leftMask | rightMask);
+            stack[size++] = leftFirst ? right : left;
+            stack[size++] = leftFirst ? left : right;
+        } else if (leftMask) {
+            stack[size++] = left;
+        } else if (rightMask) {
+            stack[size++] = right;
+        }
+    }
+}
+
+RayHit Raycaster::Raycast(const Ray& ray) const
+{
+    RayHit hit;
+    RaycastBatch({ &ray, 1 }, { &hit, 1 }, 1);
+    return hit;
+}
+
+bool Raycaster::HasLineOfSight(glm::vec3 from, glm::vec3 to) const
+{
+    RayPacket packet;
+    packet.Set(0, Ray{ from, to - from, 1.0f });
+    for (uint32_t lane = 1; lane < RayPacket::Width; lane++) {
+        packet.Clear(lane);
+    }
+    RayPacketHit hits;
+    std::fill(std::begin(hits.Object), std::end(hits.Object), RayHit::None);
+    trace(packet, hits, true);
+    return hits.Object[0] == RayHit::None;
+}
+
+void Raycaster::RaycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, uint32_t threadCount) const
+{
+    size_t packetCount = (rays.size() + RayPacket::Width - 1) / RayPacket::Width;
+    // Packets are cheap enough that a thread per handful of them costs more to start than it saves
+    constexpr size_t PacketsPerThread = 64;
+    threadCount = static_cast<uint32_t>(std::min<size_t>(Parallel::GetThreadCount(threadCount),
+                                                         std::max<size_t>(packetCount / PacketsPerThread, 1)));
+
+    Parallel::For(packetCount, [&](size_t begin, size_t end) {
+        RayPacket packet;
+        RayPacketHit packetHits;
+        for (size_t p = begin; p < end; p++) {
+            size_t first = p * RayPacket::Width;
+            auto lanes = static_cast<uint32_t>(std::min<size_t>(RayPacket::Width, rays.size() - first));
+            for (uint32_t lane = 0; lane < RayPacket::Width; lane++) {
+                if (lane < lanes) {
+                    packet.Set(lane, rays[first + lane]);
+                } else {
+                    packet.Clear(lane);
+                }
+                packetHits.Object[lane] = RayHit::None;
+            }
+
+            trace(packet, packetHits, false);
+
+            for (uint32_t lane = 0; lane < lanes; lane++) {
+                RayHit& hit = hits[first + lane];
+                hit = RayHit{};
+                if (packetHits.Object[lane] != RayHit::None) {
+                    hit.Object = packetHits.Object[lane];
+                    hit.Triangle = packetHits.Triangle[lane];
+                    hit.Distance = packet.MaxDistance[lane];
+                    hit.Barycentric = { packetHits.U[lane], packetHits.V[lane] };
+                }
+            }
+        }
+    }, threadCount);
+}
@@ -0,0 +1,193 @@
+#include "renderqueue.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include "glstate.h"
+
+namespace {
+    constexpr uint32_t RadixBits = 8;  // Key bits sorted per pass
+    constexpr uint32_t RadixBuckets = 1u << RadixBits;
+    constexpr uint32_t RadixPasses = 64 / RadixBits;
+
+    constexpr uint32_t fieldMax(uint32_t bits)
+    {
+        return static_cast<uint32_t>((uint64_t{ 1 } << bits) - 1);
+    }
+
+    uint64_t field(uint32_t value, uint32_t bits)
+    {
+        return std::min(value, fieldMax(bits));
+    }
+
+    uint32_t fieldOf(uint64_t key, uint32_t shift, uint32_t bits)
+    {
+        return static_cast<uint32_t>((key >> shift) & fieldMax(bits));
+    }
+
+    constexpr uint32_t VertexArrayShift = RenderQueue::DepthBits;
+    constexpr uint32_t TextureSetShift = VertexArrayShift + RenderQueue::VertexArrayBits;
+    constexpr uint32_t ProgramShift = TextureSetShift + RenderQueue::TextureSetBits;
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t program, uint32_t textureSet, uint32_t vertexArray, float depth)
+{
+    auto quantized = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>((1u << DepthBits) - 1));
+    uint64_t key = field(pass, PassBits);
+    key = (key << ProgramBits) | field(program, ProgramBits);
+    key = (key << TextureSetBits) | field(textureSet, TextureSetBits);
+    key = (key << VertexArrayBits) | field(vertexArray, VertexArrayBits);
+    key = (key << DepthBits) | field(quantized, DepthBits);
+    return key;
+}
+
+template <typename T>
+uint32_t RenderQueue::idOf(std::vector<T>& table, const T& value)
+{
+    auto found = std::find(table.begin(), table.end(), value);
+    if (found != table.end()) {
+        return static_cast<uint32_t>(found - table.begin());
+    }
+    table.push_back(value);
+    return static_cast<uint32_t>(table.size() - 1);
+}
+
+void RenderQueue::Begin(const glm::mat4& viewProjection)
+{
+    _viewProjection = viewProjection;
+    _items.clear();
+    _programs.clear();
+    _textureSets.clear();
+    _textureHandles.clear();
+    _vertexArrays.clear();
+    _overflows = 0;
+}
+
+void RenderQueue::Add(Shader& shader, const Mesh& mesh, uint32_t meshIndex, uint32_t pass)
+{
+    glm::vec4 clip = _viewProjection * glm::vec4(mesh.GetWorldBounds().GetCenter(), 1.0f);
+    float depth = clip.w > 0.0f ? clip.z / clip.w * 0.5f + 0.5f : 0.0f;
+    uint32_t program = idOf(_programs, &shader);
+    uint32_t vertexArray = idOf(_vertexArrays, mesh.GetVertexArray());
+
+    std::vector<GLuint> handles;
+    auto subMeshes = mesh.GetSubMeshes();
+    for (uint32_t s = 0; s < subMeshes.size(); s++) {
+        // Texture sets are compared by their GL names, so equal sets held by different meshes share an id
+        const TextureSet& textures = mesh.GetMaterial(subMeshes[s].Material);
+        handles.clear();
+        for (const auto& texture : textures) {
+            handles.push_back(texture->GetHandle());
+        }
+        uint32_t textureSet = idOf(_textureHandles, handles);
+        if (textureSet == _textureSets.size()) {
+            _textureSets.push_back(&textures);
+        }
+        if (program > fieldMax(ProgramBits) || textureSet > fieldMax(TextureSetBits) || vertexArray > fieldMax(VertexArrayBits)) {
+            _overflows++;
+            if (!_overflowReported) {
+                std::cerr << "RenderQueue: " << _programs.size() << " programs, " << _textureSets.size() << " texture sets and "
+                          << _vertexArrays.size() << " vertex arrays exceed the key's " << ProgramBits << ", " << TextureSetBits
+                          << " and " << VertexArrayBits << " bits; the extra draws are sorted less well" << std::endl;
+                _overflowReported = true;
+            }
+        }
+        _items.push_back({ MakeKey(pass, program, textureSet, vertexArray, depth), meshIndex, s, program, textureSet, vertexArray });
+    }
+}
+
+void RenderQueue::Add(uint64_t key, uint32_t meshIndex, uint32_t subMesh)
+{
+    _items.push_back({ key, meshIndex, subMesh, fieldOf(key, ProgramShift, ProgramBits), fieldOf(key, TextureSetShift, TextureSetBits),
+                       fieldOf(key, VertexArrayShift, VertexArrayBits) });
+}
+
+void RenderQueue::Sort()
+{
+    if (_items.size() < 2) {
+        return;
+    }
+
+    // One histogram pass over the keys fills every digit's counts
+    std::array<std::array<uint32_t, RadixBuckets>, RadixPasses> counts{};
+    for (const auto& item : _items) {
+        for (uint32_t pass = 0; pass < RadixPasses; pass++) {
+            counts[pass][(item.Key >> (pass * RadixBits)) & (RadixBuckets - 1)]++;
+        }
+    }
+
+    // Stable scatter per digit, least significant first; a digit every key shares leaves the order as it is
+    _scratch.resize(_items.size());
+    for (uint32_t pass = 0; pass < RadixPasses; pass++) {
+        auto& digitCounts = counts[pass];
+        if (std::find(digitCounts.begin(), digitCounts.end(), static_cast<uint32_t>(_items.size())) != digitCounts.end()) {
+            continue;
+        }
+
+        std::array<uint32_t, RadixBuckets> offsets;
+        uint32_t sum = 0;
+        for (uint32_t bucket = 0; bucket < RadixBuckets; bucket++) {
+            offsets[bucket] = sum;
+            sum += digitCounts[bucket];
+        }
+        for (const auto& item : _items) {
+            _scratch[offsets[(item.Key >> (pass * RadixBits)) & (RadixBuckets - 1)]++] = item;
+        }
+        _items.swap(_scratch);
+    }
+}
+
+StateChanges RenderQueue::Submit(const std::vector<Mesh>& meshes)
+{
+    StateChanges changes;
+    Shader* boundProgram = nullptr;
+    uint32_t boundMesh = UINT32_MAX;  // Mesh whose object index the bound program holds
+    uint32_t samplersSet = 0;  // Sampler uniforms the bound program already points at their units
+    GLuint boundVertexArray = 0;
+    std::vector<GLuint> boundTextures;  // Texture on each unit
+
+    for (const auto& item : _items) {
+        Shader* program = _programs[item.Program];
+        if (program != boundProgram) {
+            program->Bind();
+            boundProgram = program;
+            boundMesh = UINT32_MAX;
+            samplersSet = 0;
+            changes.Programs++;
+        }
+
+        const auto& handles = _textureHandles[item.TextureSet];
+        const TextureSet& textures = *_textureSets[item.TextureSet];
+        if (boundTextures.size() < handles.size()) {
+            boundTextures.resize(handles.size(), 0);
+        }
+        for (uint32_t unit = 0; unit < handles.size(); unit++) {
+            if (boundTextures[unit] != handles[unit]) {
+                textures[unit]->Bind(unit);
+                boundTextures[unit] = handles[unit];
+                changes.Textures++;
+            }
+        }
+        // Sampler uniforms are per program state, so each only needs setting once after a program change
+        for (; samplersSet < handles.size(); samplersSet++) {
+            program->SetInt(Shader::GetSamplerName(samplersSet), static_cast<int>(samplersSet));
+            changes.Uniforms++;
+        }
+
+        const Mesh& mesh = meshes[item.Mesh];
+        auto vertexArray = _vertexArrays[item.VertexArray];
+        if (vertexArray != boundVertexArray) {
+            GLState::BindVertexArray(vertexArray);
+            boundVertexArray = vertexArray;
+            changes.VertexArrays++;
+        }
+
+        if (item.Mesh != boundMesh) {
+            program->SetInt("objectIndex", static_cast<int>(item.Mesh));
+            boundMesh = item.Mesh;
+            changes.Uniforms++;
+        }
+
+        mesh.SubmitSubMesh(item.SubMesh);
+    }
+    return changes;
+}
@@ -0,0 +1,102 @@
+#include "ring.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RING_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef RING_USE_SSE2
+namespace {
+    // Cephes-style sincos: reduce to an octant with a three-part pi/4, then evaluate both minimax polynomials
+    // and pick per lane; accurate to a couple of ulps over the [0, 2pi] range the generators use
+    void sinCos4(__m128 x, __m128& sine, __m128& cosine)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+        __m128 sinSign = _mm_and_ps(x, signMask);
+        x = _mm_andnot_ps(signMask, x);
+
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(static_cast<float>(4.0 / M_PI))));
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(octant);
+
+        __m128 sinSwap = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+        __m128 useSinPolynomial = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+        sinSign = _mm_xor_ps(sinSign, sinSwap);
+
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 cosPolynomial = _mm_set1_ps(2.443315711809948e-5f);
+        cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(-1.388731625493765e-3f));
+        cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(4.166664568298827e-2f));
+        cosPolynomial = _mm_mul_ps(_mm_mul_ps(cosPolynomial, z), z);
+        cosPolynomial = _mm_sub_ps(cosPolynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        cosPolynomial = _mm_add_ps(cosPolynomial, _mm_set1_ps(1.0f));
+
+        __m128 sinPolynomial = _mm_set1_ps(-1.9515295891e-4f);
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(8.3321608736e-3f));
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(-1.6666654611e-1f));
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPolynomial, z), x), x);
+
+        __m128 sinResult = _mm_or_ps(_mm_and_ps(useSinPolynomial, sinPolynomial), _mm_andnot_ps(useSinPolynomial, cosPolynomial));
+        __m128 cosResult = _mm_or_ps(_mm_and_ps(useSinPolynomial, cosPolynomial), _mm_andnot_ps(useSinPolynomial, sinPolynomial));
+        sine = _mm_xor_ps(sinResult, sinSign);
+        cosine = _mm_xor_ps(cosResult, cosSign);
+    }
+}
+#endif
+
+void Ring::SinCos(int sectors, float* cosines, float* sines)
+{
+#ifdef RING_USE_SSE2
+    const float sectorStep = static_cast<float>(2.0 * M_PI / sectors);
+    const int count = sectors + 1;
+    const __m128 step = _mm_set1_ps(sectorStep);
+    __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 sine;
+        __m128 cosine;
+        sinCos4(_mm_mul_ps(index, step), sine, cosine);
+        _mm_storeu_ps(cosines + i, cosine);
+        _mm_storeu_ps(sines + i, sine);
+        index = _mm_add_ps(index, _mm_set1_ps(4.0f));
+    }
+
+    // Remaining samples go through a full vector and are copied out lane by lane
+    if (i < count) {
+        alignas(16) float cosineLanes[4];
+        alignas(16) float sineLanes[4];
+        __m128 sine;
+        __m128 cosine;
+        sinCos4(_mm_mul_ps(index, step), sine, cosine);
+        _mm_store_ps(cosineLanes, cosine);
+        _mm_store_ps(sineLanes, sine);
+        for (int lane = 0; i < count; i++, lane++) {
+            cosines[i] = cosineLanes[lane];
+            sines[i] = sineLanes[lane];
+        }
+    }
+#else
+    SinCosScalar(sectors, cosines, sines);
+#endif
+}
+
+void Ring::SinCosScalar(int sectors, float* cosines, float* sines)
+{
+    const float sectorStep = static_cast<float>(2.0 * M_PI / sectors);
+    for (int i = 0; i <= sectors; i++) {
+        const float sectorAngle = i * sectorStep;
+        cosines[i] = std::cos(sectorAngle);
+        sines[i] = std::sin(sectorAngle);
+    }
+}
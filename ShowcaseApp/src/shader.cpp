@@ -4,8 +4,74 @@
 
 #include <iostream>
 #include <Shader.h>
+#include "glstate.h"
 #include <fstream>
+#include <sstream>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+    constexpr UniformName SamplerNames[] = { "tex0", "tex1", "tex2", "tex3", "tex4", "tex5", "tex6", "tex7" };
+    static_assert(std::size(SamplerNames) == Shader::MaxTextureSamplers);
+
+    // Value type uploads to a uniform of this type take: int for bools, samplers and images, 0 if there is no upload path
+    GLenum canonicalType(GLenum uniformType)
+    {
+        switch (uniformType) {
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_IMAGE_2D:
+            return GL_INT;
+        case GL_INT_VEC2: case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4: case GL_FLOAT_MAT4:
+            return uniformType;
+        default:
+            return 0;
+        }
+    }
+
+    size_t valueBytes(GLenum valueType)
+    {
+        switch (valueType) {
+        case GL_INT: case GL_FLOAT: return 4;
+        case GL_INT_VEC2: case GL_FLOAT_VEC2: return 8;
+        case GL_FLOAT_VEC3: return 12;
+        case GL_FLOAT_VEC4: return 16;
+        case GL_FLOAT_MAT4: return 64;
+        default: return 0;
+        }
+    }
+
+    // Replace each #include "file" line with the file, resolved against the including file's directory
+    std::string expandIncludes(const std::string& source, const Path& directory, int depth = 0)
+    {
+        constexpr int MaxDepth = 8;
+        std::istringstream lines(source);
+        std::string expanded;
+        std::string line;
+        while (std::getline(lines, line)) {
+            auto open = line.find('"');
+            auto close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (!line.starts_with("#include") || close == std::string::npos) {
+                expanded += line;
+                expanded += '\n';
+                continue;
+            }
+
+            Path included = directory / line.substr(open + 1, close - open - 1);
+            std::ifstream file(included);
+            if (!file || depth >= MaxDepth) {
+                std::cerr << "ERROR::SHADER::INCLUDE_NOT_READ " << included.string() << std::endl;
+                continue;
+            }
+            std::stringstream contents;
+            contents << file.rdbuf();
+            expanded += expandIncludes(contents.str(), included.parent_path(), depth + 1);
+        }
+        return expanded;
+    }
+}
 
 Shader::Shader(const std::string& vertexSource, const std::string& fragmentSource) {
     load(vertexSource, fragmentSource);
@@ -31,14 +97,55 @@ Shader::Shader(const Path& vertexPath, const Path& fragmentPath) {
         fShaderFile.close();
 
         // Load shaders from string streams
-        load(vShaderStream.str(), fShaderStream.str());
+        load(expandIncludes(vShaderStream.str(), vertexPath.parent_path()),
+             expandIncludes(fShaderStream.str(), fragmentPath.parent_path()));
     } catch (std::ifstream::failure& e) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
     }
 }
 
+Shader::Shader(const Path& computePath) {
+    std::ifstream computeFile(computePath);
+    if (!computeFile) {
+        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << computePath.string() << std::endl;
+        return;
+    }
+    std::stringstream computeStream;
+    computeStream << computeFile.rdbuf();
+    loadCompute(expandIncludes(computeStream.str(), computePath.parent_path()));
+}
+
+Shader::~Shader() {
+    if (_shaderProgram) {
+        GLState::DeleteProgram(_shaderProgram);
+    }
+}
+
+Shader::Shader(Shader&& other) noexcept
+        : _shaderProgram(std::exchange(other._shaderProgram, 0)), _uniforms(std::move(other._uniforms)),
+          _uniformIndex(std::move(other._uniformIndex)), _values(std::move(other._values)),
+          _uniformBlocks(std::move(other._uniformBlocks)), _storageBlocks(std::move(other._storageBlocks)),
+          _attributes(std::move(other._attributes)) {
+}
+
+Shader& Shader::operator=(Shader&& other) noexcept {
+    if (this != &other) {
+        if (_shaderProgram) {
+            GLState::DeleteProgram(_shaderProgram);
+        }
+        _shaderProgram = std::exchange(other._shaderProgram, 0);
+        _uniforms = std::move(other._uniforms);
+        _uniformIndex = std::move(other._uniformIndex);
+        _values = std::move(other._values);
+        _uniformBlocks = std::move(other._uniformBlocks);
+        _storageBlocks = std::move(other._storageBlocks);
+        _attributes = std::move(other._attributes);
+    }
+    return *this;
+}
+
 void Shader::Bind() {
-    glUseProgram(_shaderProgram);
+    GLState::UseProgram(_shaderProgram);
 }
 
 void Shader::load(const std::string& vertexSource, const std::string& fragmentSource) {
@@ -81,6 +188,8 @@ void Shader::load(const std::string& vertexSource, const std::string& fragmentSo
     if (!success) {
         glGetShaderInfoLog(_shaderProgram, 512, nullptr, infoLog);
         std::cerr << "ERROR::SHADER::FRAGMENT::LINK_FAIL" << infoLog << std::endl;
+    } else {
+        reflect();
     }
 
     // Delete shader objects as they are linked to the shader program
@@ -88,20 +197,184 @@ void Shader::load(const std::string& vertexSource, const std::string& fragmentSo
     glDeleteShader(fragmentShader);
 }
 
-GLint Shader::getUniformLocation(const std::string& uniformName) {
-    return glGetUniformLocation(_shaderProgram, uniformName.c_str());
+void Shader::loadCompute(const std::string& computeSource) {
+    const char* cShaderCode = computeSource.c_str();
+
+    auto computeShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShader, 1, &cShaderCode, nullptr);
+    glCompileShader(computeShader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(computeShader, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED" << infoLog << std::endl;
+    }
+
+    _shaderProgram = glCreateProgram();
+    glAttachShader(_shaderProgram, computeShader);
+    glLinkProgram(_shaderProgram);
+
+    glGetProgramiv(_shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(_shaderProgram, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::COMPUTE::LINK_FAIL" << infoLog << std::endl;
+    } else {
+        reflect();
+    }
+
+    glDeleteShader(computeShader);
 }
 
-void Shader::SetMat4(const std::string& uniformName, const glm::mat4& mat4) {
-    auto uniformLoc = getUniformLocation(uniformName);
-    if (uniformLoc != -1) {
-        glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(mat4));
+void Shader::reflect() {
+    GLint nameLength = 0;
+    glGetProgramInterfaceiv(_shaderProgram, GL_UNIFORM, GL_MAX_NAME_LENGTH, &nameLength);
+    std::string name(std::max(nameLength, 1), '\0');
+    GLint count = 0;
+    glGetProgramInterfaceiv(_shaderProgram, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    const GLenum uniformProperties[] = { GL_BLOCK_INDEX, GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[4];
+        glGetProgramResourceiv(_shaderProgram, GL_UNIFORM, i, 4, uniformProperties, 4, nullptr, values);
+        if (values[0] != -1) {
+            continue;  // Block members are set through their buffer
+        }
+        GLsizei length = 0;
+        glGetProgramResourceName(_shaderProgram, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), &length, name.data());
+        std::string uniformName(name.data(), length);
+        if (uniformName.ends_with("[0]")) {
+            uniformName.resize(uniformName.size() - 3);
+        }
+
+        UniformInfo info{ uniformName, UniformName::Hash(uniformName), values[1], static_cast<GLenum>(values[2]), values[3],
+                          static_cast<uint32_t>(_values.size()), false };
+        _values.resize(_values.size() + valueBytes(canonicalType(info.Type)) * info.Size);
+        if (!_uniformIndex.emplace(info.Hash, static_cast<uint32_t>(_uniforms.size())).second) {
+            std::cerr << "WARNING::SHADER::UNIFORM_HASH_COLLISION " << uniformName << std::endl;
+        }
+        _uniforms.push_back(std::move(info));
+    }
+
+    // Uniform and storage blocks report the same properties
+    const GLenum blockProperties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+    auto reflectBlocks = [&](GLenum interface, std::vector<BlockInfo>& blocks) {
+        GLint blockNameLength = 0;
+        glGetProgramInterfaceiv(_shaderProgram, interface, GL_MAX_NAME_LENGTH, &blockNameLength);
+        std::string blockName(std::max(blockNameLength, 1), '\0');
+        GLint blockCount = 0;
+        glGetProgramInterfaceiv(_shaderProgram, interface, GL_ACTIVE_RESOURCES, &blockCount);
+        for (GLint i = 0; i < blockCount; i++) {
+            GLint values[2];
+            glGetProgramResourceiv(_shaderProgram, interface, i, 2, blockProperties, 2, nullptr, values);
+            GLsizei length = 0;
+            glGetProgramResourceName(_shaderProgram, interface, i, static_cast<GLsizei>(blockName.size()), &length, blockName.data());
+            blocks.push_back({ std::string(blockName.data(), length), values[0], values[1] });
+        }
+    };
+    reflectBlocks(GL_UNIFORM_BLOCK, _uniformBlocks);
+    reflectBlocks(GL_SHADER_STORAGE_BLOCK, _storageBlocks);
+
+    glGetProgramInterfaceiv(_shaderProgram, GL_PROGRAM_INPUT, GL_MAX_NAME_LENGTH, &nameLength);
+    name.assign(std::max(nameLength, 1), '\0');
+    glGetProgramInterfaceiv(_shaderProgram, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &count);
+    const GLenum attributeProperties[] = { GL_LOCATION, GL_TYPE };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[2];
+        glGetProgramResourceiv(_shaderProgram, GL_PROGRAM_INPUT, i, 2, attributeProperties, 2, nullptr, values);
+        GLsizei length = 0;
+        glGetProgramResourceName(_shaderProgram, GL_PROGRAM_INPUT, i, static_cast<GLsizei>(name.size()), &length, name.data());
+        std::string attributeName(name.data(), length);
+        if (!attributeName.starts_with("gl_")) {
+            _attributes.push_back({ std::move(attributeName), values[0], static_cast<GLenum>(values[1]) });
+        }
     }
 }
 
-void Shader::SetInt(const std::string &uniformName, int value) {
-    auto uniformLoc = getUniformLocation(uniformName);
-    if (uniformLoc != -1) {
-        glUniform1i(uniformLoc, value);
+int32_t Shader::findUniform(UniformName name) const {
+    auto found = _uniformIndex.find(name.GetHash());
+    if (found == _uniformIndex.end()) {
+        return -1;
+    }
+    if (_uniforms[found->second].Name == name.GetName()) {
+        return static_cast<int32_t>(found->second);
     }
+    // Only the first of two colliding names is in the table
+    for (size_t i = 0; i < _uniforms.size(); i++) {
+        if (_uniforms[i].Name == name.GetName()) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+bool Shader::accepts(GLenum uniformType, GLenum valueType) {
+    return valueType != 0 && canonicalType(uniformType) == valueType;
+}
+
+void Shader::upload(int32_t index, GLenum valueType, const void* values, GLint count) {
+    if (index < 0) {
+        return;
+    }
+    auto& uniform = _uniforms[index];
+    if (!accepts(uniform.Type, valueType)) {
+        return;
+    }
+    count = std::min(count, uniform.Size);
+    size_t bytes = valueBytes(valueType) * count;
+    std::byte* cached = _values.data() + uniform.ValueOffset;
+    if (uniform.ValueKnown && std::memcmp(cached, values, bytes) == 0) {
+        return;
+    }
+    std::memcpy(cached, values, bytes);
+    uniform.ValueKnown = count == uniform.Size;  // Otherwise the rest of the array is still unknown
+
+    auto* floats = static_cast<const GLfloat*>(values);
+    auto* ints = static_cast<const GLint*>(values);
+    switch (valueType) {
+    case GL_INT: glUniform1iv(uniform.Location, count, ints); break;
+    case GL_INT_VEC2: glUniform2iv(uniform.Location, count, ints); break;
+    case GL_FLOAT: glUniform1fv(uniform.Location, count, floats); break;
+    case GL_FLOAT_VEC2: glUniform2fv(uniform.Location, count, floats); break;
+    case GL_FLOAT_VEC3: glUniform3fv(uniform.Location, count, floats); break;
+    case GL_FLOAT_VEC4: glUniform4fv(uniform.Location, count, floats); break;
+    case GL_FLOAT_MAT4: glUniformMatrix4fv(uniform.Location, count, GL_FALSE, floats); break;
+    default: break;
+    }
+}
+
+void Shader::SetMat4(UniformName uniformName, const glm::mat4& mat4) {
+    upload(findUniform(uniformName), GL_FLOAT_MAT4, glm::value_ptr(mat4), 1);
+}
+
+void Shader::SetFloat(UniformName uniformName, float value) {
+    upload(findUniform(uniformName), GL_FLOAT, &value, 1);
+}
+
+void Shader::SetVec2(UniformName uniformName, const glm::vec2& vec2) {
+    upload(findUniform(uniformName), GL_FLOAT_VEC2, glm::value_ptr(vec2), 1);
+}
+
+void Shader::SetIVec2(UniformName uniformName, const glm::ivec2& ivec2) {
+    upload(findUniform(uniformName), GL_INT_VEC2, glm::value_ptr(ivec2), 1);
+}
+
+void Shader::SetVec3(UniformName uniformName, const glm::vec3& vec3) {
+    upload(findUniform(uniformName), GL_FLOAT_VEC3, glm::value_ptr(vec3), 1);
+}
+
+void Shader::SetVec4(UniformName uniformName, const glm::vec4& vec4) {
+    upload(findUniform(uniformName), GL_FLOAT_VEC4, glm::value_ptr(vec4), 1);
+}
+
+void Shader::SetVec4Array(UniformName uniformName, std::span<const glm::vec4> values) {
+    upload(findUniform(uniformName), GL_FLOAT_VEC4, values.data(), static_cast<GLint>(values.size()));
+}
+
+void Shader::SetInt(UniformName uniformName, int value) {
+    upload(findUniform(uniformName), GL_INT, &value, 1);
+}
+
+UniformName Shader::GetSamplerName(uint32_t unit) {
+    return unit < MaxTextureSamplers ? SamplerNames[unit] : UniformName(std::string_view());
 }
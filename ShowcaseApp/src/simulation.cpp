@@ -0,0 +1,185 @@
+#include "simulation.h"
+#include <chrono>
+
+Simulation::Simulation(const Camera& camera)
+        : _camera(camera)
+{
+}
+
+Simulation::~Simulation()
+{
+    Stop();
+}
+
+void Simulation::Start(std::span<const Mesh> meshes)
+{
+    Stop();
+
+    _transforms.clear();
+    _bounds.clear();
+    for (const auto& mesh : meshes) {
+        _transforms.push_back(mesh.Transform);
+        _bounds.push_back(mesh.GetBounds());
+    }
+    _sceneBvh = Bvh();
+
+    // The render thread can draw as soon as this returns, before the thread has run a step
+    step(0.f, static_cast<float>(glfwGetTime()));
+
+    _running.store(true, std::memory_order_release);
+    _thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::Stop()
+{
+    _running.store(false, std::memory_order_release);
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool Simulation::PushInput(const InputEvent& event)
+{
+    return _inputs.TryPush(event);
+}
+
+void Simulation::run()
+{
+    // glfwGetTime is one of the few GLFW calls allowed off the main thread
+    auto next = std::chrono::steady_clock::now();
+    float lastTime = static_cast<float>(glfwGetTime());
+    while (_running.load(std::memory_order_acquire)) {
+        float time = static_cast<float>(glfwGetTime());
+        step(time - lastTime, time);
+        lastTime = time;
+
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(StepSeconds));
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) {
+            next = now;  // Fell behind; do not try to catch up with a burst of steps
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Simulation::step(float deltaTime, float time)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    InputEvent event;
+    while (_inputs.TryPop(event)) {
+        handleEvent(event);
+    }
+
+    auto moveAmount = _camera.GetSpeed() * deltaTime * 4;
+    if (_keysDown[GLFW_KEY_W]) {
+        _camera.MoveCamera(Camera::MoveDirection::Forward, moveAmount);
+    }
+    if (_keysDown[GLFW_KEY_A]) {
+        _camera.MoveCamera(Camera::MoveDirection::Left, moveAmount);
+    }
+    if (_keysDown[GLFW_KEY_S]) {
+        _camera.MoveCamera(Camera::MoveDirection::Backward, moveAmount);
+    }
+    if (_keysDown[GLFW_KEY_D]) {
+        _camera.MoveCamera(Camera::MoveDirection::Right, moveAmount);
+    }
+    if (_keysDown[GLFW_KEY_Q]) {
+        _camera.MoveCamera(Camera::MoveDirection::Up, moveAmount);
+    }
+    if (_keysDown[GLFW_KEY_E]) {
+        _camera.MoveCamera(Camera::MoveDirection::Down, moveAmount);
+    }
+
+    // Whole subtrees outside the frustum are skipped in one test; the render thread refines this with occlusion
+    updateSceneBvh();
+    _visibleCount = _sceneBvh.Cull(_camera.GetFrustum(), _visible);
+
+    publish(time, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void Simulation::handleEvent(const InputEvent& event)
+{
+    switch (event.EventType) {
+        case InputEvent::Type::Key: {
+            if (event.Button >= 0 && event.Button <= GLFW_KEY_LAST) {
+                _keysDown[event.Button] = event.Action != GLFW_RELEASE;
+            }
+            if (event.Button == GLFW_KEY_F11 && event.Action == GLFW_PRESS) {
+                _camera.SetIsPerspective(!_camera.IsPerspective());
+            }
+            break;
+        }
+        case InputEvent::Type::CursorMove: {
+            if (!_firstMouse) {
+                _lastMousePosition = glm::vec2(event.Value);
+                _firstMouse = true;
+            }
+
+            glm::vec2 moveAmount {
+                    event.Value.x - _lastMousePosition.x,
+                    _lastMousePosition.y - event.Value.y
+            };
+            _lastMousePosition = glm::vec2(event.Value);
+
+            _camera.RotateBy(moveAmount.x * _camera.GetSpeed(), moveAmount.y * _camera.GetSpeed());
+            break;
+        }
+        case InputEvent::Type::MouseButton: {
+            // Picking needs the render thread's triangles, so only the ray is worked out here
+            if (event.Button == GLFW_MOUSE_BUTTON_LEFT && event.Action == GLFW_PRESS) {
+                _pickRay = _camera.GetRay(glm::vec2(event.Value));
+                _pickCount++;
+            }
+            break;
+        }
+        case InputEvent::Type::Scroll: {
+            _camera.IncrementSpeed(static_cast<float>(event.Value.y * .2));
+            break;
+        }
+        case InputEvent::Type::Resize: {
+            _camera.SetSize(static_cast<int>(event.Value.x), static_cast<int>(event.Value.y));
+            break;
+        }
+    }
+}
+
+void Simulation::updateSceneBvh()
+{
+    if (_sceneBvh.GetObjectCount() != _transforms.size()) {
+        std::vector<BoundingBox> bounds;
+        bounds.reserve(_transforms.size());
+        for (size_t i = 0; i < _transforms.size(); i++) {
+            bounds.push_back(_bounds[i].Transformed(_transforms[i]));
+        }
+        _sceneBvh.Build(bounds);
+        return;
+    }
+
+    // Objects whose transform changed refit their path to the root; rebuild once that has loosened the tree too far
+    bool moved = false;
+    for (uint32_t i = 0; i < _transforms.size(); i++) {
+        moved |= _sceneBvh.Update(i, _bounds[i].Transformed(_transforms[i]));
+    }
+    if (moved && _sceneBvh.NeedsRebuild()) {
+        _sceneBvh.Rebuild();
+    }
+}
+
+void Simulation::publish(float time, double updateMilliseconds)
+{
+    // The slot last held the snapshot from two publishes ago, so every field is written; the vectors keep their capacity
+    SceneSnapshot& snapshot = _snapshots.GetWriteBuffer();
+    snapshot.Tick = ++_tick;
+    snapshot.Time = time;
+    snapshot.UpdateMilliseconds = updateMilliseconds;
+    snapshot.View = _camera.GetViewMatrix();
+    snapshot.Projection = _camera.GetProjectionMatrix();
+    snapshot.CameraPosition = _camera.GetPosition();
+    snapshot.Transforms.assign(_transforms.begin(), _transforms.end());
+    snapshot.Visible.assign(_visible.begin(), _visible.end());
+    snapshot.VisibleCount = _visibleCount;
+    snapshot.PickCount = _pickCount;
+    snapshot.PickRay = _pickRay;
+    _snapshots.Publish();
+}
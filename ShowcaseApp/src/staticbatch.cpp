@@ -0,0 +1,154 @@
+#include "staticbatch.h"
+#include <algorithm>
+#include <iostream>
+
+bool StaticBatch::Build(std::vector<Mesh>& meshes, GeometryArena* arena)
+{
+    std::vector<uint32_t> statics;
+    for (uint32_t i = 0; i < meshes.size(); i++) {
+        if (meshes[i].Static) {
+            statics.push_back(i);
+        }
+    }
+    if (statics.size() < 2) {
+        return false;
+    }
+
+    // Sources that share a texture set share a batch material
+    std::vector<TextureSet> materials;
+    std::vector<std::vector<GLuint>> materialHandles;
+    std::vector<std::vector<uint32_t>> materialMap(statics.size());  // Source material to batch material
+    for (size_t s = 0; s < statics.size(); s++) {
+        const Mesh& mesh = meshes[statics[s]];
+        uint32_t sourceMaterials = 0;
+        for (uint32_t level = 0; level < mesh.GetLodCount(); level++) {
+            for (const auto& subMesh : mesh.GetLod(level).GetSubMeshes()) {
+                sourceMaterials = std::max(sourceMaterials, subMesh.Material + 1);
+            }
+        }
+
+        for (uint32_t m = 0; m < sourceMaterials; m++) {
+            std::vector<GLuint> handles;
+            for (const auto& texture : mesh.GetMaterial(m)) {
+                handles.push_back(texture->GetHandle());
+            }
+            auto found = std::find(materialHandles.begin(), materialHandles.end(), handles);
+            if (found == materialHandles.end()) {
+                materials.push_back(mesh.GetMaterial(m));
+                materialHandles.push_back(std::move(handles));
+                found = materialHandles.end() - 1;
+            }
+            materialMap[s].push_back(static_cast<uint32_t>(found - materialHandles.begin()));
+        }
+        _levelCount = std::max(_levelCount, mesh.GetLodCount());
+    }
+
+    _sources.assign(statics.size(), {});
+    for (size_t s = 0; s < statics.size(); s++) {
+        _sources[s].MeshIndex = statics[s];
+        _sources[s].Ranges.resize(_levelCount);
+    }
+
+    std::vector<Mesh> levels;
+    std::vector<float> levelErrors;
+    for (uint32_t level = 0; level < _levelCount; level++) {
+        // World-space vertices of every source at its matching level; a source with fewer levels repeats its coarsest
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> baseVertices(statics.size());
+        float geometricError = 0.0f;
+        for (size_t s = 0; s < statics.size(); s++) {
+            const Mesh& mesh = meshes[statics[s]];
+            uint32_t sourceLevel = std::min(level, mesh.GetLodCount() - 1);
+            const glm::mat4& transform = mesh.Transform;
+            glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+            float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                                     glm::length(glm::vec3(transform[2])) });
+            geometricError = std::max(geometricError, mesh.GetGeometricError(sourceLevel) * scale);
+
+            baseVertices[s] = static_cast<uint32_t>(vertices.size());
+            for (Vertex vertex : mesh.GetLod(sourceLevel).GetVertices()) {
+                vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+                if (glm::dot(vertex.Normal, vertex.Normal) > 0.0f) {
+                    vertex.Normal = glm::normalize(normalTransform * vertex.Normal);
+                }
+                vertices.push_back(vertex);
+            }
+        }
+
+        // Indices grouped by material, then by source, so every material is one contiguous run while all sources are visible
+        std::vector<uint32_t> indices;
+        for (uint32_t material = 0; material < materials.size(); material++) {
+            for (size_t s = 0; s < statics.size(); s++) {
+                const Mesh& mesh = meshes[statics[s]];
+                const Mesh& source = mesh.GetLod(std::min(level, mesh.GetLodCount() - 1));
+                auto sourceIndices = source.GetIndices();
+                for (const auto& subMesh : source.GetSubMeshes()) {
+                    if (materialMap[s][subMesh.Material] != material) {
+                        continue;
+                    }
+                    _sources[s].Ranges[level].push_back({ static_cast<uint32_t>(indices.size()), subMesh.IndexCount, material });
+                    for (uint32_t i = 0; i < subMesh.IndexCount; i++) {
+                        indices.push_back(baseVertices[s] + sourceIndices[subMesh.FirstIndex + i]);
+                    }
+                }
+            }
+        }
+
+        levels.emplace_back(std::move(vertices), std::move(indices), arena);
+        levelErrors.push_back(geometricError);
+    }
+
+    Mesh batch = std::move(levels.front());
+    batch.SetGeometricError(levelErrors.front());
+    for (uint32_t level = 1; level < _levelCount; level++) {
+        batch.AddLod(std::move(levels[level]), levelErrors[level]);
+    }
+    batch.SetMaterials(std::move(materials));
+    batch.Static = true;
+    batch.Occluder = std::any_of(statics.begin(), statics.end(), [&](uint32_t i) { return meshes[i].Occluder; });
+    updateSubMeshes(batch);
+
+    for (auto i = statics.rbegin(); i != statics.rend(); ++i) {
+        meshes.erase(meshes.begin() + *i);
+    }
+    meshes.push_back(std::move(batch));
+    _meshIndex = static_cast<uint32_t>(meshes.size() - 1);
+
+    std::cout << "Static batch: " << _sources.size() << " meshes baked into " << meshes.back().GetSubMeshes().size()
+              << " material ranges over " << _levelCount << " levels" << std::endl;
+    return true;
+}
+
+void StaticBatch::SetVisible(std::vector<Mesh>& meshes, uint32_t source, bool visible)
+{
+    if (_sources[source].Visible == visible) {
+        return;
+    }
+    _sources[source].Visible = visible;
+    updateSubMeshes(meshes[_meshIndex]);
+}
+
+void StaticBatch::updateSubMeshes(Mesh& batch) const
+{
+    for (uint32_t level = 0; level < _levelCount; level++) {
+        // Ranges are laid out by material and then source, so sorting by first index keeps materials together
+        std::vector<SubMesh> visible;
+        for (const auto& source : _sources) {
+            if (source.Visible) {
+                visible.insert(visible.end(), source.Ranges[level].begin(), source.Ranges[level].end());
+            }
+        }
+        std::sort(visible.begin(), visible.end(), [](const SubMesh& a, const SubMesh& b) { return a.FirstIndex < b.FirstIndex; });
+
+        std::vector<SubMesh> subMeshes;
+        for (const auto& range : visible) {
+            if (!subMeshes.empty() && subMeshes.back().Material == range.Material &&
+                subMeshes.back().FirstIndex + subMeshes.back().IndexCount == range.FirstIndex) {
+                subMeshes.back().IndexCount += range.IndexCount;
+            } else {
+                subMeshes.push_back(range);
+            }
+        }
+        batch.GetLod(level).SetSubMeshes(std::move(subMeshes));
+    }
+}
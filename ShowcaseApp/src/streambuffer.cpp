@@ -0,0 +1,95 @@
+#include "streambuffer.h"
+#include <chrono>
+#include <iostream>
+#include "glstate.h"
+
+StreamBuffer::StreamBuffer(GLsizeiptr segmentSize)
+{
+    GLint uniformAlignment = 0;
+    GLint storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    _uniformAlignment = std::max<GLsizeiptr>(uniformAlignment, 1);
+    _storageAlignment = std::max<GLsizeiptr>(storageAlignment, 1);
+
+    // Segments start on a multiple of the largest alignment, so an aligned offset within one is aligned in the buffer
+    GLsizeiptr granularity = std::max<GLsizeiptr>({ _uniformAlignment, _storageAlignment, 256 });
+    _segmentSize = (segmentSize + granularity - 1) / granularity * granularity;
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &_buffer);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, _segmentSize * SegmentCount, nullptr, flags);
+    _mapping = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, _segmentSize * SegmentCount, flags));
+    if (!_mapping) {
+        std::cerr << "Failed to persistently map a " << _segmentSize * SegmentCount << " byte stream buffer" << std::endl;
+    }
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (auto& fence : _fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (_mapping) {
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    GLState::DeleteBuffer(_buffer);
+}
+
+void StreamBuffer::BeginFrame()
+{
+    _segment = (_segment + 1) % SegmentCount;
+    _head = 0;
+    _stats.Frames++;
+
+    GLsync& fence = _fences[_segment];
+    if (!fence) {
+        return;
+    }
+    // Poll first so a segment the GPU is already done with costs no flush and counts as no stall
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        auto waitStart = std::chrono::steady_clock::now();
+        constexpr GLuint64 OneSecond = 1'000'000'000;
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do {
+            result = glClientWaitSync(fence, waitFlags, OneSecond);
+            waitFlags = 0;
+        } while (result == GL_TIMEOUT_EXPIRED);
+        _stats.Stalls++;
+        _stats.StallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "Waiting on a stream buffer fence failed" << std::endl;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::EndFrame()
+{
+    if (_fences[_segment]) {
+        glDeleteSync(_fences[_segment]);
+    }
+    _fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    // Aligned within the whole buffer, so a vertex stride that does not divide the segment size still works
+    GLintptr segmentStart = static_cast<GLintptr>(_segment) * _segmentSize;
+    GLintptr bufferOffset = (segmentStart + _head + alignment - 1) / alignment * alignment;
+    GLsizeiptr end = bufferOffset - segmentStart + size;
+    if (!_mapping || end > _segmentSize) {
+        _stats.Overflows++;
+        return {};
+    }
+
+    _stats.BytesAllocated += static_cast<uint64_t>(end - _head);
+    _head = end;
+    return { _mapping + bufferOffset, bufferOffset, size };
+}
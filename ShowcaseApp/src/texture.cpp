@@ -3,8 +3,10 @@
 //
 
 #include <texture.h>
+#include "glstate.h"
 #include <stb_image.h>
 #include <iostream>
+#include <utility>
 
 Texture::Texture(const std::filesystem::path &path) {
     stbi_set_flip_vertically_on_load(false);
@@ -14,23 +16,65 @@ Texture::Texture(const std::filesystem::path &path) {
     auto texturePath = path.string();
     int width, height, numChannels;
     unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &numChannels, STBI_rgb_alpha);
+    if (!data) {
+        std::cerr << "Failed to load texture at path: " << texturePath << std::endl;
+    }
+    upload(width, height, data);
+    stbi_image_free(data);
+
+}
+
+Texture::Texture(int width, int height, const unsigned char* pixels) {
+    upload(width, height, pixels);
+}
+
+void Texture::upload(int width, int height, const unsigned char* pixels) {
     glGenTextures(1, &_textureHandle);
-    glBindTexture(GL_TEXTURE_2D, _textureHandle);
+    GLState::BindTexture(0, _textureHandle);
 //    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 //    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 
-    if (data) {
+    if (pixels) {
         glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
         glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cerr << "Failed to load texture at path: " << texturePath << std::endl;
     }
-    stbi_image_free(data);
+}
+
+Texture::~Texture() {
+    if (_textureHandle) {
+        GLState::DeleteTexture(_textureHandle);
+    }
+}
+
+Texture::Texture(Texture&& other) noexcept
+        : _textureHandle(std::exchange(other._textureHandle, 0)) {
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept {
+    if (this != &other) {
+        if (_textureHandle) {
+            GLState::DeleteTexture(_textureHandle);
+        }
+        _textureHandle = std::exchange(other._textureHandle, 0);
+    }
+    return *this;
+}
+
+void Texture::Bind(uint32_t unit) {
+    GLState::BindTexture(unit, _textureHandle);
+}
 
+Image Image::Decode(std::span<const std::byte> encoded) {
+    // stbi_load_from_memory keeps no shared state, so several images decode at once on different threads
+    Image image;
+    int numChannels;
+    image._pixels.reset(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()), static_cast<int>(encoded.size()),
+                                              &image._width, &image._height, &numChannels, STBI_rgb_alpha));
+    return image;
 }
 
-void Texture::Bind() {
-    glBindTexture(GL_TEXTURE_2D, _textureHandle);
+void Image::Deleter::operator()(unsigned char* pixels) const {
+    stbi_image_free(pixels);
 }
@@ -0,0 +1,139 @@
+#include "vertexformat.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+    float signNotZero(float value) { return value >= 0.f ? 1.f : -1.f; }
+
+    int16_t toSnorm16(float value) { return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f)); }
+    uint16_t toUnorm16(float value) { return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f)); }
+    uint8_t toUnorm8(float value) { return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f)); }
+    uint32_t toSnorm10(float value) { return static_cast<uint32_t>(std::lround(std::clamp(value, -1.f, 1.f) * 511.f)) & 0x3FFu; }
+
+    float fromSnorm10(uint32_t bits)
+    {
+        // Sign-extend the 10-bit field
+        auto value = static_cast<int32_t>(bits << 22) >> 22;
+        return std::max(static_cast<float>(value) / 511.f, -1.f);
+    }
+}
+
+size_t VertexEncoder::GetStride(VertexFormat format)
+{
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+void VertexEncoder::SetupAttributes(VertexFormat format)
+{
+    // Define vertex attributes
+    if (format == VertexFormat::Packed) {
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Color));
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Uv));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Color));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Uv));
+    }
+
+    // Enable vertex attributes
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+}
+
+VertexQuantization VertexEncoder::ComputeQuantization(std::span<const Vertex> vertices)
+{
+    VertexQuantization quantization;
+    if (vertices.empty()) {
+        return quantization;
+    }
+
+    glm::vec3 minPosition{ FLT_MAX };
+    glm::vec3 maxPosition{ -FLT_MAX };
+    glm::vec2 minUv{ FLT_MAX };
+    glm::vec2 maxUv{ -FLT_MAX };
+    for (const auto& vertex : vertices) {
+        minPosition = glm::min(minPosition, vertex.Position);
+        maxPosition = glm::max(maxPosition, vertex.Position);
+        minUv = glm::min(minUv, vertex.Uv);
+        maxUv = glm::max(maxUv, vertex.Uv);
+    }
+
+    // Degenerate axes keep a scale of 1 so decoding never divides by zero
+    auto halfExtent = (maxPosition - minPosition) * 0.5f;
+    auto uvExtent = maxUv - minUv;
+    quantization.PositionOffset = (minPosition + maxPosition) * 0.5f;
+    quantization.PositionScale = glm::mix(halfExtent, glm::vec3(1.f), glm::lessThanEqual(halfExtent, glm::vec3(0.f)));
+    quantization.UvOffset = minUv;
+    quantization.UvScale = glm::mix(uvExtent, glm::vec2(1.f), glm::lessThanEqual(uvExtent, glm::vec2(0.f)));
+    return quantization;
+}
+
+std::vector<PackedVertex> VertexEncoder::Pack(std::span<const Vertex> vertices, const VertexQuantization& quantization)
+{
+    std::vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        auto position = (vertex.Position - quantization.PositionOffset) / quantization.PositionScale;
+        out.Position[0] = toSnorm16(position.x);
+        out.Position[1] = toSnorm16(position.y);
+        out.Position[2] = toSnorm16(position.z);
+        out.Position[3] = 0;
+
+        auto normal = EncodeOctahedral(vertex.Normal);
+        out.Normal = toSnorm10(normal.x) | (toSnorm10(normal.y) << 10);
+
+        auto uv = (vertex.Uv - quantization.UvOffset) / quantization.UvScale;
+        out.Uv[0] = toUnorm16(uv.x);
+        out.Uv[1] = toUnorm16(uv.y);
+
+        out.Color[0] = toUnorm8(vertex.Color.r);
+        out.Color[1] = toUnorm8(vertex.Color.g);
+        out.Color[2] = toUnorm8(vertex.Color.b);
+        out.Color[3] = 255;
+    }
+    return packed;
+}
+
+Vertex VertexEncoder::Unpack(const PackedVertex& vertex, const VertexQuantization& quantization)
+{
+    Vertex out;
+    glm::vec3 position{ vertex.Position[0], vertex.Position[1], vertex.Position[2] };
+    out.Position = quantization.PositionOffset + quantization.PositionScale * glm::max(position / 32767.f, -1.f);
+    out.Normal = DecodeOctahedral({ fromSnorm10(vertex.Normal & 0x3FFu), fromSnorm10((vertex.Normal >> 10) & 0x3FFu) });
+    out.Uv = quantization.UvOffset + quantization.UvScale * glm::vec2(vertex.Uv[0], vertex.Uv[1]) / 65535.f;
+    out.Color = glm::vec3(vertex.Color[0], vertex.Color[1], vertex.Color[2]) / 255.f;
+    return out;
+}
+
+glm::vec2 VertexEncoder::EncodeOctahedral(glm::vec3 normal)
+{
+    float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.f) {
+        return glm::vec2(0.f);
+    }
+
+    // Project onto the octahedron, then fold the lower hemisphere over the upper one
+    normal /= sum;
+    if (normal.z < 0.f) {
+        return { (1.f - std::abs(normal.y)) * signNotZero(normal.x), (1.f - std::abs(normal.x)) * signNotZero(normal.y) };
+    }
+    return { normal.x, normal.y };
+}
+
+glm::vec3 VertexEncoder::DecodeOctahedral(glm::vec2 encoded)
+{
+    glm::vec3 normal{ encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y) };
+    if (normal.z < 0.f) {
+        normal.x = (1.f - std::abs(encoded.y)) * signNotZero(encoded.x);
+        normal.y = (1.f - std::abs(encoded.x)) * signNotZero(encoded.y);
+    }
+    return glm::normalize(normal);
+}
@@ -0,0 +1,89 @@
+#include "workerpool.h"
+#include <algorithm>
+#include "parallel.h"
+
+WorkerPool::WorkerPool(uint32_t threadCount)
+{
+    auto workerCount = Parallel::GetThreadCount(threadCount) - 1;
+    _workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        _workers.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+WorkerPool& WorkerPool::Shared()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+void WorkerPool::run(size_t count, Invoke invoke, void* context, uint32_t threadCount)
+{
+    if (count == 0) {
+        return;
+    }
+    auto threads = threadCount == 0 ? GetThreadCount() : std::min(threadCount, GetThreadCount());
+    auto participants = static_cast<uint32_t>(std::min<size_t>(threads, count)) - 1;
+
+    std::lock_guard<std::mutex> call(_callMutex);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _invoke = invoke;
+        _context = context;
+        _count = count;
+        _next.store(0, std::memory_order_relaxed);
+        _participants = participants;
+        _busy = participants;
+        _generation++;
+    }
+    if (participants > 0) {
+        _wake.notify_all();
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this]() { return _busy == 0; });
+}
+
+void WorkerPool::work()
+{
+    for (size_t item = _next.fetch_add(1, std::memory_order_relaxed); item < _count; item = _next.fetch_add(1, std::memory_order_relaxed)) {
+        _invoke(_context, item);
+    }
+}
+
+void WorkerPool::workerLoop(uint32_t index)
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wake.wait(lock, [&]() { return _stopping || _generation != seen; });
+        if (_stopping) {
+            return;
+        }
+        seen = _generation;
+        if (index >= _participants) {
+            continue;
+        }
+
+        lock.unlock();
+        work();
+        lock.lock();
+        if (--_busy == 0) {
+            _done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,104 @@
+// Offline mesh cooker: generates a mesh with its LOD chain, optimizes it and writes it as a mapped mesh file,
+// so the application only maps and uploads it at start-up.
+//
+//   MeshCooker <output.scmf> bottle
+//   MeshCooker <output.scmf> cylinder <radius> <height>
+//   MeshCooker <output.scmf> frustum <bottom radius> <top radius> <height>
+//   MeshCooker <output.scmf> gltf <file.gltf|file.glb> [mesh index]
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "gltfloader.h"
+#include "lathe.h"
+#include "meshfile.h"
+#include "props.h"
+
+namespace {
+    int usage()
+    {
+        std::cerr << "Usage: MeshCooker <output.scmf> bottle | cylinder <radius> <height> | frustum <bottom radius> <top radius> <height> | gltf <file> [mesh index]"
+                  << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return usage();
+    }
+    std::string output = argv[1];
+    std::string input = argv[2];
+
+    // Procedural inputs are surfaces of revolution, cooked with the tolerance the application uses
+    std::vector<Lathe::ProfilePoint> profile;
+    if (input == "bottle" && argc == 3) {
+        profile = Props::BottleProfile();
+    } else if (input == "cylinder" && argc == 5) {
+        float radius = std::stof(argv[3]);
+        float height = std::stof(argv[4]);
+        profile = { { radius, 0.0f }, { radius, height } };
+    } else if (input == "frustum" && argc == 6) {
+        float bottomRadius = std::stof(argv[3]);
+        float topRadius = std::stof(argv[4]);
+        float height = std::stof(argv[5]);
+        profile = { { bottomRadius, 0.0f }, { topRadius, height } };
+    } else if (input != "gltf" || argc < 4 || argc > 5) {
+        return usage();
+    }
+
+    MeshOptimizer::Report report;
+    std::vector<Lathe::LodLevel> lods;
+    GltfLoader::MeshData imported;
+    std::vector<MeshFile::Level> levels;
+    if (input == "gltf") {
+        // An imported mesh is a single level; each material range is reordered on its own so ranges stay contiguous
+        GltfLoader loader;
+        if (!loader.Load(argv[3], false)) {
+            return 1;
+        }
+        size_t meshIndex = argc == 5 ? std::stoul(argv[4]) : 0;
+        if (meshIndex >= loader.GetMeshes().size() || loader.GetMeshes()[meshIndex].SubMeshes.empty()) {
+            std::cerr << "No triangle mesh " << meshIndex << " in " << argv[3] << std::endl;
+            return 1;
+        }
+        imported = loader.GetMeshes()[meshIndex];
+        auto vertexCount = static_cast<uint32_t>(imported.Vertices.size());
+        report.VerticesBefore = vertexCount;
+        report.Before = MeshOptimizer::AnalyzeVertexCache(imported.Indices, vertexCount);
+        for (const auto& subMesh : imported.SubMeshes) {
+            auto first = imported.Indices.begin() + subMesh.FirstIndex;
+            std::vector<uint32_t> range(first, first + subMesh.IndexCount);
+            auto clusters = MeshOptimizer::OptimizeVertexCache(range, vertexCount);
+            MeshOptimizer::OptimizeOverdraw(range, imported.Vertices, clusters);
+            std::copy(range.begin(), range.end(), first);
+        }
+        MeshOptimizer::OptimizeVertexFetch(imported.Vertices, imported.Indices);
+        report.After = MeshOptimizer::AnalyzeVertexCache(imported.Indices, static_cast<uint32_t>(imported.Vertices.size()));
+        levels.push_back({ imported.Vertices, imported.Indices, imported.SubMeshes, 0.0f });
+    } else {
+        lods = Lathe::CreateLodLevels(profile, Props::ChordTolerance, &report);
+        for (const auto& lod : lods) {
+            levels.push_back({ lod.Geometry.GetVertices(), lod.Geometry.GetIndices(), lod.Geometry.GetSubMeshes(), lod.GeometricError });
+        }
+    }
+
+    size_t bytes = 0;
+    for (const auto& level : levels) {
+        bytes += level.Vertices.size_bytes() + level.Indices.size_bytes();
+    }
+    std::filesystem::path outputPath(output);
+    if (outputPath.has_parent_path()) {
+        std::error_code error;
+        std::filesystem::create_directories(outputPath.parent_path(), error);
+    }
+    if (!MeshFile::Write(outputPath, levels)) {
+        return 1;
+    }
+
+    std::cout << "Cooked " << input << " into " << output << ": " << levels.size() << " levels, "
+              << levels.front().Vertices.size() << " vertices at level 0, " << bytes << " bytes of geometry, ACMR "
+              << report.Before.Acmr << " -> " << report.After.Acmr << std::endl;
+    return 0;
+}